@@ -0,0 +1,130 @@
+//=======================================================================
+/** @file FFTBenchmark.cpp
+ *  @brief Times each available FFT implementation side by side
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include "FFT.h"
+#include "OnsetDetectionFunction.h"
+
+//=======================================================================
+static const char* getImplementationName (int implementation)
+{
+    switch (implementation)
+    {
+        case FFTWImplementation:
+            return "FFTW";
+        case KissFFTImplementation:
+            return "Kiss FFT";
+        case BuiltInFFTImplementation:
+            return "Built-in";
+        default:
+            return "Default";
+    }
+}
+
+//=======================================================================
+/** @returns the mean time of a forward and an inverse transform, in microseconds */
+template <typename SampleType>
+static double timeTransforms (int implementation, int size, int numIterations)
+{
+    std::unique_ptr<FFT<SampleType>> fft = FFT<SampleType>::create (implementation, size);
+    std::vector<SampleType> signal (size);
+
+    for (int i = 0; i < size; i++)
+        signal[i] = static_cast<SampleType> (sin (0.01 * i));
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int iteration = 0; iteration < numIterations; iteration++)
+    {
+        // the inverse transform scales the signal by size, so start again from the same input each time
+        std::copy (signal.begin(), signal.end(), fft->getRealBuffer());
+
+        fft->performForwardTransform();
+        fft->performInverseTransform();
+    }
+
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count() / numIterations;
+}
+
+//=======================================================================
+/** @returns the mean time to calculate an onset detection function sample, in microseconds */
+template <typename SampleType>
+static double timeOnsetDetectionFunction (int implementation, int hopSize, int frameSize, int numFrames)
+{
+    std::vector<SampleType> signal (hopSize * numFrames);
+
+    for (size_t i = 0; i < signal.size(); i++)
+        signal[i] = static_cast<SampleType> (sin (0.05 * i) * exp (-0.001 * (i % 11025)));
+
+    BasicOnsetDetectionFunction<SampleType> odf (hopSize, frameSize);
+    odf.setFFTImplementation (implementation);
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < numFrames; i++)
+        odf.calculateOnsetDetectionFunctionSample (&signal[i * hopSize]);
+
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count() / numFrames;
+}
+
+//=======================================================================
+int main()
+{
+    int implementations[] = {FFTWImplementation, KissFFTImplementation, BuiltInFFTImplementation};
+    int sizes[] = {512, 1024, 2048, 4096};
+
+    printf ("Forward and inverse transform (microseconds)\n\n");
+    printf ("%-10s %8s %10s %10s\n", "", "size", "double", "float");
+
+    for (int implementation : implementations)
+    {
+        if (! FFT<double>::isAvailable (implementation))
+            continue;
+
+        for (int size : sizes)
+            printf ("%-10s %8d %10.3f %10.3f\n", getImplementationName (implementation), size,
+                    timeTransforms<double> (implementation, size, 20000),
+                    timeTransforms<float> (implementation, size, 20000));
+    }
+
+    printf ("\nOnset detection function sample, hop 512, frame 1024 (microseconds)\n\n");
+    printf ("%-10s %10s %10s\n", "", "double", "float");
+
+    for (int implementation : implementations)
+    {
+        if (! FFT<double>::isAvailable (implementation))
+            continue;
+
+        printf ("%-10s %10.3f %10.3f\n", getImplementationName (implementation),
+                timeOnsetDetectionFunction<double> (implementation, 512, 1024, 5000),
+                timeOnsetDetectionFunction<float> (implementation, 512, 1024, 5000));
+    }
+
+    return 0;
+}
@@ -58,6 +58,9 @@ typedef struct _btrack
     // An outlet for tempo estimates
     void            *tempo_outlet;
     
+    // Takes the beat tracker's events on the main thread
+    void            *event_qelem;
+    
 } t_btrack;
 
 
@@ -71,7 +74,7 @@ void btrack_dsp64 (t_btrack* x, t_object* dsp64, short* count, double samplerate
 void btrack_perform64 (t_btrack* x, t_object* dsp64, double** ins, long numins, double** outs, long numouts, long sampleframes, long flags, void* userparam);
 
 //===========================================================================
-void btrack_process (t_btrack* x, double* audioFrame);
+void btrack_process (t_btrack* x, const double* audioFrame);
 
 void btrack_on (t_btrack* x);
 void btrack_off (t_btrack* x);
@@ -82,7 +85,7 @@ void btrack_unfixtempo (t_btrack* x);
 void btrack_bang (t_btrack* x);
 void btrack_countin (t_btrack* x);
 
-void outlet_beat (t_btrack* x, t_symbol* s, long argc, t_atom* argv);
+void btrack_take_events (t_btrack* x);
 
 // global class pointer variable
 static t_class* btrack_class = NULL;
@@ -130,6 +133,16 @@ void *btrack_new(t_symbol *s, long argc, t_atom *argv)
         // create detection function and beat tracking objects
         x->b = new BTrack();
         
+        // small signal vector sizes give small hops, so keep the cost of tracking independent of them
+        x->b->setDecimation (true);
+        
+        // spread the tempo estimation over the frames after each beat, so that no one perform call is much more expensive than the rest
+        x->b->setAmortisedTempoEstimation (true);
+        
+        // queue beats for the main thread to take, rather than deferring a message for each one
+        x->b->setEventQueueCapacity (64);
+        x->event_qelem = qelem_new (x, (method) btrack_take_events);
+        
         // create outlets for bpm and beats
         x->tempo_outlet = floatout (x);
         x->beat_outlet = bangout (x);
@@ -150,12 +163,16 @@ void *btrack_new(t_symbol *s, long argc, t_atom *argv)
 //===========================================================================
 void btrack_free(t_btrack *x) 
 {
+    // call the dsp free function on our object first, so that the perform
+    // routine can no longer set the qelem or use the beat tracker
+    dsp_free ((t_pxobject*) x);
+    
+    // stop taking events before the beat tracker goes
+    qelem_free (x->event_qelem);
+    
     // delete the beat tracker
     delete x->b;
     x->b = NULL;
-    
-    // call the dsp free function on our object
-    dsp_free ((t_pxobject*) x);
 }
 
 
@@ -200,6 +217,7 @@ void btrack_dsp64 (t_btrack *x, t_object *dsp64, short *count, double samplerate
     int frameSize = hopSize * 2;
     
     // initialise the beat tracker
+    x->b->updateSampleRate (samplerate);
     x->b->updateHopAndFrameSize (hopSize, frameSize);
     
     // set up dsp
@@ -211,40 +229,38 @@ void btrack_dsp64 (t_btrack *x, t_object *dsp64, short *count, double samplerate
 void btrack_perform64 (t_btrack *x, t_object *dsp64, double **ins, long numins, double **outs, long numouts, long sampleframes, long flags, void *userparam)
 {
     t_double* inL = ins[0]; // we get audio for each inlet of the object from the **ins argument
-    long n = sampleframes;
     
-    double audioFrame[n];
-    
-    for (long i = 0; i < n; i++)
-        audioFrame[i] = (double) inL[i];
-    
-    btrack_process (x, audioFrame);
+    // Max 6 signals are already double precision, so the inlet can be processed directly
+    btrack_process (x, inL);
 }
 
 //===========================================================================
-void btrack_process (t_btrack* x, double* audioFrame)
+void btrack_process (t_btrack* x, const double* audioFrame)
 {
     // process the audio frame
     x->b->processAudioFrame (audioFrame);
     
-    // if there is a beat in this frame
-    if (x->b->beatDueInCurrentFrame())
-    {
-        // outlet a beat
-        defer_low ((t_object*) x, (method) outlet_beat, NULL, 0, NULL);
-    }
+    // if a beat or any other event was queued, wake the main thread to take it. Setting the
+    // qelem again before it runs does nothing, so events close together are taken together
+    if (x->b->hasEvents())
+        qelem_set (x->event_qelem);
 }
 
 //===========================================================================
-void outlet_beat (t_btrack* x, t_symbol* s, long argc, t_atom* argv)
+void btrack_take_events (t_btrack* x)
 {
-    if (x->should_output_beats)
+    BTrackEvent event;
+    
+    while (x->b->getNextEvent (event))
     {
-        // send a bang out of the beat outlet
-        outlet_bang (x->beat_outlet);
-        
-        // send the tempo out of the tempo outlet
-        outlet_float (x->tempo_outlet, (float) x->b->getCurrentTempoEstimate());
+        if (event.type == BeatEvent && x->should_output_beats)
+        {
+            // send a bang out of the beat outlet
+            outlet_bang (x->beat_outlet);
+            
+            // send the tempo at the beat out of the tempo outlet
+            outlet_float (x->tempo_outlet, (float) event.tempo);
+        }
     }
 }
 
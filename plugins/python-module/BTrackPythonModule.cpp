@@ -10,8 +10,9 @@
 static PyObject* detectBeats (PyObject* dummy, PyObject* args)
 {
     PyObject* inputObject = nullptr;
+    double sampleRate = 44100.;
     
-    if (! PyArg_ParseTuple (args, "O", &inputObject))
+    if (! PyArg_ParseTuple (args, "O|d", &inputObject, &sampleRate))
         return nullptr;
     
     PyArrayObject* inputArray = (PyArrayObject*) PyArray_FROM_OTF (inputObject, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY);
@@ -23,12 +24,11 @@ static PyObject* detectBeats (PyObject* dummy, PyObject* args)
     long signalLength = PyArray_Size ((PyObject*)inputArray);
     constexpr int hopSize = 512;
     constexpr int frameSize = 1024;
-    constexpr int sampleRate = 44100;
     int numFrames = signalLength / hopSize;
     
     std::vector<double> buffer (hopSize); // buffer to hold one hopsize worth of audio samples
     
-    BTrack b (hopSize, frameSize);
+    BTrack b (hopSize, frameSize, sampleRate);
 
     std::vector<double> beats;
     beats.reserve (numFrames);
@@ -99,8 +99,9 @@ static PyObject* calculateOnsetDetectionFunction (PyObject* dummy, PyObject* arg
 static PyObject* detectBeatsFromOnsetDetectionFunction (PyObject* dummy, PyObject* args)
 {
     PyObject* inputObject = nullptr;
+    double sampleRate = 44100.;
     
-    if (! PyArg_ParseTuple (args, "O", &inputObject)) 
+    if (! PyArg_ParseTuple (args, "O|d", &inputObject, &sampleRate)) 
         return nullptr;
     
     PyArrayObject* inputArray = (PyArrayObject*) PyArray_FROM_OTF (inputObject, NPY_DOUBLE, NPY_ARRAY_IN_ARRAY);
@@ -112,10 +113,9 @@ static PyObject* detectBeatsFromOnsetDetectionFunction (PyObject* dummy, PyObjec
     long numFrames = PyArray_Size((PyObject*)inputArray);
     constexpr int hopSize = 512;
     constexpr int frameSize = 1024;
-    constexpr int sampleRate = 44100;
     constexpr double epsilon = 1e-4;
 
-    BTrack b (hopSize, frameSize);
+    BTrack b (hopSize, frameSize, sampleRate);
     
     std::vector<double> beats;
     beats.reserve (numFrames);
@@ -140,8 +140,8 @@ static PyObject* detectBeatsFromOnsetDetectionFunction (PyObject* dummy, PyObjec
 //=======================================================================
 static PyMethodDef btrack_methods[] = {
     { "calculate_onset_detection_function", calculateOnsetDetectionFunction, METH_VARARGS, "Calculate the onset detection function"},
-    { "detect_beats", detectBeats, METH_VARARGS, "Detect beats from audio"},
-    { "detect_beats_from_odf", detectBeatsFromOnsetDetectionFunction, METH_VARARGS, "Detect beats from an onset detection function"},
+    { "detect_beats", detectBeats, METH_VARARGS, "Detect beats from audio, at an optional sample rate (44100 Hz by default)"},
+    { "detect_beats_from_odf", detectBeatsFromOnsetDetectionFunction, METH_VARARGS, "Detect beats from an onset detection function, calculated from audio at an optional sample rate (44100 Hz by default)"},
     {NULL, NULL, 0, NULL} /* Sentinel */
 };
 
@@ -198,6 +198,7 @@ BTrackVamp::initialise(size_t channels, size_t stepSize, size_t blockSize)
     m_stepSize = stepSize;
     m_blockSize = blockSize;
     
+    b.updateSampleRate(m_inputSampleRate);
     b.updateHopAndFrameSize(m_stepSize,m_blockSize);
     
 
@@ -213,17 +214,9 @@ BTrackVamp::reset()
 BTrackVamp::FeatureSet
 BTrackVamp::process(const float *const *inputBuffers, Vamp::RealTime timestamp)
 {
-    // create an array to hold our audio frame
-    double frame[m_blockSize];
-    
-    // copy samples into our frame
-    for (int i = 0;i < m_blockSize;i++)
-    {
-        frame[i] = (double) inputBuffers[0][i];
-    }
-    
-    // process the frame in the beat tracker
-    b.processAudioFrame(frame);
+    // process the frame in the beat tracker, which works in single
+    // precision so that it can use the input buffer directly
+    b.processAudioFrame(inputBuffers[0]);
     
     // create a FeatureSet
     FeatureSet featureSet;
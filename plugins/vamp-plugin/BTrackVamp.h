@@ -54,7 +54,7 @@ public:
 protected:
     // plugin-specific data and methods go here
     
-    BTrack b;
+    BTrackFloat b;
     
     int m_stepSize;
     int m_blockSize;
@@ -0,0 +1,91 @@
+//=======================================================================
+/** @file AdaptiveThreshold.cpp
+ *  @brief Removes a moving average from a signal to emphasise its peaks
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#include <algorithm>
+#include "AdaptiveThreshold.h"
+
+//=======================================================================
+AdaptiveThreshold::AdaptiveThreshold (int maxLength, int preLength_, int postLength_)
+ :  preLength (preLength_),
+    postLength (postLength_)
+{
+    setMaximumLength (maxLength);
+}
+
+//=======================================================================
+void AdaptiveThreshold::setMaximumLength (int maxLength)
+{
+    runningSum.resize (maxLength + 1);
+    threshold.resize (maxLength + 1);
+}
+
+//=======================================================================
+void AdaptiveThreshold::process (double* x, int N)
+{
+    if ((int) threshold.size() < N + 1)
+        setMaximumLength (N);
+
+    runningSum[0] = 0;
+
+    for (int i = 0; i < N; i++)
+        runningSum[i + 1] = runningSum[i] + x[i];
+
+    int t = std::min (N, postLength);	// what is smaller, postLength or df size. This is to avoid accessing outside of arrays
+
+    // find threshold for first 't' samples, where a full average cannot be computed yet
+    for (int i = 0; i <= t; i++)
+    {
+        int k = std::min ((i + preLength), N);
+        threshold[i] = calculateMean (1, k);
+    }
+
+    // find threshold for bulk of samples across a moving average from [i - preLength, i + postLength)
+    for (int i = t + 1; i < N - postLength; i++)
+        threshold[i] = calculateMean (i - preLength, i + postLength);
+
+    // for last few samples calculate threshold, again, not enough samples to do as above
+    for (int i = std::max (N - postLength, 0); i < N; i++)
+    {
+        int k = std::max ((i - postLength), 1);
+        threshold[i] = calculateMean (k, N);
+    }
+
+    // subtract the threshold from the signal and check that it is not less than 0
+    for (int i = 0; i < N; i++)
+        x[i] = std::max (x[i] - threshold[i], 0.);
+}
+
+//=======================================================================
+void AdaptiveThreshold::process (std::vector<double>& x)
+{
+    process (x.data(), (int) x.size());
+}
+
+//=======================================================================
+double AdaptiveThreshold::calculateMean (int startIndex, int endIndex) const
+{
+    int length = endIndex - startIndex;
+
+    if (length > 0)
+        return (runningSum[endIndex] - runningSum[startIndex]) / static_cast<double> (length);
+    else
+        return 0;
+}
@@ -0,0 +1,76 @@
+//=======================================================================
+/** @file AdaptiveThreshold.h
+ *  @brief Removes a moving average from a signal to emphasise its peaks
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#ifndef __ADAPTIVETHRESHOLD_H
+#define __ADAPTIVETHRESHOLD_H
+
+#include <vector>
+
+//=======================================================================
+/** Subtracts a moving average from a signal, setting anything that falls below zero to zero.
+ * This removes low level energy and emphasises peaks. The average for sample i is taken over
+ * [i - preLength, i + postLength). Near the start, where that window is not full, it is taken
+ * over [1, i + preLength), and near the end over [max (i - postLength, 1), length).
+ *
+ * Every average comes from a running sum calculated in one pass, so the cost is linear in the
+ * length whatever the window size. The averages are computed as differences of that sum, so
+ * they can differ from summing each window directly by a few units in the last place of the
+ * total of the signal's magnitude (about length * 1e-16 of it).
+ */
+class AdaptiveThreshold
+{
+public:
+
+    /** Constructor
+     * @param maxLength the longest signal that can be processed without allocating memory
+     * @param preLength the number of samples before each sample in its average
+     * @param postLength the number of samples after each sample in its average (not counting the sample itself)
+     */
+    AdaptiveThreshold (int maxLength = 512, int preLength = 8, int postLength = 7);
+
+    /** Sets the longest signal that can be processed without allocating memory
+     * @param maxLength the length in samples
+     */
+    void setMaximumLength (int maxLength);
+
+    /** Applies the threshold to a signal in place
+     * @param x the signal
+     * @param length the number of samples in the signal
+     */
+    void process (double* x, int length);
+
+    /** Applies the threshold to a signal in place
+     * @param x the signal
+     */
+    void process (std::vector<double>& x);
+
+private:
+
+    /** @returns the mean of x over [startIndex, endIndex), using the running sum, or 0 if the range is empty */
+    double calculateMean (int startIndex, int endIndex) const;
+
+    int preLength;                          /**< the number of samples before each sample in its average */
+    int postLength;                         /**< the number of samples after each sample in its average */
+    std::vector<double> runningSum;         /**< runningSum[k] is the sum of the first k samples */
+    std::vector<double> threshold;          /**< the threshold for each sample */
+};
+
+#endif
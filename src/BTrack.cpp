@@ -23,77 +23,101 @@
 #include <algorithm>
 #include <numeric>
 #include "BTrack.h"
-#include "samplerate.h"
 #include <iostream>
 
 //=======================================================================
-BTrack::BTrack()
- :  odf (512, 1024, ComplexSpectralDifferenceHWR, HanningWindow)
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::BasicBTrack()
+ :  odf (512, 1024)
 {
-    initialise (512);
+    initialise (512, 44100.);
 }
 
 //=======================================================================
-BTrack::BTrack (int hop)
- :  odf (hop, 2 * hop, ComplexSpectralDifferenceHWR, HanningWindow)
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::BasicBTrack (int hop)
+ :  odf (hop, 2 * hop)
 {
-    initialise (hop);
+    initialise (hop, 44100.);
 }
 
 //=======================================================================
-BTrack::BTrack (int hop, int frame)
- : odf (hop, frame, ComplexSpectralDifferenceHWR, HanningWindow)
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::BasicBTrack (int hop, int frame)
+ : odf (hop, frame)
 {
-    initialise (hop);
+    initialise (hop, 44100.);
 }
 
 //=======================================================================
-BTrack::~BTrack()
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::BasicBTrack (int hop, int frame, const TempoRange& tempoRange)
+ :  odf (hop, frame),
+    tempoModel (tempoRange)
 {
-#ifdef USE_FFTW
-    // destroy fft plan
-    fftw_destroy_plan (acfForwardFFT);
-    fftw_destroy_plan (acfBackwardFFT);
-    fftw_free (complexIn);
-    fftw_free (complexOut);
-#endif
-    
-#ifdef USE_KISS_FFT
-    free (cfgForwards);
-    free (cfgBackwards);
-    delete [] fftIn;
-    delete [] fftOut;
-#endif
+    initialise (hop, 44100.);
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::BasicBTrack (int hop, int frame, double fs)
+ :  odf (hop, frame)
+{
+    initialise (hop, fs);
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::BasicBTrack (int hop, int frame, double fs, const TempoRange& tempoRange)
+ :  odf (hop, frame),
+    tempoModel (tempoRange)
+{
+    initialise (hop, fs);
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::~BasicBTrack()
+{
+    // stop the tempo estimation thread before anything it uses is destroyed
+    tempoEstimationThread.reset();
 }
 
 //=======================================================================
-double BTrack::getBeatTimeInSeconds (long frameNumber, int hopSize, int samplingFrequency)
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+double BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::getBeatTimeInSeconds (long frameNumber, int hopSize, double samplingFrequency)
 {
-    return ((static_cast<double> (hopSize) / static_cast<double> (samplingFrequency)) * static_cast<double> (frameNumber));
+    return ((static_cast<double> (hopSize) / samplingFrequency) * static_cast<double> (frameNumber));
 }
 
 //=======================================================================
-void BTrack::initialise (int hop)
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::initialise (int hop, double fs)
 {
+    sampleRate = fs;
+    
     // set vector sizes
     resampledOnsetDF.resize (512);
     acf.resize (512);
+    acfLagWeights.resize (512);
     weightingVector.resize (128);
     combFilterBankOutput.resize (128);
-    tempoObservationVector.resize (41);
-    delta.resize (41);
-    prevDelta.resize (41);
-    prevDeltaFixed.resize (41);
     
     double rayleighParameter = 43;
 	
     // initialise parameters
     tightness = 5;
+    windowsBeatPeriod = -1;
+    windowsTightness = -1;
     alpha = 0.9;
     estimatedTempo = 120.0;
     
     timeToNextPrediction = 10;
     timeToNextBeat = -1;
+    beatPhase = 0;
+    beatSampleOffset = 0;
+    lastClockBeatPosition = 0;
+    beatClockPeriod = 0;
     
     beatDueInFrame = false;
 
@@ -101,57 +125,70 @@ void BTrack::initialise (int hop)
     for (int n = 0; n < 128; n++)
         weightingVector[n] = ((double) n / pow (rayleighParameter, 2)) * exp((-1 * pow((double) - n, 2)) / (2 * pow (rayleighParameter, 2)));
     
-    // initialise prevDelta
-    std::fill (prevDelta.begin(), prevDelta.end(), 1);
-        
-    double t_mu = 41 / 2;
-    double m_sig;
-    double x;
-		
-    // create tempo transition matrix
-    m_sig = 41 / 8;
-        
-    for (int i = 0; i < 41; i++)
-    {
-        for (int j = 0; j < 41; j++)
-        {
-            x = j + 1;
-            t_mu = i + 1;
-            tempoTransitionMatrix[i][j] = (1 / (m_sig * sqrt (2 * M_PI))) * exp((-1 * pow ((x - t_mu), 2)) / (2 * pow (m_sig, 2)) );
-        }
-    }
-	
-	// tempo is not fixed
-	tempoFixed = false;
+    // create the comb filter bank for beat periods of 2 to 127 detection function samples, with 4 comb elements
+    combFilterBank = CombFilterBank::createBalancedCombFilterBank (weightingVector, 2, 127, 4);
+    
+    resamplingQuality = HighQualityResampling;
+    decimationEnabled = false;
+    amortisingTempoEstimation = false;
+    queueingEvents = false;
+    tempoFixed = false;
+    lastQueuedTempo = estimatedTempo;
     
     // initialise algorithm given the hopsize
     setHopSize (hop);
     
     // Set up FFT for calculating the auto-correlation function
     FFTLengthForACFCalculation = 1024;
+    acfFFT = FFT<double>::create (DefaultFFTImplementation, FFTLengthForACFCalculation);
     
-#ifdef USE_FFTW
-    complexIn = (fftw_complex*) fftw_malloc (sizeof(fftw_complex) * FFTLengthForACFCalculation);		// complex array to hold fft data
-    complexOut = (fftw_complex*) fftw_malloc (sizeof(fftw_complex) * FFTLengthForACFCalculation);	// complex array to hold fft data
-    
-    acfForwardFFT = fftw_plan_dft_1d (FFTLengthForACFCalculation, complexIn, complexOut, FFTW_FORWARD, FFTW_ESTIMATE);	// FFT plan initialisation
-    acfBackwardFFT = fftw_plan_dft_1d (FFTLengthForACFCalculation, complexOut, complexIn, FFTW_BACKWARD, FFTW_ESTIMATE);	// FFT plan initialisation
-#endif
-    
-#ifdef USE_KISS_FFT
-    fftIn = new kiss_fft_cpx[FFTLengthForACFCalculation];
-    fftOut = new kiss_fft_cpx[FFTLengthForACFCalculation];
-    cfgForwards = kiss_fft_alloc (FFTLengthForACFCalculation, 0, 0, 0);
-    cfgBackwards = kiss_fft_alloc (FFTLengthForACFCalculation, 1, 0, 0);
-#endif
+    // divide each lag of the auto-correlation function by the number of terms it sums, to deal with
+    // the scale bias towards small lags. The division by the FFT length is technically unnecessary but
+    // it ensures the algorithm produces the same ACF output as the old time domain implementation
+    for (int i = 0; i < 512; i++)
+        acfLagWeights[i] = 1. / ((512. - i) * FFTLengthForACFCalculation);
 }
 
 //=======================================================================
-void BTrack::setHopSize (int hop)
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::setHopSize (int hop)
 {	
+    // the tempo estimation thread reads the buffer sizes, so wait for any estimate in progress first
+    std::unique_lock<std::mutex> lock = lockTempoEstimation();
+    
 	hopSize = hop;
-	onsetDFBufferSize = (512 * 512) / hopSize;		// calculate df buffer size
-	beatPeriod = round (60 / ((((double) hopSize) / 44100) * 120.));
+    
+    // the tempo is estimated from 512 detection function samples at the rate of a 512 sample hop at 44.1kHz,
+    // so that the comb filter bank and tempo model do not depend on the hop size or the sample rate
+    double referenceHopSize = 512. * sampleRate / 44100.;
+    
+    // when decimating, average enough detection function samples to get as close as possible to the reference hop
+    decimationFactor = (decimationEnabled && hopSize < referenceHopSize) ? std::max (1, static_cast<int> (round (referenceHopSize / hopSize))) : 1;
+    internalHopSize = hopSize * decimationFactor;
+    decimationCount = 0;
+    decimationSum = 0;
+    hopsToNextBeat = -1;
+    
+	onsetDFBufferSize = static_cast<int> ((512. * referenceHopSize) / internalHopSize);		// calculate df buffer size
+    
+    nextTempoEstimationStage = NoTempoEstimationStage;
+    onsetDFSnapshots.reset (std::vector<double> (onsetDFBufferSize, 0.));
+    tempoEstimates.reset (120.);
+	beatPeriod = round (60 / ((((double) internalHopSize) / sampleRate) * 120.));
+    
+    // allocate the scratch space for the longest beat period the tempo model can choose, so that
+    // nothing is allocated while processing. The cumulative score looks back two beat periods, which
+    // must stay within the onset detection function buffer
+    maxBeatPeriod = static_cast<int> (ceil (60 / ((((double) internalHopSize) / sampleRate) * std::min (tempoModel.getMinimumTempo(), 120.))));
+    maxBeatPeriod = std::min (maxBeatPeriod, onsetDFBufferSize / 2);
+    logGaussianTransitionWeighting.reserve ((2 * maxBeatPeriod) + 1);
+    beatExpectationWindow.reserve (maxBeatPeriod);
+    futureCumulativeScore.resize (onsetDFBufferSize + maxBeatPeriod);
+    
+    updateBeatPeriodWindows();
+
+    // the onset detection function is resampled to 512 samples before tempo estimation
+    resampler.setup (onsetDFBufferSize, 512, resamplingQuality);
 
     // set size of onset detection function buffer
     onsetDF.resize (onsetDFBufferSize);
@@ -170,10 +207,18 @@ void BTrack::setHopSize (int hop)
 			onsetDF[i] = 1;
 		}
 	}
+    
+    // no frames have been processed since the reset
+    numFramesProcessed = 0;
+    lastBeatFrameIndex = -1;
+    
+    BTrackState state = {estimatedTempo, false, -1, -1, 0.};
+    publishedState.write (state);
 }
 
 //=======================================================================
-void BTrack::updateHopAndFrameSize (int hop, int frame)
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::updateHopAndFrameSize (int hop, int frame)
 {
     // update the onset detection function object
     odf.initialise (hop, frame);
@@ -183,53 +228,239 @@ void BTrack::updateHopAndFrameSize (int hop, int frame)
 }
 
 //=======================================================================
-bool BTrack::beatDueInCurrentFrame()
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::updateSampleRate (double fs)
+{
+    sampleRate = fs;
+    
+    // the beat periods and buffer sizes depend on the sample rate
+    setHopSize (hopSize);
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+bool BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::beatDueInCurrentFrame()
 {
     return beatDueInFrame;
 }
 
 //=======================================================================
-double BTrack::getCurrentTempoEstimate()
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+double BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::getCurrentTempoEstimate()
 {
     return estimatedTempo;
 }
 
 //=======================================================================
-int BTrack::getHopSize()
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+int BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::getHopSize()
 {
     return hopSize;
 }
 
 //=======================================================================
-double BTrack::getLatestCumulativeScoreValue()
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+double BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::getSampleRate() const
+{
+    return sampleRate;
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+int BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::getDecimationFactor() const
+{
+    return decimationFactor;
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::setDecimation (bool shouldDecimate)
+{
+    decimationEnabled = shouldDecimate;
+    setHopSize (hopSize);
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+double BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::getLatestCumulativeScoreValue()
 {
     return cumulativeScore[cumulativeScore.size() - 1];
 }
 
 //=======================================================================
-void BTrack::processAudioFrame (double* frame)
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+BTrackState BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::getPublishedState() const
+{
+    return publishedState.read();
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::setEventQueueCapacity (int capacity)
+{
+    queueingEvents = capacity > 0;
+    events.setCapacity (std::max (capacity, 0));
+    lastQueuedTempo = estimatedTempo;
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+bool BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::getNextEvent (BTrackEvent& event)
+{
+    return events.pop (event);
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+bool BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::hasEvents() const
+{
+    return ! events.isEmpty();
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::processAudioFrame (const SampleType* frame)
 {
     // calculate the onset detection function sample for the frame
-    double sample = odf.calculateOnsetDetectionFunctionSample (frame);
+    SampleType sample = odf.calculateOnsetDetectionFunctionSample (frame);
     
     // process the new onset detection function sample in the beat tracking algorithm
     processOnsetDetectionFunctionSample (sample);
 }
 
 //=======================================================================
-void BTrack::processOnsetDetectionFunctionSample (double newSample)
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::processOnsetDetectionFunctionSample (SampleType newSample)
+{
+    applyTempoCommands();
+    
+    if (decimationFactor == 1)
+    {
+        beatDueInFrame = processDecimatedOnsetDetectionFunctionSample (newSample);
+        beatSampleOffset = std::min (static_cast<int> (beatPhase * hopSize), hopSize - 1);
+    }
+    else
+        decimateOnsetDetectionFunctionSample (newSample);
+    
+    publishState();
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::decimateOnsetDetectionFunctionSample (SampleType newSample)
+{
+    // report a beat predicted for this hop
+    beatDueInFrame = hopsToNextBeat == 0;
+    
+    if (hopsToNextBeat >= 0)
+        hopsToNextBeat--;
+    
+    decimationSum += std::abs (newSample);
+    decimationCount++;
+    
+    if (decimationCount < decimationFactor)
+        return;
+    
+    int previousTimeToNextBeat = timeToNextBeat;
+    bool beatDue = processDecimatedOnsetDetectionFunctionSample (decimationSum / static_cast<SampleType> (decimationFactor));
+    
+    decimationSum = 0;
+    decimationCount = 0;
+    
+    // a decimated sample stands for the block of hops it was averaged over, so a beat predicted
+    // for it is reported in the hop of its block that its phase falls in (the middle hop, for a
+    // phase of a half). A beat that was one decimated sample away has been reported in this block
+    // already, otherwise a beat due now is reported late, at the start of the hop
+    if (timeToNextBeat > 0)
+    {
+        double blockPosition = beatPhase * decimationFactor;
+        int hopInBlock = std::min (static_cast<int> (blockPosition), decimationFactor - 1);
+        
+        hopsToNextBeat = ((timeToNextBeat - 1) * decimationFactor) + hopInBlock;
+        beatSampleOffset = std::min (static_cast<int> ((blockPosition - hopInBlock) * hopSize), hopSize - 1);
+    }
+    else if (beatDue && previousTimeToNextBeat != 1)
+    {
+        beatDueInFrame = true;
+        beatSampleOffset = 0;
+    }
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::publishState()
+{
+    long frameIndex = numFramesProcessed;
+    
+    if (beatDueInFrame)
+        lastBeatFrameIndex = frameIndex;
+    
+    BTrackState state;
+    state.tempo = estimatedTempo;
+    state.beatDue = beatDueInFrame;
+    state.frameIndex = frameIndex;
+    state.lastBeatFrameIndex = lastBeatFrameIndex;
+    state.cumulativeScore = cumulativeScore[cumulativeScore.size() - 1];
+    
+    publishedState.write (state);
+    
+    if (queueingEvents)
+    {
+        // a beat in the same frame as a change of tempo follows it, so that it carries the new tempo
+        if (estimatedTempo != lastQueuedTempo)
+            queueEvent (TempoChangeEvent, estimatedTempo);
+        
+        if (beatDueInFrame)
+            queueEvent (BeatEvent, estimatedTempo);
+        
+        lastQueuedTempo = estimatedTempo;
+    }
+    
+    numFramesProcessed++;
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::queueEvent (int type, double tempo)
+{
+    if (! queueingEvents)
+        return;
+    
+    BTrackEvent event;
+    event.type = type;
+    event.frameIndex = numFramesProcessed;
+    event.samplePosition = numFramesProcessed * hopSize;
+    event.sampleOffset = type == BeatEvent ? beatSampleOffset : 0;
+    event.tempo = tempo;
+    
+    // if the queue is full, the event is dropped rather than waiting for the other thread
+    events.push (event);
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+bool BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::processDecimatedOnsetDetectionFunctionSample (SampleType newSample)
 {
     // we need to ensure that the onset
     // detection function sample is positive
-    newSample = fabs (newSample);
+    newSample = std::abs (newSample);
     
     // add a tiny constant to the sample to stop it from ever going
     // to zero. this is to avoid problems further down the line
-    newSample = newSample + 0.0001;
+    newSample = newSample + SampleType (0.0001);
+    
+    // pick up a new tempo from the tempo estimation thread
+    if (tempoEstimationThread && tempoEstimates.read())
+    {
+        setBeatPeriodFromTempo (tempoEstimates.getReadBuffer());
+    }
+    
+    // or carry on with the tempo estimation started at the last beat
+    continueTempoEstimation();
     
 	timeToNextPrediction--;
 	timeToNextBeat--;
-	beatDueInFrame = false;
+    lastClockBeatPosition--;
 		
 	// add new sample at the end
     onsetDF.addSampleToEnd (newSample);
@@ -244,37 +475,210 @@ void BTrack::processOnsetDetectionFunctionSample (double newSample)
 	// if we are at a beat
 	if (timeToNextBeat == 0)
 	{
-		beatDueInFrame = true;	// indicate a beat should be output
-		
-		// recalculate the tempo
-		resampleOnsetDetectionFunction();
-		calculateTempo();
+        if (tempoEstimationThread)
+        {
+            // hand a copy of the onset detection function to the tempo estimation thread
+            std::vector<double>& snapshot = onsetDFSnapshots.getWriteBuffer();
+            
+            for (int i = 0; i < onsetDFBufferSize; i++)
+                snapshot[i] = (double) onsetDF[i];
+            
+            onsetDFSnapshots.publish();
+            tempoEstimationThread->trigger();
+        }
+        else if (amortisingTempoEstimation)
+        {
+            // finish the last estimate if beats are too close together for it, and start another,
+            // to be carried out over the next few samples
+            finishTempoEstimation();
+            copyOnsetDetectionFunctionToResampler();
+            nextTempoEstimationStage = ResamplingStage;
+        }
+        else
+        {
+            // recalculate the tempo
+            resampleOnsetDetectionFunction();
+            setBeatPeriodFromTempo (calculateTempo());
+        }
+        
+        return true;    // indicate a beat should be output
 	}
+    
+    return false;
 }
 
 //=======================================================================
-void BTrack::setTempo (double tempo)
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+const TempoModel<NumTempoStates>& BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::getTempoModel() const
+{
+    return tempoModel;
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::setAsynchronousTempoEstimation (bool shouldEstimateAsynchronously)
+{
+    if (shouldEstimateAsynchronously && ! tempoEstimationThread)
+    {
+        setAmortisedTempoEstimation (false);
+        tempoEstimates.reset (estimatedTempo);
+        tempoEstimationThread.reset (new WorkerThread ([this] { estimateTempoAsynchronously(); }));
+    }
+    else if (! shouldEstimateAsynchronously)
+    {
+        tempoEstimationThread.reset();
+        
+        // make any changes to the tempo model that the thread had not made
+        applyTempoModelCommands();
+        
+        // use the last tempo the thread estimated, if it has not been picked up yet
+        if (tempoEstimates.read())
+            setBeatPeriodFromTempo (tempoEstimates.getReadBuffer());
+    }
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+bool BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::isEstimatingTempoAsynchronously() const
+{
+    return tempoEstimationThread != nullptr;
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::waitForTempoEstimation()
+{
+    if (tempoEstimationThread)
+        tempoEstimationThread->waitUntilIdle();
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::setAmortisedTempoEstimation (bool shouldAmortise)
+{
+    if (shouldAmortise)
+        setAsynchronousTempoEstimation (false);
+    else
+        finishTempoEstimation();
+    
+    amortisingTempoEstimation = shouldAmortise;
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+bool BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::isAmortisingTempoEstimation() const
+{
+    return amortisingTempoEstimation;
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::setTempoTransitionCutoff (double cutoff)
+{
+    std::unique_lock<std::mutex> lock = lockTempoEstimation();
+    tempoModel.setTransitionCutoff (cutoff);
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::setLogDomainTempoEstimation (bool shouldUseLogDomain)
+{
+    std::unique_lock<std::mutex> lock = lockTempoEstimation();
+    tempoModel.setLogDomain (shouldUseLogDomain);
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::setTempo (double tempo)
+{
+    tempoCommands.tempo.store (tempo);
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::fixTempo (double tempo)
+{
+    tempoCommands.fixedTempo.store (std::max (tempo, 0.));
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::doNotFixTempo()
+{
+    tempoCommands.fixedTempo.store (-1.);
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::applyTempoCommands()
+{
+    const double noChange = std::numeric_limits<double>::quiet_NaN();
+    
+    double tempo = tempoCommands.tempo.exchange (noChange);
+    double fixedTempo = tempoCommands.fixedTempo.exchange (noChange);
+    
+    if (std::isnan (tempo) && std::isnan (fixedTempo))
+        return;
+    
+    if (! std::isnan (tempo))
+    {
+        // firstly make sure tempo is within the tempo range
+        tempo = tempoModel.foldTempoIntoRange (tempo);
+        applyTempo (tempo);
+        tempoModelCommands.tempo.store (tempo);
+    }
+    
+    if (fixedTempo >= 0)
+    {
+        tempoFixed = true;
+        queueEvent (TempoFixedEvent, tempoModel.getTempo (tempoModel.getNearestState (fixedTempo)));
+        tempoModelCommands.fixedTempo.store (fixedTempo);
+    }
+    else if (fixedTempo < 0)
+    {
+        if (tempoFixed)
+        {
+            tempoFixed = false;
+            queueEvent (TempoNotFixedEvent, estimatedTempo);
+        }
+        
+        tempoModelCommands.fixedTempo.store (fixedTempo);
+    }
+    
+    // the tempo model belongs to the tempo estimation thread, if there is one
+    if (tempoEstimationThread)
+        tempoEstimationThread->trigger();
+    else
+        applyTempoModelCommands();
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::applyTempoModelCommands()
+{
+    const double noChange = std::numeric_limits<double>::quiet_NaN();
+    
+    double tempo = tempoModelCommands.tempo.exchange (noChange);
+    double fixedTempo = tempoModelCommands.fixedTempo.exchange (noChange);
+    
+    // setting the tempo sets previous tempo observations to zero and the desired tempo to 1
+    if (! std::isnan (tempo))
+        tempoModel.setTempo (tempo);
+    
+    if (fixedTempo >= 0)
+        tempoModel.fixTempo (fixedTempo);
+    else if (fixedTempo < 0)
+        tempoModel.doNotFixTempo();
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::applyTempo (double tempo)
 {
-	/////////// TEMPO INDICATION RESET //////////////////
-	
-	// firstly make sure tempo is between 80 and 160 bpm..
-	while (tempo > 160)
-        tempo = tempo / 2;
-	
-	while (tempo < 80)
-        tempo = tempo * 2;
-		
-	// convert tempo from bpm value to integer index of tempo probability 
-	int tempoIndex = (int) round ((tempo - 80.) / 2);
-	
-    // now set previous tempo observations to zero and set desired tempo index to 1
-    std::fill (prevDelta.begin(), prevDelta.end(), 0);
-	prevDelta[tempoIndex] = 1;
-	
 	/////////// CUMULATIVE SCORE ARTIFICAL TEMPO UPDATE //////////////////
 	
 	// calculate new beat period
-	int newBeatPeriod = (int) round (60 / ((((double) hopSize) / 44100) * tempo));
+	int newBeatPeriod = (int) round (60 / ((((double) internalHopSize) / sampleRate) * tempo));
 	
 	int k = 1;
     
@@ -305,367 +709,261 @@ void BTrack::setTempo (double tempo)
 	
 	// beat is now
 	timeToNextBeat = 0;
+    hopsToNextBeat = -1;
+    beatPhase = 0;
 	
 	// next prediction is on the offbeat, so half of new beat period away
 	timeToNextPrediction = (int) round (((double) newBeatPeriod) / 2);
 }
 
 //=======================================================================
-void BTrack::fixTempo (double tempo)
-{	
-	// firstly make sure tempo is between 80 and 160 bpm..
-	while (tempo > 160)
-        tempo = tempo / 2;
-	
-	while (tempo < 80)
-        tempo = tempo * 2;
-	
-	// convert tempo from bpm value to integer index of tempo probability 
-	int tempoIndex = (int) round((tempo - 80) / 2);
-	
-	// now set previous fixed previous tempo observation values to zero
-	for (int i = 0; i < 41; i++)
-	{
-		prevDeltaFixed[i] = 0;
-	}
-	
-	// set desired tempo index to 1
-	prevDeltaFixed[tempoIndex] = 1;
-		
-	// set the tempo fix flag
-	tempoFixed = true;
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::setFFTImplementation (int fftImplementation)
+{
+    odf.setFFTImplementation (fftImplementation);
+    
+    std::unique_lock<std::mutex> lock = lockTempoEstimation();
+    acfFFT = FFT<double>::create (fftImplementation, FFTLengthForACFCalculation);
 }
 
 //=======================================================================
-void BTrack::doNotFixTempo()
-{	
-	// set the tempo fix flag
-	tempoFixed = false;
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::setResamplingQuality (int quality)
+{
+    std::unique_lock<std::mutex> lock = lockTempoEstimation();
+    finishTempoEstimation();
+    resamplingQuality = quality;
+    resampler.setup (onsetDFBufferSize, 512, resamplingQuality);
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+bool BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::setCombFilterBank (const CombFilterBank& newCombFilterBank)
+{
+    if (newCombFilterBank.getNumRows() > (int) combFilterBankOutput.size() || newCombFilterBank.getInputLength() > (int) acf.size())
+        return false;
+    
+    std::unique_lock<std::mutex> lock = lockTempoEstimation();
+    combFilterBank = newCombFilterBank;
+    return true;
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+const CombFilterBank& BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::getCombFilterBank() const
+{
+    return combFilterBank;
 }
 
 //=======================================================================
-void BTrack::resampleOnsetDetectionFunction()
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::resampleOnsetDetectionFunction()
 {
-	float output[512];
-    float input[onsetDFBufferSize];
+    copyOnsetDetectionFunctionToResampler();
+    performTempoEstimationStage (ResamplingStage);
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::copyOnsetDetectionFunctionToResampler()
+{
+    double* input = resampler.getInputBuffer();
     
     for (int i = 0; i < onsetDFBufferSize; i++)
-        input[i] = (float) onsetDF[i];
-        
-    double ratio = 512.0 / ((double) onsetDFBufferSize);
-    int bufferLength = onsetDFBufferSize;
-    int outputLength = 512;
-    
-    SRC_DATA src_data;
-    src_data.data_in = input;
-    src_data.input_frames = bufferLength;
-    src_data.src_ratio = ratio;
-    src_data.data_out = output;
-    src_data.output_frames = outputLength;
-    
-    src_simple (&src_data, SRC_SINC_BEST_QUALITY, 1);
-            
-    for (int i = 0; i < outputLength; i++)
-        resampledOnsetDF[i] = (double) src_data.data_out[i];
+        input[i] = (double) onsetDF[i];
 }
 
 //=======================================================================
-void BTrack::calculateTempo()
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::estimateTempoAsynchronously()
 {
-    double tempoToLagFactor = 60. * 44100. / 512.;
+    applyTempoModelCommands();
     
-	// adaptive threshold on input
-	adaptiveThreshold (resampledOnsetDF);
-		
-	// calculate auto-correlation function of detection function
-	calculateBalancedACF (resampledOnsetDF);
-	
-	// calculate output of comb filterbank
-	calculateOutputOfCombFilterBank();
-	
+    // the thread can be triggered again while it is estimating, by which time it has the latest copy,
+    // or only to change the tempo model
+    if (! onsetDFSnapshots.read())
+        return;
+    
+    const std::vector<double>& snapshot = onsetDFSnapshots.getReadBuffer();
+    std::copy (snapshot.begin(), snapshot.begin() + onsetDFBufferSize, resampler.getInputBuffer());
+    performTempoEstimationStage (ResamplingStage);
+    
+    tempoEstimates.getWriteBuffer() = calculateTempo();
+    tempoEstimates.publish();
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+std::unique_lock<std::mutex> BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::lockTempoEstimation()
+{
+    if (tempoEstimationThread)
+        return std::unique_lock<std::mutex> (tempoEstimationThread->getLock());
+    
+    return std::unique_lock<std::mutex>();
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+double BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::calculateTempo()
+{
+    for (int stage = ThresholdingStage; stage < TempoModelStage; stage++)
+        performTempoEstimationStage (stage);
+    
+    return calculateMostLikelyTempo();
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::performTempoEstimationStage (int stage)
+{
+    switch (stage)
+    {
+        case ResamplingStage:
+            // resample the onset detection function already copied to the resampler
+            resampler.process (resampledOnsetDF.data());
+            break;
+            
+        case ThresholdingStage:
+            // adaptive threshold on input
+            adaptiveThreshold.process (resampledOnsetDF);
+            break;
+            
+        case AutoCorrelationStage:
+            // calculate auto-correlation function of detection function
+            calculateBalancedACF (resampledOnsetDF);
+            break;
+            
+        case CombFilteringStage:
+            // calculate output of comb filterbank
+            calculateOutputOfCombFilterBank();
+            break;
+            
+        default:
+            break;
+    }
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+double BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::calculateMostLikelyTempo()
+{
 	// adaptive threshold on rcf
-	adaptiveThreshold (combFilterBankOutput);
+	adaptiveThreshold.process (combFilterBankOutput);
 
-	// calculate tempo observation vector from beat period observation vector
-	for (int i = 0; i < 41; i++)
-	{
-		int tempoIndex1 = (int) round (tempoToLagFactor / ((double) ((2 * i) + 80)));
-		int tempoIndex2 = (int) round (tempoToLagFactor / ((double) ((4 * i) + 160)));
-		tempoObservationVector[i] = combFilterBankOutput[tempoIndex1 - 1] + combFilterBankOutput[tempoIndex2 - 1];
-	}
-	
-	// if tempo is fixed then always use a fixed set of tempi as the previous observation probability function
-	if (tempoFixed)
-	{
-		for (int k = 0; k < 41; k++)
-            prevDelta[k] = prevDeltaFixed[k];
-	}
-		
-	for (int j = 0; j < 41; j++)
-	{
-		double maxValue = -1;
-        
-		for (int i = 0; i < 41; i++)
-		{
-			double currentValue = prevDelta[i] * tempoTransitionMatrix[i][j];
-			
-			if (currentValue > maxValue)
-                maxValue = currentValue;
-		}
-		
-		delta[j] = maxValue * tempoObservationVector[j];
-	}
-	
-	normaliseVector (delta);
+	// make a new tempo estimate and return the most likely tempo
+	int maxIndex = tempoModel.update (combFilterBankOutput);
 	
-	double maxIndex = -1;
-	double maxValue = -1;
-	
-	for (int j = 0; j < 41; j++)
-	{
-		if (delta[j] > maxValue)
-		{
-			maxValue = delta[j];
-			maxIndex = j;
-		}
-		
-		prevDelta[j] = delta[j];
-	}
-	
-	beatPeriod = round ((60.0 * 44100.0) / (((2 * maxIndex) + 80) * ((double) hopSize)));
-	
-	if (beatPeriod > 0)
-        estimatedTempo = 60.0 / ((((double) hopSize) / 44100.0) * beatPeriod);
+	return tempoModel.getTempo (maxIndex);
 }
 
 //=======================================================================
-void BTrack::adaptiveThreshold (std::vector<double>& x)
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::continueTempoEstimation()
 {
-    int N = static_cast<int> (x.size());
-	double threshold[N];
-	
-	int p_post = 7;
-	int p_pre = 8;
-	
-	int t = std::min (N, p_post);	// what is smaller, p_post or df size. This is to avoid accessing outside of arrays
-	
-	// find threshold for first 't' samples, where a full average cannot be computed yet 
-	for (int i = 0; i <= t; i++)
-	{	
-		int k = std::min ((i + p_pre), N);
-		threshold[i] = calculateMeanOfVector (x, 1, k);
-	}
+    if (nextTempoEstimationStage == NoTempoEstimationStage)
+        return;
     
-	// find threshold for bulk of samples across a moving average from [i-p_pre,i+p_post]
-	for (int i = t + 1; i < N - p_post; i++)
-	{
-		threshold[i] = calculateMeanOfVector (x, i - p_pre, i + p_post);
-	}
+    if (nextTempoEstimationStage == TempoModelStage)
+        setBeatPeriodFromTempo (calculateMostLikelyTempo());
+    else
+        performTempoEstimationStage (nextTempoEstimationStage);
     
-	// for last few samples calculate threshold, again, not enough samples to do as above
-	for (int i = N - p_post; i < N; i++)
-	{
-		int k = std::max ((i - p_post), 1);
-		threshold[i] = calculateMeanOfVector (x, k, N);
-	}
+    nextTempoEstimationStage++;
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::finishTempoEstimation()
+{
+    while (nextTempoEstimationStage != NoTempoEstimationStage)
+        continueTempoEstimation();
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::setBeatPeriodFromTempo (double tempo)
+{
+	// the tempo model never chooses a beat period longer than maxBeatPeriod, and keeping to it means
+	// that the windows and scratch space allocated in setHopSize() are always large enough
+	beatPeriod = std::min (round ((60.0 * sampleRate) / (tempo * ((double) internalHopSize))), static_cast<double> (maxBeatPeriod));
 	
-	// subtract the threshold from the detection function and check that it is not less than 0
-	for (int i = 0; i < N; i++)
-	{
-		x[i] = x[i] - threshold[i];
-        
-		if (x[i] < 0)
-            x[i] = 0;
-	}
+	if (beatPeriod > 0)
+        estimatedTempo = 60.0 / ((((double) internalHopSize) / sampleRate) * beatPeriod);
+    
+    updateBeatPeriodWindows();
 }
 
 //=======================================================================
-void BTrack::calculateOutputOfCombFilterBank()
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::calculateOutputOfCombFilterBank()
 {
+    // a bank with fewer rows leaves the longer beat periods at zero
     std::fill (combFilterBankOutput.begin(), combFilterBankOutput.end(), 0.0);
-	int numCombElements = 4;
-	
-	for (int i = 2; i <= 127; i++) // max beat period
-	{
-		for (int a = 1; a <= numCombElements; a++) // number of comb elements
-		{
-			for (int b = 1 - a; b <= a - 1; b++) // general state using normalisation of comb elements
-			{
-				combFilterBankOutput[i - 1] += (acf[(a * i + b) - 1] * weightingVector[i - 1]) / (2 * a - 1);	// calculate value for comb filter row
-			}
-		}
-	}
+    combFilterBank.process (acf.data(), combFilterBankOutput.data());
 }
 
 //=======================================================================
-void BTrack::calculateBalancedACF (std::vector<double>& onsetDetectionFunction)
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::calculateBalancedACF (std::vector<double>& onsetDetectionFunction)
 {
     int onsetDetectionFunctionLength = 512;
+    double* fftReal = acfFFT->getRealBuffer();
+    double* fftComplex = acfFFT->getComplexBuffer();
     
-#ifdef USE_FFTW
-    // copy into complex array and zero pad
+    // copy into the real fft input and zero pad
     for (int i = 0; i < FFTLengthForACFCalculation; i++)
-    {
-        if (i < onsetDetectionFunctionLength)
-        {
-            complexIn[i][0] = onsetDetectionFunction[i];
-            complexIn[i][1] = 0.0;
-        }
-        else
-        {
-            complexIn[i][0] = 0.0;
-            complexIn[i][1] = 0.0;
-        }
-    }
+        fftReal[i] = i < onsetDetectionFunctionLength ? onsetDetectionFunction[i] : 0.0;
     
     // perform the fft
-    fftw_execute (acfForwardFFT);
+    acfFFT->performForwardTransform();
     
     // multiply by complex conjugate
-    for (int i = 0; i < FFTLengthForACFCalculation; i++)
+    for (int i = 0; i < (FFTLengthForACFCalculation / 2) + 1; i++)
     {
-        complexOut[i][0] = complexOut[i][0] * complexOut[i][0] + complexOut[i][1] * complexOut[i][1];
-        complexOut[i][1] = 0.0;
+        fftComplex[2 * i] = fftComplex[2 * i] * fftComplex[2 * i] + fftComplex[(2 * i) + 1] * fftComplex[(2 * i) + 1];
+        fftComplex[(2 * i) + 1] = 0.0;
     }
     
     // perform the ifft
-    fftw_execute (acfBackwardFFT);
-    
-#endif
-    
-#ifdef USE_KISS_FFT
-    // copy into complex array and zero pad
-    for (int i = 0; i < FFTLengthForACFCalculation; i++)
-    {
-        if (i < onsetDetectionFunctionLength)
-        {
-            fftIn[i].r = onsetDetectionFunction[i];
-            fftIn[i].i = 0.0;
-        }
-        else
-        {
-            fftIn[i].r = 0.0;
-            fftIn[i].i = 0.0;
-        }
-    }
+    acfFFT->performInverseTransform();
     
-    // execute kiss fft
-    kiss_fft (cfgForwards, fftIn, fftOut);
-    
-    // multiply by complex conjugate
-    for (int i = 0; i < FFTLengthForACFCalculation; i++)
-    {
-        fftOut[i].r = fftOut[i].r * fftOut[i].r + fftOut[i].i * fftOut[i].i;
-        fftOut[i].i = 0.0;
-    }
-    
-    // perform the ifft
-    kiss_fft (cfgBackwards, fftOut, fftIn);
-    
-#endif
-    
-    double lag = 512;
-    
-    for (int i = 0; i < 512; i++)
-    {
-#ifdef USE_FFTW
-        // calculate absolute value of result
-        double absValue = sqrt (complexIn[i][0] * complexIn[i][0] + complexIn[i][1] * complexIn[i][1]);
-#endif
-        
-#ifdef USE_KISS_FFT
-        // calculate absolute value of result
-        double absValue = sqrt (fftIn[i].r * fftIn[i].r + fftIn[i].i * fftIn[i].i);
-#endif
-        // divide by inverse lad to deal with scale bias towards small lags
-        acf[i] = absValue / lag;
-        
-        // this division by 1024 is technically unnecessary but it ensures the algorithm produces
-        // exactly the same ACF output as the old time domain implementation. The time difference is
-        // minimal so I decided to keep it
-        acf[i] = acf[i] / 1024.;
-        
-        lag = lag - 1.;
-    }
-}
-
-//=======================================================================
-double BTrack::calculateMeanOfVector (std::vector<double>& vector, int startIndex, int endIndex)
-{
-    int length = endIndex - startIndex;
-    double sum = std::accumulate (vector.begin() + startIndex, vector.begin() + endIndex, 0.0);
-
-    if (length > 0)
-        return sum / static_cast<double> (length);	// average and return
-    else
-        return 0;
+    // the input is non-negative after the adaptive threshold, so the inverse transform is the
+    // auto-correlation itself and only needs scaling (see acfLagWeights)
+    for (int i = 0; i < onsetDetectionFunctionLength; i++)
+        acf[i] = fftReal[i] * acfLagWeights[i];
 }
 
-//=======================================================================
-void BTrack::normaliseVector (std::vector<double>& vector)
-{
-    double sum = std::accumulate (vector.begin(), vector.end(), 0.0);
-	
-	if (sum > 0)
-    {
-        for (int i = 0; i < vector.size(); i++)
-            vector[i] = vector[i] / sum;
-    }
-}
 
 //=======================================================================
-void BTrack::updateCumulativeScore (double onsetDetectionFunctionSample)
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::updateCumulativeScore (SampleType onsetDetectionFunctionSample)
 {
 	int windowStart = onsetDFBufferSize - round (2. * beatPeriod);
 	int windowEnd = onsetDFBufferSize - round (beatPeriod / 2.);
-	int windowSize = windowEnd - windowStart + 1;
-	
-    // create log gaussian transition window
-	double logGaussianTransitionWeighting[windowSize];
-    createLogGaussianTransitionWeighting (logGaussianTransitionWeighting, windowSize, beatPeriod);
 	
-    // calculate the new cumulative score value
-    double cumulativeScoreValue = calculateNewCumulativeScoreValue (cumulativeScore, logGaussianTransitionWeighting, windowStart, windowEnd, onsetDetectionFunctionSample, alpha);
+    // calculate the new cumulative score value, using the log gaussian transition window for the current beat period
+    SampleType cumulativeScoreValue = calculateNewCumulativeScoreValue (cumulativeScore, logGaussianTransitionWeighting.data(), windowStart, windowEnd, onsetDetectionFunctionSample, static_cast<SampleType> (alpha));
     
     // add the new cumulative score value to the buffer
     cumulativeScore.addSampleToEnd (cumulativeScoreValue);
 }
 
 //=======================================================================
-void BTrack::predictBeat()
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::predictBeat()
 {	 
+	// the beat period never exceeds maxBeatPeriod (see setBeatPeriodFromTempo()), so the scratch space is large enough
 	int beatExpectationWindowSize = static_cast<int> (beatPeriod);
-	double futureCumulativeScore[onsetDFBufferSize + beatExpectationWindowSize];
-	double beatExpectationWindow[beatExpectationWindowSize];
-    
+
 	// copy cumulativeScore to first part of futureCumulativeScore
 	for (int i = 0; i < onsetDFBufferSize; i++)
         futureCumulativeScore[i] = cumulativeScore[i];
 	
-	// Create a beat expectation window for predicting future beats from the "future" of the cumulative score.
-    // We are making this beat prediction at the midpoint between beats, and so we make a Gaussian
-    // weighting centred on the most likely beat position (half a beat period into the future)
-    // This is W2 in Adam Stark's PhD thesis, equation 3.6, page 62
-    
-	double v = 1;
-    
-	for (int i = 0; i < beatExpectationWindowSize; i++)
-	{
-		beatExpectationWindow[i] = exp((-1 * pow ((v - (beatPeriod / 2)), 2))   /  (2 * pow (beatPeriod / 2, 2)));
-		v++;
-	}
-	
-	// Create window for "synthesizing" the cumulative score into the future
-    // It is a log-Gaussian transition weighting running from from 2 beat periods
-    // in the past to half a beat period in the past. It favours the time exactly
-    // one beat period in the past
+	// The beat expectation window (W2) and the log gaussian transition weighting (W1) for the
+    // current beat period are kept up to date by updateBeatPeriodWindows()
     
 	int startIndex = onsetDFBufferSize - round (2 * beatPeriod);
 	int endIndex = onsetDFBufferSize - round (beatPeriod / 2);
-	int pastWindowSize = endIndex - startIndex + 1;
-    
-	double logGaussianTransitionWeighting[pastWindowSize];
-    createLogGaussianTransitionWeighting (logGaussianTransitionWeighting, pastWindowSize, beatPeriod);
 
 	// Calculate the future cumulative score, by shifting the log Gaussian transition weighting from its
     // start position of [-2 beat periods, - 0.5 beat periods] forwards over the size of the beat
@@ -675,7 +973,7 @@ void BTrack::predictBeat()
 	{
         // note here that we pass 0.0 in for the onset detection function sample and 1.0 for the alpha weighting factor
         // see equation 3.4 and page 60 - 62 of Adam Stark's PhD thesis for details
-        futureCumulativeScore[i] = calculateNewCumulativeScoreValue (futureCumulativeScore, logGaussianTransitionWeighting, startIndex, endIndex, 0.0, 1.0);
+        futureCumulativeScore[i] = calculateNewCumulativeScoreValue (futureCumulativeScore.data(), logGaussianTransitionWeighting.data(), startIndex, endIndex, SampleType (0), SampleType (1));
         
         startIndex++;
         endIndex++;
@@ -699,13 +997,77 @@ void BTrack::predictBeat()
 		
 		n++;
 	}
-		
+    
+    // the beat period is a whole number of detection function samples, so the predicted beats only
+    // fall on the nearest sample. To place each beat within its sample, a beat clock follows the
+    // predicted beats, adjusting its phase and period a little at every beat, so that over a few
+    // beats it settles on where the beats fall between the samples. If the prediction jumps away
+    // from the clock, or the tempo changes, the clock starts again from the predicted beat
+    const double phaseGain = 0.125;
+    const double periodGain = 0.02;
+    
+    double clockBeatPosition = lastClockBeatPosition + beatClockPeriod;
+    double error = timeToNextBeat - clockBeatPosition;
+    
+    if (fabs (error) > (beatPeriod / 8.) || fabs (beatClockPeriod - beatPeriod) > (beatPeriod / 8.))
+    {
+        lastClockBeatPosition = timeToNextBeat;
+        beatClockPeriod = beatPeriod;
+    }
+    else
+    {
+        lastClockBeatPosition = clockBeatPosition + (phaseGain * error);
+        beatClockPeriod += periodGain * error;
+    }
+    
+    // the predicted beat is taken to be in the middle of its sample's hop, so the phase runs from
+    // 0 at the start of the hop to 1 at the end
+    beatPhase = 0.5 + std::max (-0.5, std::min (0.5, lastClockBeatPosition - timeToNextBeat));
+    
 	// set next prediction time as on the offbeat after the next beat
 	timeToNextPrediction = timeToNextBeat + round (beatPeriod / 2);
 }
 
 //=======================================================================
-void BTrack::createLogGaussianTransitionWeighting (double* weightingArray, int numSamples, double beatPeriod)
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::updateBeatPeriodWindows()
+{
+    // the windows only depend on the beat period and the tightness, which change at most once a beat
+    if (beatPeriod == windowsBeatPeriod && tightness == windowsTightness)
+        return;
+    
+    // Create window for "synthesizing" the cumulative score into the future
+    // It is a log-Gaussian transition weighting running from from 2 beat periods
+    // in the past to half a beat period in the past. It favours the time exactly
+    // one beat period in the past
+    int windowSize = static_cast<int> (round (2. * beatPeriod) - round (beatPeriod / 2.)) + 1;
+    
+    logGaussianTransitionWeighting.resize (windowSize);
+    createLogGaussianTransitionWeighting (logGaussianTransitionWeighting.data(), windowSize, beatPeriod);
+    
+    // Create a beat expectation window for predicting future beats from the "future" of the cumulative score.
+    // We are making this beat prediction at the midpoint between beats, and so we make a Gaussian
+    // weighting centred on the most likely beat position (half a beat period into the future)
+    // This is W2 in Adam Stark's PhD thesis, equation 3.6, page 62
+    int beatExpectationWindowSize = static_cast<int> (beatPeriod);
+    
+    beatExpectationWindow.resize (beatExpectationWindowSize);
+    
+    double v = 1;
+    
+    for (int i = 0; i < beatExpectationWindowSize; i++)
+    {
+        beatExpectationWindow[i] = exp((-1 * pow ((v - (beatPeriod / 2)), 2))   /  (2 * pow (beatPeriod / 2, 2)));
+        v++;
+    }
+    
+    windowsBeatPeriod = beatPeriod;
+    windowsTightness = tightness;
+}
+
+//=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
+void BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::createLogGaussianTransitionWeighting (SampleType* weightingArray, int numSamples, double beatPeriod)
 {
     // (This is W1 in Adam Stark's PhD thesis, equation 3.2, page 60)
     
@@ -720,16 +1082,17 @@ void BTrack::createLogGaussianTransitionWeighting (double* weightingArray, int n
 }
 
 //=======================================================================
+template <typename SampleType, typename DetectionFunction, int NumTempoStates>
 template <typename T>
-double BTrack::calculateNewCumulativeScoreValue (T cumulativeScoreArray, double* logGaussianTransitionWeighting, int startIndex, int endIndex, double onsetDetectionFunctionSample, double alphaWeightingFactor)
+SampleType BasicBTrack<SampleType, DetectionFunction, NumTempoStates>::calculateNewCumulativeScoreValue (const T& cumulativeScoreArray, const SampleType* logGaussianTransitionWeighting, int startIndex, int endIndex, SampleType onsetDetectionFunctionSample, SampleType alphaWeightingFactor)
 {
     // calculate new cumulative score value by weighting the cumulative score between
     // startIndex and endIndex and finding the maximum value
-    double maxValue = 0;
+    SampleType maxValue = 0;
     int n = 0;
     for (int i = startIndex; i <= endIndex; i++)
     {
-        double weightedCumulativeScore = cumulativeScoreArray[i] * logGaussianTransitionWeighting[n];
+        SampleType weightedCumulativeScore = cumulativeScoreArray[i] * logGaussianTransitionWeighting[n];
         
         if (weightedCumulativeScore > maxValue)
             maxValue = weightedCumulativeScore;
@@ -739,7 +1102,15 @@ double BTrack::calculateNewCumulativeScoreValue (T cumulativeScoreArray, double*
     
     // now mix with the incoming onset detection function sample
     // (equation 3.4 on page 60 of Adam Stark's PhD thesis)
-    double cumulativeScoreValue = ((1. - alphaWeightingFactor) * onsetDetectionFunctionSample) + (alphaWeightingFactor * maxValue);
+    SampleType cumulativeScoreValue = ((1 - alphaWeightingFactor) * onsetDetectionFunctionSample) + (alphaWeightingFactor * maxValue);
     
     return cumulativeScoreValue;
 }
+
+//=======================================================================
+template class BasicBTrack<double>;
+template class BasicBTrack<float>;
+template class BasicBTrack<double, OnsetDetectionFunction>;
+template class BasicBTrack<float, OnsetDetectionFunctionFloat>;
+template class BasicBTrack<double, StaticOnsetDetectionFunction<ComplexSpectralDifferenceHWR, HanningWindow, double>, DynamicNumTempoStates>;
+template class BasicBTrack<float, StaticOnsetDetectionFunction<ComplexSpectralDifferenceHWR, HanningWindow, float>, DynamicNumTempoStates>;
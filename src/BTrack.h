@@ -22,37 +22,127 @@
 #ifndef __BTRACK_H
 #define __BTRACK_H
 
-#include "OnsetDetectionFunction.h"
+#include "StaticOnsetDetectionFunction.h"
 #include "CircularBuffer.h"
+#include "FFT.h"
+#include "Resampler.h"
+#include "CombFilterBank.h"
+#include "AdaptiveThreshold.h"
+#include "TempoModel.h"
+#include "TripleBuffer.h"
+#include "WorkerThread.h"
+#include "LockFreeQueue.h"
+#include "SeqLock.h"
 #include <vector>
+#include <memory>
+#include <atomic>
+#include <limits>
+
+//=======================================================================
+/** A consistent view of the state of a beat tracker after an audio frame (or onset detection
+ * function sample), which other threads can read while the next frame is processed
+ * (see BasicBTrack::getPublishedState())
+ */
+struct BTrackState
+{
+    double tempo;                           /**< the tempo estimate, in beats per minute */
+    bool beatDue;                           /**< true if a beat is due in the frame */
+    long frameIndex;                        /**< the index of the frame, counting from 0 since the beat tracker was created or reset, or -1 before the first frame */
+    long lastBeatFrameIndex;                /**< the index of the latest frame in which a beat was due, or -1 if there has not been one */
+    double cumulativeScore;                 /**< the latest value of the cumulative score function */
+};
+
+//=======================================================================
+/** The types of event that a beat tracker can queue (see BasicBTrack::setEventQueueCapacity()) */
+enum BTrackEventType
+{
+    BeatEvent,                              /**< a beat is due in the frame */
+    TempoChangeEvent,                       /**< the tempo estimate changed in the frame */
+    TempoFixedEvent,                        /**< the tempo was fixed, with fixTempo() */
+    TempoNotFixedEvent                      /**< the tempo stopped being fixed, with doNotFixTempo() */
+};
+
+/** Something that happened in an audio frame (or onset detection function sample), queued by the
+ * beat tracker for another thread to take (see BasicBTrack::getNextEvent())
+ */
+struct BTrackEvent
+{
+    int type;                               /**< the type of event (see BTrackEventType) */
+    long frameIndex;                        /**< the index of the frame, counting from 0 since the beat tracker was created or reset */
+    long samplePosition;                    /**< the position of the start of the frame's hop, in audio samples since the beat tracker was created or reset */
+    int sampleOffset;                       /**< where the event falls within the frame's hop, in audio samples after samplePosition. For beats, this comes from a beat clock that follows the predicted beats (see predictBeat()), and for other events it is 0 */
+    double tempo;                           /**< the tempo estimate after the frame, or the fixed tempo for a TempoFixedEvent, in beats per minute */
+};
 
 //=======================================================================
 /** The main beat tracking class and the interface to the BTrack
  * beat tracking algorithm. The algorithm can process either
  * audio frames or onset detection function samples and also
  * contains some static functions for calculating beat times in seconds
+ *
+ * The class is a template on the sample type of the audio, onset detection function
+ * and cumulative score. BTrack is the double precision reference version and BTrackFloat
+ * runs the per-frame processing in single precision, which finds the same beats to within
+ * one detection function sample (see README.md). The tempo estimation is always carried
+ * out in double precision.
+ *
+ * The onset detection function is also a template parameter. By default it is the complex
+ * spectral difference (half-wave rectified) with a Hanning window, chosen at compile time.
+ * The tracker is compiled for that and for the run-time configurable OnsetDetectionFunction.
+ *
+ * The tracker chooses between tempi in a TempoRange, by default 41 tempi from 80 to 160 bpm.
+ * The number of tempi is the last template parameter, so that the default keeps fixed-size
+ * arrays. With DynamicNumTempoStates, any number can be given to the constructor.
+ *
+ * @tparam SampleType the type of the audio and detection function samples (float or double)
+ * @tparam DetectionFunction the onset detection function class
+ * @tparam NumTempoStates the number of tempi, or DynamicNumTempoStates to choose at run time
  */
-class BTrack {
+template <typename SampleType, typename DetectionFunction = StaticOnsetDetectionFunction<ComplexSpectralDifferenceHWR, HanningWindow, SampleType>, int NumTempoStates = 41>
+class BasicBTrack {
 	
 public:
     
     //=======================================================================
     /** Constructor assuming hop size of 512 and frame size of 1024 */
-    BTrack();
+    BasicBTrack();
     
     /** Constructor assuming frame size will be double the hopSize
      * @param hopSize the hop size in audio samples
      */
-    BTrack (int hopSize);
+    BasicBTrack (int hopSize);
     
     /** Constructor taking both hopSize and frameSize
      * @param hopSize the hop size in audio samples
      * @param frameSize the frame size in audio samples
      */
-    BTrack (int hopSize, int frameSize);
+    BasicBTrack (int hopSize, int frameSize);
+    
+    /** Constructor taking the hopSize, frameSize and the range of tempi to track
+     * @param hopSize the hop size in audio samples
+     * @param frameSize the frame size in audio samples
+     * @param tempoRange the tempi to choose between. Unless NumTempoStates is DynamicNumTempoStates,
+     * its number of states is ignored and the range is divided into NumTempoStates tempi
+     */
+    BasicBTrack (int hopSize, int frameSize, const TempoRange& tempoRange);
+    
+    /** Constructor taking the hopSize, frameSize and the sample rate of the audio
+     * @param hopSize the hop size in audio samples
+     * @param frameSize the frame size in audio samples
+     * @param sampleRate the sample rate of the audio in Hz
+     */
+    BasicBTrack (int hopSize, int frameSize, double sampleRate);
+    
+    /** Constructor taking the hopSize, frameSize, the sample rate of the audio and the range of tempi to track
+     * @param hopSize the hop size in audio samples
+     * @param frameSize the frame size in audio samples
+     * @param sampleRate the sample rate of the audio in Hz
+     * @param tempoRange the tempi to choose between (see above)
+     */
+    BasicBTrack (int hopSize, int frameSize, double sampleRate, const TempoRange& tempoRange);
     
     /** Destructor */
-    ~BTrack();
+    ~BasicBTrack();
     
     //=======================================================================
     /** Updates the hop and frame size used by the beat tracker 
@@ -61,22 +151,35 @@ public:
      */
     void updateHopAndFrameSize (int hopSize, int frameSize);
     
+    /** Updates the sample rate of the audio, which the beat tracker needs to convert between tempi
+     * and beat periods. This resets the beat tracker, as changing the hop size does
+     * @param sampleRate the sample rate of the audio in Hz
+     */
+    void updateSampleRate (double sampleRate);
+    
     //=======================================================================
     /** Process a single audio frame 
      * @param frame a pointer to an array containing an audio frame. The number of samples should 
      * match the frame size that the algorithm was initialised with.
      */
-    void processAudioFrame (double* frame);
+    void processAudioFrame (const SampleType* frame);
     
     /** Add new onset detection function sample to buffer and apply beat tracking 
      * @param sample an onset detection function sample
      */
-    void processOnsetDetectionFunctionSample (double sample);
+    void processOnsetDetectionFunctionSample (SampleType sample);
    
     //=======================================================================
     /** @returns the current hop size being used by the beat tracker */
     int getHopSize();
     
+    /** @returns the sample rate of the audio, in Hz */
+    double getSampleRate() const;
+    
+    /** @returns the number of onset detection function samples averaged into each sample the
+     * beat tracker works with (1 unless decimation is switched on, see setDecimation()) */
+    int getDecimationFactor() const;
+    
     /** @returns true if a beat should occur in the current audio frame */
     bool beatDueInCurrentFrame();
 
@@ -86,21 +189,133 @@ public:
     /** @returns the most recent value of the cumulative score function */
     double getLatestCumulativeScoreValue();
     
+    /** The three functions above must be called from the thread that processes the audio. Other
+     * threads, such as a user interface, can call this instead, as often and from as many threads as
+     * they like, without holding up the audio thread
+     * @returns the state of the beat tracker after the latest audio frame (see BTrackState)
+     */
+    BTrackState getPublishedState() const;
+    
+    /** Choose whether beats and changes of tempo are queued as events (see BTrackEvent) for another
+     * thread to take with getNextEvent(), so that it can take them in batches at its own rate rather
+     * than checking beatDueInCurrentFrame() after every frame. Events are not queued by default. If
+     * the queue is full, new events are dropped until some are taken. This empties the queue, and
+     * must not be called while another thread is processing audio or taking events
+     * @param capacity the largest number of events the queue can hold, or 0 to stop queueing events
+     */
+    void setEventQueueCapacity (int capacity);
+    
+    /** Takes the oldest event from the queue. This can be called from any thread, while another thread
+     * is processing audio, but only one thread may take events at a time
+     * @param event set to the event taken, if there was one
+     * @returns true if an event was taken, or false if the queue was empty
+     */
+    bool getNextEvent (BTrackEvent& event);
+    
+    /** @returns true if there are events waiting to be taken. The thread that processes the audio
+     * can call this after each frame, to wake the thread that takes the events only when needed */
+    bool hasEvents() const;
+    
+    /** @returns the model of the tempi the beat tracker chooses between */
+    const TempoModel<NumTempoStates>& getTempoModel() const;
+    
+    /** Choose whether the tempo is estimated on a thread of its own. Normally the tempo is estimated
+     * in the frame in which a beat falls, which makes that frame far more expensive than the others.
+     * Asynchronously, that frame only copies the onset detection function for the tempo estimation
+     * thread, and the new tempo is used from the first frame after it is ready (normally the next).
+     * While the thread is running, the other functions that change the tempo estimation (such as
+     * setCombFilterBank()) wait for it to finish any estimate in progress, and the tempo model should
+     * not be inspected with getTempoModel()
+     * @param shouldEstimateAsynchronously true to estimate the tempo on a thread of its own
+     */
+    void setAsynchronousTempoEstimation (bool shouldEstimateAsynchronously);
+    
+    /** @returns true if the tempo is estimated on a thread of its own */
+    bool isEstimatingTempoAsynchronously() const;
+    
+    /** Waits until the tempo estimation thread has finished every estimate asked for so far, so
+     * that the next frame uses the latest tempo, for example when processing a file offline. Does
+     * nothing unless the tempo is estimated asynchronously. This must not be called from the audio thread */
+    void waitForTempoEstimation();
+    
+    /** Choose whether the tempo estimation is spread over the frames after a beat, one stage per frame
+     * (resampling, the adaptive threshold, the auto-correlation function, the comb filter bank and the
+     * tempo model), rather than carried out in the frame in which the beat falls. This flattens the cost
+     * of each frame without a thread of its own. The new tempo is used from the fifth frame after the
+     * beat. Switching this on switches off asynchronous tempo estimation, and vice versa
+     * @param shouldAmortise true to spread the tempo estimation over several frames
+     */
+    void setAmortisedTempoEstimation (bool shouldAmortise);
+    
+    /** @returns true if the tempo estimation is spread over several frames */
+    bool isAmortisingTempoEstimation() const;
+    
+    /** Set which changes of tempo are considered at each tempo estimate (see TempoModel::setTransitionCutoff())
+     * @param cutoff the cutoff, relative to the probability of staying at the same tempo, or 0 to consider every change
+     */
+    void setTempoTransitionCutoff (double cutoff);
+    
+    /** Choose whether the tempo estimates are made with log probabilities, which need no normalisation
+     * @param shouldUseLogDomain true to use log probabilities
+     */
+    void setLogDomainTempoEstimation (bool shouldUseLogDomain);
+    
     //=======================================================================
-    /** Set the tempo of the beat tracker 
+    // The tempo can be set and fixed from any thread, while another thread is processing audio. The
+    // changes are held without locking the audio thread out, and made at the start of the next call
+    // to processAudioFrame() or processOnsetDetectionFunctionSample(). Only the latest change of each
+    // kind is made, so setting the tempo twice between frames sets it to the second tempo
+    
+    /** Set the tempo of the beat tracker. This takes effect at the start of the next frame
      * @param tempo the tempo in beats per minute (bpm)
      */
     void setTempo (double tempo);
     
     /** Fix tempo to roughly around some value, so that the algorithm will only try to track
-     * tempi around the given tempo
+     * tempi around the given tempo. This takes effect at the start of the next frame
      * @param tempo the tempo in beats per minute (bpm)
      */
     void fixTempo (double tempo);
     
-    /** Tell the algorithm to not fix the tempo anymore */
+    /** Tell the algorithm to not fix the tempo anymore. This takes effect at the start of the next frame */
     void doNotFixTempo();
     
+    /** Choose whether onset detection function samples for hop sizes of less than 512 samples
+     * (at 44.1kHz) are decimated, so that the beat tracker works at the rate of a 512 sample hop
+     * at 44.1kHz whatever the hop size and sample rate, and its cost per second does not grow as
+     * the hop size shrinks. Beats are still reported in the audio frame (or detection function
+     * sample) in which they fall. This resets the beat tracker, as changing the hop size does
+     * @param shouldDecimate true to decimate the onset detection function
+     */
+    void setDecimation (bool shouldDecimate);
+    
+    //=======================================================================
+    /** Set the FFT implementation used by both the onset detection function and the
+     * auto-correlation function. If the implementation was not compiled in, or does not
+     * support an FFT size, the default implementation is used for that FFT instead
+     * @param fftImplementation the FFT implementation to use (see FFTImplementation)
+     */
+    void setFFTImplementation (int fftImplementation);
+    
+    /** Set the quality of the resampling of the onset detection function to 512 samples before
+     * tempo estimation. This has no effect with a hop size of 512 at 44.1kHz, where no resampling is needed.
+     * The default is HighQualityResampling, which never allocates. LibsamplerateResampling reproduces
+     * earlier versions, but allocates on every tempo estimate
+     * @param quality the resampling quality (see ResamplingQuality)
+     */
+    void setResamplingQuality (int quality);
+    
+    /** Replace the comb filter bank applied to the auto-correlation function, for example to try
+     * a different comb shape. Row p - 1 of the bank gives the score for a beat period of p detection
+     * function samples (at the resampled rate of 512 samples per buffer)
+     * @param combFilterBank a bank of at most 128 rows, reading at most 512 lags
+     * @returns true if the bank was used, or false if it was too large
+     */
+    bool setCombFilterBank (const CombFilterBank& combFilterBank);
+    
+    /** @returns the comb filter bank applied to the auto-correlation function */
+    const CombFilterBank& getCombFilterBank() const;
+    
     //=======================================================================
     /** Calculates a beat time in seconds, given the frame number, hop size and sampling frequency.
      * This version uses a long to represent the frame number
@@ -109,52 +324,123 @@ public:
      * @param fs the sampling frequency in Hz
      * @returns a beat time in seconds
      */
-    static double getBeatTimeInSeconds (long frameNumber, int hopSize, int fs);
+    static double getBeatTimeInSeconds (long frameNumber, int hopSize, double fs);
     
 private:
     
+    //=======================================================================
+    /** The latest changes of tempo asked for by setTempo(), fixTempo() or doNotFixTempo() that have
+     * not been made yet. A change replaces any earlier one of the same kind, which it would have undone
+     * anyway, so no change is ever lost however many are asked for between samples. Each change is
+     * taken with a single atomic exchange, so any number of threads can ask for changes without
+     * locking out the thread that makes them
+     */
+    struct TempoCommands
+    {
+        TempoCommands()
+         :  tempo (std::numeric_limits<double>::quiet_NaN()),
+            fixedTempo (std::numeric_limits<double>::quiet_NaN())
+        {
+        }
+        
+        std::atomic<double> tempo;          /**< the tempo to set in beats per minute, or NaN if there is none */
+        std::atomic<double> fixedTempo;     /**< the tempo to fix in beats per minute, a negative number to stop fixing the tempo, or NaN if there is no change */
+    };
+    
+    //=======================================================================
     /** Initialises the algorithm, setting internal parameters and creating weighting vectors 
      * @param hopSize the hop size in audio samples
+     * @param sampleRate the sample rate of the audio in Hz
      */
-    void initialise (int hopSize);
+    void initialise (int hopSize, double sampleRate);
     
     /** Initialise with hop size and set all array sizes accordingly
      * @param hopSize the hop size in audio samples
      */
     void setHopSize (int hopSize);
     
+    /** Makes the changes of tempo asked for since the last sample */
+    void applyTempoCommands();
+    
+    /** Makes the changes to the tempo model passed on by applyTempoCommands(). This must be called by
+     * the thread that estimates the tempo */
+    void applyTempoModelCommands();
+    
+    /** Fills the onset detection function and cumulative score with beats at a tempo, and makes
+     * the current sample a beat
+     * @param tempo the tempo in beats per minute, within the tempo range
+     */
+    void applyTempo (double tempo);
+    
+    /** Adds an onset detection function sample, at the decimated rate, to the buffer and applies beat tracking
+     * @param sample an onset detection function sample
+     * @returns true if a beat is due at the sample
+     */
+    bool processDecimatedOnsetDetectionFunctionSample (SampleType sample);
+    
+    /** Adds an onset detection function sample to the block being averaged into the next decimated
+     * sample, processes the block once it is complete, and reports a beat if one is due in this hop
+     * @param sample an onset detection function sample
+     */
+    void decimateOnsetDetectionFunctionSample (SampleType sample);
+    
+    /** Publishes the state of the beat tracker after the current frame for getPublishedState() */
+    void publishState();
+    
+    /** Adds an event in the current frame to the event queue, if events are being queued
+     * @param type the type of event (see BTrackEventType)
+     * @param tempo the tempo of the event, in beats per minute
+     */
+    void queueEvent (int type, double tempo);
+    
     /** Resamples the onset detection function from an arbitrary number of samples to 512 */
     void resampleOnsetDetectionFunction();
     
+    /** Copies the onset detection function to the resampler's input */
+    void copyOnsetDetectionFunctionToResampler();
+    
     /** Updates the cumulative score function with a new onset detection function sample 
      * @param onsetDetectionFunctionSample an onset detection function sample
      */
-    void updateCumulativeScore (double onsetDetectionFunctionSample);
+    void updateCumulativeScore (SampleType onsetDetectionFunctionSample);
 	
-    /** Predicts the next beat, based upon the internal program state */
+    /** Predicts the next beat, based upon the internal program state, and moves the beat clock on
+     * to place the beat within its detection function sample */
     void predictBeat();
     
-    /** Calculates the current tempo expressed as the beat period in detection function samples */
-    void calculateTempo();
+    /** Estimates the tempo from the resampled onset detection function
+     * @returns the most likely tempo, in beats per minute
+     */
+    double calculateTempo();
     
-    /** Calculates an adaptive threshold which is used to remove low level energy from detection
-     * function and emphasise peaks 
-     * @param x a vector containing onset detection function samples
+    /** Carries out one of the stages of tempo estimation before the last
+     * @param stage the stage (see TempoEstimationStage)
      */
-    void adaptiveThreshold (std::vector<double>& x);
+    void performTempoEstimationStage (int stage);
     
-    /** Calculates the mean of values in a vector between index locations [startIndex, endIndex]
-     * @param vector a vector that contains the values we wish to find the mean from
-     * @param startIndex the start index from which we would like to calculate the mean
-     * @param endIndex the final index to which we would like to calculate the mean
-     * @returns the mean of the sub-section of the vector
+    /** Carries out the last stage of tempo estimation, applying the tempo model to the comb filter bank output
+     * @returns the most likely tempo, in beats per minute
      */
-    double calculateMeanOfVector (std::vector<double>& vector, int startIndex, int endIndex);
+    double calculateMostLikelyTempo();
     
-    /** Normalises a given array
-     * @param vector the vector we wish to normalise
+    /** Carries out the next stage of an amortised tempo estimation, if one is in progress */
+    void continueTempoEstimation();
+    
+    /** Carries out the remaining stages of an amortised tempo estimation, if one is in progress */
+    void finishTempoEstimation();
+    
+    /** Sets the beat period, in detection function samples, and the tempo estimate from a tempo
+     * @param tempo the tempo in beats per minute
      */
-    void normaliseVector (std::vector<double>& vector);
+    void setBeatPeriodFromTempo (double tempo);
+    
+    /** Resamples and estimates the tempo of the latest onset detection function handed to the
+     * tempo estimation thread, and hands the tempo back. This runs on the tempo estimation thread */
+    void estimateTempoAsynchronously();
+    
+    /** @returns a lock on the state used to estimate the tempo, which is held while the tempo
+     * estimation thread is estimating the tempo, or an unlocked lock if there is no such thread */
+    std::unique_lock<std::mutex> lockTempoEstimation();
     
     /** Calculates the balanced autocorrelation of the smoothed onset detection function
      * @param onsetDetectionFunction a vector containing the onset detection function
@@ -165,32 +451,42 @@ private:
     void calculateOutputOfCombFilterBank();
     
     /** Calculate a log gaussian transition weighting */
-    void createLogGaussianTransitionWeighting (double* weightingArray, int numSamples, double beatPeriod);
+    void createLogGaussianTransitionWeighting (SampleType* weightingArray, int numSamples, double beatPeriod);
+    
+    /** Recalculates the log gaussian transition weighting and the beat expectation window if the beat
+     * period or tightness have changed since they were last calculated. Call this whenever either changes */
+    void updateBeatPeriodWindows();
     
     /** Calculate a new cumulative score value */
     template <typename T>
-    double calculateNewCumulativeScoreValue (T cumulativeScoreArray, double* logGaussianTransitionWeighting, int startIndex, int endIndex, double onsetDetectionFunctionSample, double alphaWeightingFactor);
+    SampleType calculateNewCumulativeScoreValue (const T& cumulativeScoreArray, const SampleType* logGaussianTransitionWeighting, int startIndex, int endIndex, SampleType onsetDetectionFunctionSample, SampleType alphaWeightingFactor);
 	
     //=======================================================================
 
-    /** An OnsetDetectionFunction instance for calculating onset detection functions */
-    OnsetDetectionFunction odf;
+    /** An onset detection function instance for calculating onset detection functions */
+    DetectionFunction odf;
     
     //=======================================================================
 	// buffers
     
-    CircularBuffer onsetDF;                         /**< to hold onset detection function */
-    CircularBuffer cumulativeScore;                 /**< to hold cumulative score */
+    CircularBuffer<SampleType> onsetDF;             /**< to hold onset detection function */
+    CircularBuffer<SampleType> cumulativeScore;     /**< to hold cumulative score */
     
     std::vector<double> resampledOnsetDF;           /**< to hold resampled detection function */
     std::vector<double> acf;                        /**<  to hold autocorrelation function */
+    std::vector<double> acfLagWeights;              /**< the scaling of each lag of the autocorrelation function */
     std::vector<double> weightingVector;            /**<  to hold weighting vector */
     std::vector<double> combFilterBankOutput;       /**<  to hold comb filter output */
-    std::vector<double> tempoObservationVector;     /**<  to hold tempo version of comb filter output */
-    std::vector<double> delta;                      /**<  to hold final tempo candidate array */
-    std::vector<double> prevDelta;                  /**<  previous delta */
-    std::vector<double> prevDeltaFixed;             /**<  fixed tempo version of previous delta */
-    double tempoTransitionMatrix[41][41];           /**<  tempo transition matrix */
+    CombFilterBank combFilterBank;                  /**<  the comb filters applied to the autocorrelation function */
+    TempoModel<NumTempoStates> tempoModel;          /**<  chooses the tempo from the comb filter output */
+    AdaptiveThreshold adaptiveThreshold;            /**<  removes low level energy from the detection function and comb filter output to emphasise peaks */
+    
+    std::vector<SampleType> logGaussianTransitionWeighting; /**< the log gaussian transition weighting for the current beat period */
+    std::vector<double> beatExpectationWindow;      /**< the beat expectation window for the current beat period */
+    std::vector<SampleType> futureCumulativeScore;  /**< scratch space for predicting the cumulative score over the next beat */
+    int maxBeatPeriod;                              /**< the longest beat period the scratch space is allocated for */
+    double windowsBeatPeriod;                       /**< the beat period that the two windows above were calculated for */
+    double windowsTightness;                        /**< the tightness that the log gaussian transition weighting was calculated for */
     
 	//=======================================================================
     // parameters
@@ -202,25 +498,75 @@ private:
     int timeToNextPrediction;               /**< indicates when the next point to predict the next beat is */
     int timeToNextBeat;                     /**< keeps track of when the next beat is - will be zero when the beat is due, and is set elsewhere in the algorithm to be positive once a beat prediction is made */
     int hopSize;                            /**< the hop size being used by the algorithm */
+    double sampleRate;                      /**< the sample rate of the audio, in Hz */
+    int internalHopSize;                    /**< the hop size of the detection function samples the algorithm works with, after decimation */
+    bool decimationEnabled;                 /**< indicates whether the onset detection function is decimated for small hop sizes */
+    int decimationFactor;                   /**< the number of onset detection function samples averaged into each decimated sample */
+    int decimationCount;                    /**< the number of samples added to decimationSum so far */
+    SampleType decimationSum;               /**< the sum of the onset detection function samples for the next decimated sample */
+    int hopsToNextBeat;                     /**< when decimating, the number of hops until a beat is due, or -1 if no beat is due */
+    double beatPhase;                       /**< where the predicted beat falls within its detection function sample, from 0 at the start of the sample's hops to 1 at the end */
+    int beatSampleOffset;                   /**< where the beat due in the current frame falls within its hop, in audio samples */
+    double lastClockBeatPosition;           /**< the position of the last beat predicted by the beat clock, in detection function samples after the latest one */
+    double beatClockPeriod;                 /**< the period of the beat clock, in detection function samples (see predictBeat()) */
     int onsetDFBufferSize;                  /**< the onset detection function buffer size */
-    bool tempoFixed;                        /**< indicates whether the tempo should be fixed or not */
     bool beatDueInFrame;                    /**< indicates whether a beat is due in the current frame */
     int FFTLengthForACFCalculation;         /**< the FFT length for the auto-correlation function calculation */
     
-#ifdef USE_FFTW
-    fftw_plan acfForwardFFT;                /**< forward fftw plan for calculating auto-correlation function */
-    fftw_plan acfBackwardFFT;               /**< inverse fftw plan for calculating auto-correlation function */
-    fftw_complex* complexIn;                /**< to hold complex fft values for input */
-    fftw_complex* complexOut;               /**< to hold complex fft values for output */
-#endif
+    std::unique_ptr<FFT<double>> acfFFT;    /**< real FFT for calculating the auto-correlation function */
     
-#ifdef USE_KISS_FFT
-    kiss_fft_cfg cfgForwards;               /**< Kiss FFT configuration */
-    kiss_fft_cfg cfgBackwards;              /**< Kiss FFT configuration */
-    kiss_fft_cpx* fftIn;                    /**< FFT input samples, in complex form */
-    kiss_fft_cpx* fftOut;                   /**< FFT output samples, in complex form */
-#endif
+    Resampler resampler;                    /**< resamples the onset detection function to 512 samples */
+    int resamplingQuality;                  /**< the resampling quality (see ResamplingQuality) */
+    
+    //=======================================================================
+    // control
+    
+    TempoCommands tempoCommands;                /**< changes of tempo asked for by any thread, made at the start of the next sample */
+    
+    SeqLock<BTrackState> publishedState;        /**< the state after the latest frame, for other threads to read */
+    long numFramesProcessed;                    /**< the number of frames processed since the beat tracker was created or reset */
+    long lastBeatFrameIndex;                    /**< the index of the latest frame in which a beat was due, or -1 */
+    
+    LockFreeQueue<BTrackEvent> events;          /**< beats and changes of tempo, for another thread to take */
+    bool queueingEvents;                        /**< indicates whether events are added to the event queue */
+    bool tempoFixed;                            /**< indicates whether the tempo was last fixed or not fixed, for the events */
+    double lastQueuedTempo;                     /**< the tempo estimate when the event queue was last checked for changes of tempo */
+    
+    //=======================================================================
+    // asynchronous and amortised tempo estimation
+    
+    /** The stages of tempo estimation, which amortised tempo estimation spreads over several samples */
+    enum TempoEstimationStage
+    {
+        ResamplingStage,
+        ThresholdingStage,
+        AutoCorrelationStage,
+        CombFilteringStage,
+        TempoModelStage,
+        NoTempoEstimationStage
+    };
+    
+    bool amortisingTempoEstimation;                         /**< indicates whether the tempo estimation is spread over several samples */
+    int nextTempoEstimationStage;                           /**< the stage of amortised tempo estimation to carry out next (see TempoEstimationStage) */
+    
+    TripleBuffer<std::vector<double>> onsetDFSnapshots;     /**< copies of the onset detection function for the tempo estimation thread */
+    TripleBuffer<double> tempoEstimates;                    /**< tempi estimated by the tempo estimation thread */
+    TempoCommands tempoModelCommands;                       /**< changes to the tempo model for the thread that estimates the tempo to make */
+    std::unique_ptr<WorkerThread> tempoEstimationThread;    /**< the tempo estimation thread, when the tempo is estimated asynchronously */
 
 };
 
+//=======================================================================
+/** The double precision beat tracker, which is the reference implementation */
+typedef BasicBTrack<double> BTrack;
+
+/** The single precision beat tracker */
+typedef BasicBTrack<float> BTrackFloat;
+
+/** The double precision beat tracker, with any number of tempi (see TempoRange) */
+typedef BasicBTrack<double, StaticOnsetDetectionFunction<ComplexSpectralDifferenceHWR, HanningWindow, double>, DynamicNumTempoStates> BTrackDynamicTempoStates;
+
+/** The single precision beat tracker, with any number of tempi (see TempoRange) */
+typedef BasicBTrack<float, StaticOnsetDetectionFunction<ComplexSpectralDifferenceHWR, HanningWindow, float>, DynamicNumTempoStates> BTrackDynamicTempoStatesFloat;
+
 #endif
@@ -0,0 +1,426 @@
+//=======================================================================
+/** @file BuiltInFFT.h
+ *  @brief A header-only real FFT that needs no external library
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#ifndef __BUILTINFFT_H
+#define __BUILTINFFT_H
+
+#include "FFT.h"
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+//=======================================================================
+/** The bit reversal and twiddle factor tables for a BuiltInFFT, which are shared through
+ * FFTPlanCache by every BuiltInFFT of the same size and sample type
+ *
+ * @tparam SampleType the type of the twiddle factors (float or double)
+ */
+template <typename SampleType>
+struct BuiltInFFTTables
+{
+    /** Constructor
+     * @param size the size of the real FFT, N
+     */
+    BuiltInFFTTables (int size)
+     :  powerOfTwo ((size & (size - 1)) == 0),
+        complexSize ((size % 2) == 0 ? size / 2 : size),
+        bitReversedIndices (complexSize),
+        complexTwiddles (2 * complexSize),
+        realTwiddles (2 * ((size / 2) + 1))
+    {
+        const double pi = 3.14159265358979323846;
+        int halfSize = size / 2;
+        int numBits = 0;
+
+        while ((1 << numBits) < complexSize)
+            numBits++;
+
+        // the mixed radix FFT takes its input in natural order, so it leaves the indices unreversed
+        for (int i = 0; i < complexSize; i++)
+        {
+            int reversed = 0;
+
+            for (int bit = 0; bit < numBits; bit++)
+                reversed |= ((i >> bit) & 1) << (numBits - 1 - bit);
+
+            bitReversedIndices[i] = powerOfTwo ? reversed : i;
+        }
+
+        // exp (-2 pi i k / M) for the complex FFT of size M
+        for (int k = 0; k < complexSize; k++)
+        {
+            complexTwiddles[2 * k] = static_cast<SampleType> (cos (2. * pi * k / complexSize));
+            complexTwiddles[(2 * k) + 1] = static_cast<SampleType> (-sin (2. * pi * k / complexSize));
+        }
+
+        // exp (-2 pi i k / N) for separating the spectra of the even and odd samples
+        for (int k = 0; k <= halfSize; k++)
+        {
+            realTwiddles[2 * k] = static_cast<SampleType> (cos (2. * pi * k / size));
+            realTwiddles[(2 * k) + 1] = static_cast<SampleType> (-sin (2. * pi * k / size));
+        }
+
+        // factorise M for the mixed radix FFT, as pairs of the radix p and the remaining length m
+        int remaining = complexSize;
+        int radix = 4;
+
+        while (! powerOfTwo && remaining > 1)
+        {
+            while ((remaining % radix) != 0)
+            {
+                // after 4, try 2, then 3, 5, 7 and so on
+                if (radix == 4)
+                    radix = 2;
+                else if (radix == 2)
+                    radix = 3;
+                else
+                    radix += 2;
+
+                // the remaining length is prime
+                if (radix * radix > remaining)
+                    radix = remaining;
+            }
+
+            remaining /= radix;
+            factors.push_back (radix);
+            factors.push_back (remaining);
+            largestFactor = std::max (largestFactor, radix);
+        }
+    }
+
+    bool powerOfTwo;                            /**< true if N is a power of two, so that the radix-2 FFT can be used */
+    int complexSize;                            /**< the size of the complex FFT, M, which is N / 2 for even N and N for odd N */
+    std::vector<int> factors;                   /**< for other sizes, the radix p and remaining length m of each stage of the mixed radix FFT */
+    int largestFactor = 1;                      /**< the largest radix in factors */
+    std::vector<int> bitReversedIndices;        /**< the bit reversed position of each index of the complex FFT */
+    std::vector<SampleType> complexTwiddles;    /**< the twiddle factors of the complex FFT */
+    std::vector<SampleType> realTwiddles;       /**< the twiddle factors used to separate the even and odd spectra */
+};
+
+//=======================================================================
+/** A real FFT that needs no external library. A real FFT of even size N is carried out as a complex
+ * FFT of size N / 2 on the even and odd samples packed together as real and imaginary parts,
+ * followed by a pass that separates their spectra. For power of two sizes the complex FFT is an
+ * in-place radix-2 decimation in time FFT, with the bit reversal and twiddle factors calculated
+ * once per size and shared (see BuiltInFFTTables). Other even sizes use a recursive mixed radix FFT,
+ * which splits N / 2 into factors of 4, 2, 3 and 5 (and any larger primes, at a cost of O(N p) each).
+ * Odd sizes cannot be split into even and odd samples, so they use a mixed radix complex FFT of
+ * size N on the real samples, which costs about twice as much as an even size would.
+ * It works in the sample type, so it never needs to convert its buffers.
+ *
+ * @tparam SampleType the type of the samples in the buffers (float or double)
+ */
+template <typename SampleType>
+class BuiltInFFT : public FFT<SampleType>
+{
+public:
+
+    /** Constructor
+     * @param size the size of the FFT, which must be at least 2 (see isSupported())
+     */
+    BuiltInFFT (int size)
+     :  tables (FFTPlanCache::getPlan<BuiltInFFTTables<SampleType>> (BuiltInFFTImplementation, sizeof (SampleType), size, BidirectionalFFTPlan, 0, size)),
+        halfSize (size / 2),
+        complexSize (tables->complexSize),
+        realBuffer (size),
+        complexBuffer (2 * ((size / 2) + 1)),
+        workBuffer (2 * tables->complexSize),
+        mixedRadixInput (tables->powerOfTwo ? 0 : 2 * tables->complexSize),
+        mixedRadixScratch (2 * tables->largestFactor),
+        bitReversedIndices (tables->bitReversedIndices.data()),
+        complexTwiddles (tables->complexTwiddles.data()),
+        realTwiddles (tables->realTwiddles.data())
+    {
+    }
+
+    //=======================================================================
+    /** @returns true if the built-in FFT supports the given size, which it does for every size of 2 or more
+     * @param size the size of the FFT
+     */
+    static bool isSupported (int size)
+    {
+        return size >= 2;
+    }
+
+    //=======================================================================
+    int getImplementation() const override
+    {
+        return BuiltInFFTImplementation;
+    }
+
+    SampleType* getRealBuffer() override
+    {
+        return realBuffer.data();
+    }
+
+    SampleType* getComplexBuffer() override
+    {
+        return complexBuffer.data();
+    }
+
+    //=======================================================================
+    void performForwardTransform() override
+    {
+        const SampleType* x = realBuffer.data();
+        SampleType* z = workBuffer.data();
+        SampleType* X = complexBuffer.data();
+
+        if (complexSize != halfSize)
+        {
+            // for odd sizes, the first (N + 1) / 2 bins of the complex FFT of the real samples
+            for (int n = 0; n < complexSize; n++)
+            {
+                z[2 * n] = x[n];
+                z[(2 * n) + 1] = 0;
+            }
+
+            performComplexTransform (false);
+            std::copy (z, z + (2 * (halfSize + 1)), X);
+            return;
+        }
+
+        // z[k] = x[2k] + i x[2k + 1], in bit reversed order
+        for (int k = 0; k < halfSize; k++)
+        {
+            int j = bitReversedIndices[k];
+            z[2 * j] = x[2 * k];
+            z[(2 * j) + 1] = x[(2 * k) + 1];
+        }
+
+        performComplexTransform (false);
+
+        // the spectra of the even and odd samples are E[k] = (Z[k] + conj (Z[M - k])) / 2 and
+        // O[k] = -i (Z[k] - conj (Z[M - k])) / 2, and X[k] = E[k] + exp (-2 pi i k / N) O[k]
+        X[0] = z[0] + z[1];
+        X[1] = 0;
+        X[2 * halfSize] = z[0] - z[1];
+        X[(2 * halfSize) + 1] = 0;
+
+        for (int k = 1; k < halfSize; k++)
+        {
+            SampleType zr = z[2 * k];
+            SampleType zi = z[(2 * k) + 1];
+            SampleType cr = z[2 * (halfSize - k)];
+            SampleType ci = -z[(2 * (halfSize - k)) + 1];
+
+            SampleType er = SampleType (0.5) * (zr + cr);
+            SampleType ei = SampleType (0.5) * (zi + ci);
+            SampleType or_ = SampleType (0.5) * (zi - ci);
+            SampleType oi = SampleType (-0.5) * (zr - cr);
+
+            SampleType wr = realTwiddles[2 * k];
+            SampleType wi = realTwiddles[(2 * k) + 1];
+
+            X[2 * k] = er + (wr * or_) - (wi * oi);
+            X[(2 * k) + 1] = ei + (wr * oi) + (wi * or_);
+        }
+    }
+
+    //=======================================================================
+    void performInverseTransform() override
+    {
+        const SampleType* X = complexBuffer.data();
+        SampleType* z = workBuffer.data();
+        SampleType* x = realBuffer.data();
+
+        if (complexSize != halfSize)
+        {
+            // for odd sizes, fill in the upper half of the spectrum as the conjugates of the
+            // lower half, and keep the real part of its inverse complex FFT
+            std::copy (X, X + (2 * (halfSize + 1)), z);
+
+            for (int k = 1; k <= halfSize; k++)
+            {
+                z[2 * (complexSize - k)] = X[2 * k];
+                z[(2 * (complexSize - k)) + 1] = -X[(2 * k) + 1];
+            }
+
+            performComplexTransform (true);
+
+            for (int n = 0; n < complexSize; n++)
+                x[n] = z[2 * n];
+
+            return;
+        }
+
+        // reverse the separation above, with Z[k] = E[k] + i O[k], where E[k] = X[k] + conj (X[M - k])
+        // and O[k] = (X[k] - conj (X[M - k])) exp (2 pi i k / N), leaving out the factor of a half so
+        // that the result is scaled by N
+        for (int k = 0; k < halfSize; k++)
+        {
+            SampleType xr = X[2 * k];
+            SampleType xi = X[(2 * k) + 1];
+            SampleType cr = X[2 * (halfSize - k)];
+            SampleType ci = -X[(2 * (halfSize - k)) + 1];
+
+            SampleType er = xr + cr;
+            SampleType ei = xi + ci;
+            SampleType dr = xr - cr;
+            SampleType di = xi - ci;
+
+            SampleType wr = realTwiddles[2 * k];
+            SampleType wi = -realTwiddles[(2 * k) + 1];
+
+            SampleType or_ = (dr * wr) - (di * wi);
+            SampleType oi = (dr * wi) + (di * wr);
+
+            int j = bitReversedIndices[k];
+            z[2 * j] = er - oi;
+            z[(2 * j) + 1] = ei + or_;
+        }
+
+        performComplexTransform (true);
+
+        for (int k = 0; k < halfSize; k++)
+        {
+            x[2 * k] = z[2 * k];
+            x[(2 * k) + 1] = z[(2 * k) + 1];
+        }
+    }
+
+private:
+
+    /** Carries out an unnormalised complex FFT of size M on the work buffer, which should be in bit reversed order
+     * @param inverse if true, the inverse transform is calculated
+     */
+    void performComplexTransform (bool inverse)
+    {
+        SampleType* z = workBuffer.data();
+        SampleType sign = inverse ? SampleType (-1) : SampleType (1);
+
+        if (! tables->powerOfTwo)
+        {
+            std::copy (workBuffer.begin(), workBuffer.end(), mixedRadixInput.begin());
+
+            if (complexSize > 1)
+                performMixedRadixTransform (z, mixedRadixInput.data(), 1, tables->factors.data(), sign);
+
+            return;
+        }
+
+        for (int blockSize = 2; blockSize <= complexSize; blockSize *= 2)
+        {
+            int halfBlockSize = blockSize / 2;
+            int twiddleStep = complexSize / blockSize;
+
+            for (int start = 0; start < complexSize; start += blockSize)
+            {
+                for (int j = 0; j < halfBlockSize; j++)
+                {
+                    SampleType wr = complexTwiddles[2 * j * twiddleStep];
+                    SampleType wi = sign * complexTwiddles[(2 * j * twiddleStep) + 1];
+
+                    int a = 2 * (start + j);
+                    int b = 2 * (start + j + halfBlockSize);
+
+                    SampleType tr = (wr * z[b]) - (wi * z[b + 1]);
+                    SampleType ti = (wr * z[b + 1]) + (wi * z[b]);
+
+                    z[b] = z[a] - tr;
+                    z[b + 1] = z[a + 1] - ti;
+                    z[a] = z[a] + tr;
+                    z[a + 1] = z[a + 1] + ti;
+                }
+            }
+        }
+    }
+
+    /** Carries out one stage of an unnormalised mixed radix complex FFT, decimating in time. The
+     * p sub-transforms of length m are calculated first, then combined with radix p butterflies
+     * @param output where to write the m * p complex outputs
+     * @param input the first complex input, whose others are stride complex values apart
+     * @param stride the distance between the inputs of this stage
+     * @param factors the radix p and length m of this stage, followed by those of the later stages
+     * @param sign 1 for the forward transform, -1 for the inverse transform
+     */
+    void performMixedRadixTransform (SampleType* output, const SampleType* input, int stride, const int* factors, SampleType sign)
+    {
+        int p = factors[0];
+        int m = factors[1];
+
+        if (m == 1)
+        {
+            for (int q = 0; q < p; q++)
+            {
+                output[2 * q] = input[2 * q * stride];
+                output[(2 * q) + 1] = input[(2 * q * stride) + 1];
+            }
+        }
+        else
+        {
+            for (int q = 0; q < p; q++)
+                performMixedRadixTransform (output + (2 * q * m), input + (2 * q * stride), stride * p, factors + 2, sign);
+        }
+
+        SampleType* scratch = mixedRadixScratch.data();
+
+        for (int u = 0; u < m; u++)
+        {
+            for (int q = 0; q < p; q++)
+            {
+                scratch[2 * q] = output[2 * (u + (q * m))];
+                scratch[(2 * q) + 1] = output[(2 * (u + (q * m))) + 1];
+            }
+
+            // output k is the sum of the sub-transforms at u, each multiplied by exp (-2 pi i stride k q / M)
+            for (int q1 = 0; q1 < p; q1++)
+            {
+                int k = u + (q1 * m);
+                SampleType sumReal = scratch[0];
+                SampleType sumImag = scratch[1];
+                int twiddleIndex = 0;
+
+                for (int q = 1; q < p; q++)
+                {
+                    twiddleIndex += stride * k;
+
+                    if (twiddleIndex >= complexSize)
+                        twiddleIndex -= complexSize;
+
+                    SampleType wr = complexTwiddles[2 * twiddleIndex];
+                    SampleType wi = sign * complexTwiddles[(2 * twiddleIndex) + 1];
+
+                    sumReal += (wr * scratch[2 * q]) - (wi * scratch[(2 * q) + 1]);
+                    sumImag += (wr * scratch[(2 * q) + 1]) + (wi * scratch[2 * q]);
+                }
+
+                output[2 * k] = sumReal;
+                output[(2 * k) + 1] = sumImag;
+            }
+        }
+    }
+
+    std::shared_ptr<const BuiltInFFTTables<SampleType>> tables; /**< the tables shared with other FFTs of this size */
+    int halfSize;                               /**< N / 2, rounded down */
+    int complexSize;                            /**< the size of the complex FFT, M (see BuiltInFFTTables) */
+
+    std::vector<SampleType> realBuffer;         /**< N real values */
+    std::vector<SampleType> complexBuffer;      /**< (N / 2) + 1 interleaved complex values */
+    std::vector<SampleType> workBuffer;         /**< M interleaved complex values for the complex FFT */
+    std::vector<SampleType> mixedRadixInput;    /**< a copy of the work buffer, as the input of the mixed radix FFT */
+    std::vector<SampleType> mixedRadixScratch;  /**< the inputs of one mixed radix butterfly */
+
+    const int* bitReversedIndices;              /**< the bit reversed position of each index of the complex FFT */
+    const SampleType* complexTwiddles;          /**< the twiddle factors of the complex FFT */
+    const SampleType* realTwiddles;             /**< the twiddle factors used to separate the even and odd spectra */
+};
+
+#endif
@@ -23,13 +23,16 @@
 #define CircularBuffer_h
 
 #include <vector>
+#include <algorithm>
 
 //=======================================================================
 /** A circular buffer that allows you to add new samples to the end
  * whilst removing them from the beginning. This is implemented in an
  * efficient way which doesn't involve any memory allocation as samples
  * are added to the end of the buffer
+ * @tparam SampleType the type of the samples held (float or double)
  */
+template <typename SampleType = double>
 class CircularBuffer
 {
 public:
@@ -42,14 +45,21 @@ public:
     }
     
     /** Access the ith element in the buffer */
-    double &operator[] (int i)
+    SampleType &operator[] (int i)
+    {
+        int index = (i + writeIndex) % buffer.size();
+        return buffer[index];
+    }
+    
+    /** Access the ith element in the buffer */
+    const SampleType &operator[] (int i) const
     {
         int index = (i + writeIndex) % buffer.size();
         return buffer[index];
     }
     
     /** Add a new sample to the end of the buffer */
-    void addSampleToEnd (double v)
+    void addSampleToEnd (SampleType v)
     {
         buffer[writeIndex] = v;
         writeIndex = (writeIndex + 1) % buffer.size();
@@ -59,7 +69,7 @@ public:
     void resize (int size)
     {
         buffer.resize (size);
-        std::fill (buffer.begin(), buffer.end(), 0.0);
+        std::fill (buffer.begin(), buffer.end(), SampleType (0));
         writeIndex = 0;
     }
     
@@ -71,7 +81,7 @@ public:
     
 private:
     
-    std::vector<double> buffer;
+    std::vector<SampleType> buffer;
     int writeIndex;
 };
 
@@ -0,0 +1,117 @@
+//=======================================================================
+/** @file CombFilterBank.cpp
+ *  @brief A comb filter bank held as a sparse matrix
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#include <algorithm>
+#include "CombFilterBank.h"
+
+//=======================================================================
+CombFilterBank::CombFilterBank()
+{
+    clear();
+}
+
+//=======================================================================
+CombFilterBank CombFilterBank::createBalancedCombFilterBank (const std::vector<double>& periodWeighting, int minPeriod, int maxPeriod, int numCombElements)
+{
+    CombFilterBank combFilterBank;
+
+    for (int period = 1; period <= (int) periodWeighting.size(); period++)
+    {
+        combFilterBank.addRow();
+
+        if (period < minPeriod || period > maxPeriod)
+            continue;
+
+        for (int a = 1; a <= numCombElements; a++) // number of comb elements
+        {
+            // normalise each comb element by its width
+            double weight = periodWeighting[period - 1] / (2 * a - 1);
+
+            for (int b = 1 - a; b <= a - 1; b++)
+                combFilterBank.addTap ((a * period + b) - 1, weight);
+        }
+    }
+
+    return combFilterBank;
+}
+
+//=======================================================================
+void CombFilterBank::clear()
+{
+    rowStarts.assign (1, 0);
+    lags.clear();
+    weights.clear();
+    inputLength = 0;
+}
+
+//=======================================================================
+void CombFilterBank::addRow()
+{
+    rowStarts.push_back ((int) lags.size());
+}
+
+//=======================================================================
+void CombFilterBank::addTap (int lag, double weight)
+{
+    if (getNumRows() == 0)
+        addRow();
+
+    lags.push_back (lag);
+    weights.push_back (weight);
+    rowStarts.back()++;
+    inputLength = std::max (inputLength, lag + 1);
+}
+
+//=======================================================================
+int CombFilterBank::getNumRows() const
+{
+    return (int) rowStarts.size() - 1;
+}
+
+//=======================================================================
+int CombFilterBank::getNumTaps() const
+{
+    return (int) lags.size();
+}
+
+//=======================================================================
+int CombFilterBank::getInputLength() const
+{
+    return inputLength;
+}
+
+//=======================================================================
+void CombFilterBank::process (const double* input, double* output) const
+{
+    const int* lag = lags.data();
+    const double* weight = weights.data();
+    int numRows = getNumRows();
+
+    for (int row = 0; row < numRows; row++)
+    {
+        double sum = 0;
+
+        for (int tap = rowStarts[row]; tap < rowStarts[row + 1]; tap++)
+            sum += input[lag[tap]] * weight[tap];
+
+        output[row] = sum;
+    }
+}
@@ -0,0 +1,92 @@
+//=======================================================================
+/** @file CombFilterBank.h
+ *  @brief A comb filter bank held as a sparse matrix
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#ifndef __COMBFILTERBANK_H
+#define __COMBFILTERBANK_H
+
+#include <vector>
+
+//=======================================================================
+/** A bank of comb filters applied to the auto-correlation function. Each row of the bank is one
+ * beat period, and its output is a weighted sum of auto-correlation function lags. The rows are
+ * stored as a sparse matrix in compressed sparse row form, so the weights are calculated once and
+ * each tempo estimate is a single sparse matrix-vector product.
+ *
+ * The default bank is made by createBalancedCombFilterBank(). Other comb shapes or period
+ * ranges can be built with addRow() and addTap() and given to the beat tracker instead.
+ */
+class CombFilterBank
+{
+public:
+
+    /** Constructor, which creates an empty bank */
+    CombFilterBank();
+
+    /** Creates the comb filter bank used by BTrack. Row p - 1 is the comb filter for a beat period of
+     * p lags, for p from minPeriod to maxPeriod, and sums numCombElements comb elements. Element a
+     * covers the 2a - 1 lags around a * p, each weighted by periodWeighting[p - 1] / (2a - 1).
+     * @param periodWeighting the weighting of each beat period (with at least maxPeriod values)
+     * @param minPeriod the shortest beat period, in lags
+     * @param maxPeriod the longest beat period, in lags
+     * @param numCombElements the number of comb elements
+     * @returns the comb filter bank, with periodWeighting.size() rows
+     */
+    static CombFilterBank createBalancedCombFilterBank (const std::vector<double>& periodWeighting, int minPeriod, int maxPeriod, int numCombElements);
+
+    //=======================================================================
+    /** Removes every row from the bank */
+    void clear();
+
+    /** Adds a row with no taps to the end of the bank */
+    void addRow();
+
+    /** Adds a tap to the last row of the bank
+     * @param lag the index of the auto-correlation function value the tap multiplies
+     * @param weight the weight of the tap
+     */
+    void addTap (int lag, double weight);
+
+    //=======================================================================
+    /** @returns the number of rows, which is the number of outputs */
+    int getNumRows() const;
+
+    /** @returns the number of taps in every row together */
+    int getNumTaps() const;
+
+    /** @returns the number of auto-correlation function values the bank reads (one more than the largest lag) */
+    int getInputLength() const;
+
+    //=======================================================================
+    /** Calculates the output of every row of the bank
+     * @param input the auto-correlation function, with at least getInputLength() values
+     * @param output an array of getNumRows() values to write the outputs to
+     */
+    void process (const double* input, double* output) const;
+
+private:
+
+    std::vector<int> rowStarts;             /**< the index of each row's first tap, followed by the total number of taps */
+    std::vector<int> lags;                  /**< the auto-correlation function lag of each tap */
+    std::vector<double> weights;            /**< the weight of each tap */
+    int inputLength;                        /**< one more than the largest lag */
+};
+
+#endif
@@ -0,0 +1,395 @@
+//=======================================================================
+/** @file FFT.cpp
+ *  @brief The FFTW and Kiss FFT implementations of the FFT interface
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <vector>
+#include "FFT.h"
+#include "BuiltInFFT.h"
+
+#ifdef USE_FFTW
+#include "fftw3.h"
+#endif
+
+#ifdef USE_KISS_FFT
+#include "kiss_fftr.h"
+#endif
+
+//=======================================================================
+static std::atomic<bool> useFFTWMeasure (false);
+
+//=======================================================================
+void FFTPlanCache::setFFTWMeasure (bool shouldMeasure)
+{
+    useFFTWMeasure = shouldMeasure;
+}
+
+//=======================================================================
+bool FFTPlanCache::isUsingFFTWMeasure()
+{
+    return useFFTWMeasure;
+}
+
+//=======================================================================
+bool FFTPlanCache::importFFTWWisdom (const std::string& fileName)
+{
+#ifdef USE_FFTW
+    std::lock_guard<std::mutex> lock (getLock());
+    return fftw_import_wisdom_from_filename (fileName.c_str()) != 0;
+#else
+    (void) fileName;
+    return false;
+#endif
+}
+
+//=======================================================================
+bool FFTPlanCache::exportFFTWWisdom (const std::string& fileName)
+{
+#ifdef USE_FFTW
+    std::lock_guard<std::mutex> lock (getLock());
+    return fftw_export_wisdom_to_filename (fileName.c_str()) != 0;
+#else
+    (void) fileName;
+    return false;
+#endif
+}
+
+//=======================================================================
+int FFTPlanCache::getNumPlans()
+{
+    std::lock_guard<std::mutex> lock (getLock());
+    return static_cast<int> (getPlans().size());
+}
+
+//=======================================================================
+std::mutex& FFTPlanCache::getLock()
+{
+    static std::mutex lock;
+    return lock;
+}
+
+//=======================================================================
+std::map<FFTPlanCache::Key, std::weak_ptr<const void>>& FFTPlanCache::getPlans()
+{
+    static std::map<Key, std::weak_ptr<const void>> plans;
+    return plans;
+}
+
+//=======================================================================
+/** Presents a buffer belonging to an FFT library in the sample type. If the library works in
+ * a different precision, a copy is kept in the sample type and converted to and from the
+ * library's buffer around each transform.
+ */
+template <typename NativeType, typename SampleType>
+class ConvertingBuffer
+{
+public:
+    void setNativeBuffer (NativeType* buffer, int bufferSize)
+    {
+        nativeBuffer = buffer;
+        converted.resize (bufferSize);
+    }
+
+    SampleType* getBuffer()
+    {
+        return converted.data();
+    }
+
+    void copyToNativeBuffer()
+    {
+        std::copy (converted.begin(), converted.end(), nativeBuffer);
+    }
+
+    void copyFromNativeBuffer()
+    {
+        std::copy (nativeBuffer, nativeBuffer + converted.size(), converted.begin());
+    }
+
+private:
+    NativeType* nativeBuffer = nullptr;
+    std::vector<SampleType> converted;
+};
+
+//=======================================================================
+/** If the library works in the sample type, its buffer is used directly and nothing is copied */
+template <typename SampleType>
+class ConvertingBuffer<SampleType, SampleType>
+{
+public:
+    void setNativeBuffer (SampleType* buffer, int)
+    {
+        nativeBuffer = buffer;
+    }
+
+    SampleType* getBuffer()
+    {
+        return nativeBuffer;
+    }
+
+    void copyToNativeBuffer() {}
+    void copyFromNativeBuffer() {}
+
+private:
+    SampleType* nativeBuffer = nullptr;
+};
+
+#ifdef USE_FFTW
+//=======================================================================
+/** An FFTW plan in one direction, shared through FFTPlanCache. It is made on arrays of its own,
+ * which are freed once it is planned, and executed on each FFT's arrays with FFTW's new-array
+ * execute functions. fftw_malloc() gives every array the same alignment, as those require.
+ */
+struct FFTWPlan
+{
+    FFTWPlan (int size, int direction, bool measure)
+    {
+        double* real = (double*) fftw_malloc (sizeof(double) * size);
+        fftw_complex* complex = (fftw_complex*) fftw_malloc (sizeof(fftw_complex) * ((size / 2) + 1));
+        unsigned int flags = measure ? FFTW_MEASURE : FFTW_ESTIMATE;
+
+        if (direction == ForwardFFTPlan)
+            plan = fftw_plan_dft_r2c_1d (size, real, complex, flags);
+        else
+            plan = fftw_plan_dft_c2r_1d (size, complex, real, flags);
+
+        fftw_free (real);
+        fftw_free (complex);
+    }
+
+    ~FFTWPlan()
+    {
+        fftw_destroy_plan (plan);
+    }
+
+    fftw_plan plan;
+};
+
+//=======================================================================
+/** A real FFT using FFTW (double precision) */
+template <typename SampleType>
+class FFTWFFT : public FFT<SampleType>
+{
+public:
+    FFTWFFT (int size)
+    {
+        int numBins = (size / 2) + 1;
+        bool measure = FFTPlanCache::isUsingFFTWMeasure();
+
+        forwardPlan = FFTPlanCache::getPlan<FFTWPlan> (FFTWImplementation, sizeof (double), size, ForwardFFTPlan, measure, size, ForwardFFTPlan, measure);
+        inversePlan = FFTPlanCache::getPlan<FFTWPlan> (FFTWImplementation, sizeof (double), size, InverseFFTPlan, measure, size, InverseFFTPlan, measure);
+
+        realIn = (double*) fftw_malloc (sizeof(double) * size);
+        complexOut = (fftw_complex*) fftw_malloc (sizeof(fftw_complex) * numBins);
+
+        // fftw_complex is laid out as a real part followed by an imaginary part
+        realBuffer.setNativeBuffer (realIn, size);
+        complexBuffer.setNativeBuffer (reinterpret_cast<double*> (complexOut), 2 * numBins);
+    }
+
+    ~FFTWFFT()
+    {
+        fftw_free (realIn);
+        fftw_free (complexOut);
+    }
+
+    int getImplementation() const override              { return FFTWImplementation; }
+    SampleType* getRealBuffer() override                { return realBuffer.getBuffer(); }
+    SampleType* getComplexBuffer() override             { return complexBuffer.getBuffer(); }
+
+    void performForwardTransform() override
+    {
+        realBuffer.copyToNativeBuffer();
+        fftw_execute_dft_r2c (forwardPlan->plan, realIn, complexOut);
+        complexBuffer.copyFromNativeBuffer();
+    }
+
+    void performInverseTransform() override
+    {
+        complexBuffer.copyToNativeBuffer();
+        fftw_execute_dft_c2r (inversePlan->plan, complexOut, realIn);
+        realBuffer.copyFromNativeBuffer();
+    }
+
+private:
+    std::shared_ptr<const FFTWPlan> forwardPlan;        /**< shared fftw plan (real-to-complex) */
+    std::shared_ptr<const FFTWPlan> inversePlan;        /**< shared fftw plan (complex-to-real) */
+    double* realIn;                                     /**< to hold real fft values */
+    fftw_complex* complexOut;                           /**< to hold complex fft values */
+
+    ConvertingBuffer<double, SampleType> realBuffer;
+    ConvertingBuffer<double, SampleType> complexBuffer;
+};
+#endif
+
+#ifdef USE_KISS_FFT
+//=======================================================================
+/** A real FFT using Kiss FFT (in kiss_fft_scalar, which is float unless configured otherwise).
+ * kiss_fftr() works in a scratch buffer held inside its configuration, so unlike the other
+ * implementations the configurations cannot be shared between FFTs and are not cached.
+ */
+template <typename SampleType>
+class KissFFT : public FFT<SampleType>
+{
+public:
+    KissFFT (int size)
+     :  fftIn (size),
+        fftOut ((size / 2) + 1)
+    {
+        cfgForwards = kiss_fftr_alloc (size, 0, 0, 0);
+        cfgBackwards = kiss_fftr_alloc (size, 1, 0, 0);
+
+        // kiss_fft_cpx is laid out as a real part followed by an imaginary part
+        realBuffer.setNativeBuffer (fftIn.data(), size);
+        complexBuffer.setNativeBuffer (reinterpret_cast<kiss_fft_scalar*> (fftOut.data()), 2 * (int) fftOut.size());
+    }
+
+    ~KissFFT()
+    {
+        free (cfgForwards);
+        free (cfgBackwards);
+    }
+
+    int getImplementation() const override              { return KissFFTImplementation; }
+    SampleType* getRealBuffer() override                { return realBuffer.getBuffer(); }
+    SampleType* getComplexBuffer() override             { return complexBuffer.getBuffer(); }
+
+    void performForwardTransform() override
+    {
+        realBuffer.copyToNativeBuffer();
+        kiss_fftr (cfgForwards, fftIn.data(), fftOut.data());
+        complexBuffer.copyFromNativeBuffer();
+    }
+
+    void performInverseTransform() override
+    {
+        complexBuffer.copyToNativeBuffer();
+        kiss_fftri (cfgBackwards, fftOut.data(), fftIn.data());
+        realBuffer.copyFromNativeBuffer();
+    }
+
+private:
+    kiss_fftr_cfg cfgForwards;                          /**< Kiss FFT configuration (real-optimised, forwards) */
+    kiss_fftr_cfg cfgBackwards;                         /**< Kiss FFT configuration (real-optimised, backwards) */
+    std::vector<kiss_fft_scalar> fftIn;                 /**< FFT real samples */
+    std::vector<kiss_fft_cpx> fftOut;                   /**< FFT complex samples */
+
+    ConvertingBuffer<kiss_fft_scalar, SampleType> realBuffer;
+    ConvertingBuffer<kiss_fft_scalar, SampleType> complexBuffer;
+};
+#endif
+
+//=======================================================================
+template <typename SampleType>
+std::unique_ptr<FFT<SampleType>> FFT<SampleType>::create (int implementation, int size)
+{
+    if (implementation == DefaultFFTImplementation || ! isSupported (implementation, size))
+        implementation = getDefaultImplementation();
+
+    // the default may not support every size, but the built-in FFT supports them all, odd sizes included
+    if (! isSupported (implementation, size))
+        implementation = BuiltInFFTImplementation;
+
+    switch (implementation)
+    {
+#ifdef USE_FFTW
+        case FFTWImplementation:
+            return std::unique_ptr<FFT> (new FFTWFFT<SampleType> (size));
+#endif
+
+#ifdef USE_KISS_FFT
+        case KissFFTImplementation:
+            return std::unique_ptr<FFT> (new KissFFT<SampleType> (size));
+#endif
+
+        default:
+            return std::unique_ptr<FFT> (new BuiltInFFT<SampleType> (size));
+    }
+}
+
+//=======================================================================
+template <typename SampleType>
+bool FFT<SampleType>::isAvailable (int implementation)
+{
+    switch (implementation)
+    {
+        case DefaultFFTImplementation:
+        case BuiltInFFTImplementation:
+            return true;
+
+        case FFTWImplementation:
+#ifdef USE_FFTW
+            return true;
+#else
+            return false;
+#endif
+
+        case KissFFTImplementation:
+#ifdef USE_KISS_FFT
+            return true;
+#else
+            return false;
+#endif
+
+        default:
+            return false;
+    }
+}
+
+//=======================================================================
+template <typename SampleType>
+bool FFT<SampleType>::isSupported (int implementation, int size)
+{
+    if (size < 2 || ! isAvailable (implementation))
+        return false;
+
+    if (implementation == DefaultFFTImplementation)
+        implementation = getDefaultImplementation();
+
+    switch (implementation)
+    {
+        case FFTWImplementation:
+            return true;
+
+        case KissFFTImplementation:
+            return (size % 2) == 0;
+
+        default:
+            return BuiltInFFT<SampleType>::isSupported (size);
+    }
+}
+
+//=======================================================================
+template <typename SampleType>
+int FFT<SampleType>::getDefaultImplementation()
+{
+#if defined (USE_FFTW)
+    return FFTWImplementation;
+#elif defined (USE_KISS_FFT)
+    return KissFFTImplementation;
+#else
+    return BuiltInFFTImplementation;
+#endif
+}
+
+//=======================================================================
+template class FFT<double>;
+template class FFT<float>;
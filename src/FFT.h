@@ -0,0 +1,205 @@
+//=======================================================================
+/** @file FFT.h
+ *  @brief An interface to the real FFT implementations used by BTrack
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#ifndef __FFT_H
+#define __FFT_H
+
+#include <memory>
+#include <mutex>
+#include <map>
+#include <tuple>
+#include <string>
+
+//=======================================================================
+/** The FFT implementations that BTrack can use */
+enum FFTImplementation
+{
+    DefaultFFTImplementation,           /**< FFTW if it was compiled in, otherwise Kiss FFT if it was compiled in, otherwise the built-in FFT */
+    FFTWImplementation,                 /**< FFTW (requires USE_FFTW) */
+    KissFFTImplementation,              /**< Kiss FFT (requires USE_KISS_FFT) */
+    BuiltInFFTImplementation            /**< the header-only FFT in BuiltInFFT.h, for any size (radix-2 for powers of two, otherwise mixed radix) */
+};
+
+//=======================================================================
+/** The directions that an FFT plan can be made for */
+enum FFTPlanDirection
+{
+    ForwardFFTPlan,                     /**< a plan for the forward transform only */
+    InverseFFTPlan,                     /**< a plan for the inverse transform only */
+    BidirectionalFFTPlan                /**< a plan used for both transforms, e.g. a table of twiddle factors */
+};
+
+//=======================================================================
+/** A process-wide cache of FFT plans and twiddle tables, so that every FFT of the same
+ * implementation, precision, size and direction shares one plan rather than each making its
+ * own. FFTW plans and the built-in FFT's tables are shared. Kiss FFT configurations are not,
+ * as kiss_fftr() keeps its scratch space inside them, so each Kiss FFT still makes its own.
+ * Plans are reference counted: the cache only keeps a weak reference, so a plan is freed
+ * when the last FFT using it is destroyed, and creating an FFT whose plan is already in use
+ * costs only a lookup. All access to the cache, including FFTW planning, which is not thread
+ * safe, is serialised by a single lock, so FFTs can be created and destroyed from any thread.
+ */
+class FFTPlanCache
+{
+public:
+    
+    /** Make FFTW plans created from now on with FFTW_MEASURE rather than FFTW_ESTIMATE. Measuring
+     * takes much longer, but can find a faster plan, and with the plan cache it happens only
+     * once per size. Existing plans are left as they are. Has no effect without FFTW
+     * @param shouldMeasure true to use FFTW_MEASURE, false to use FFTW_ESTIMATE (the default)
+     */
+    static void setFFTWMeasure (bool shouldMeasure);
+    
+    /** Import FFTW wisdom, so that FFTW_MEASURE plans can be made without measuring again
+     * @param fileName the file to read the wisdom from
+     * @returns true if the wisdom was imported, or false if it could not be read or FFTW is not compiled in
+     */
+    static bool importFFTWWisdom (const std::string& fileName);
+    
+    /** Export the FFTW wisdom accumulated by the plans made so far
+     * @param fileName the file to write the wisdom to
+     * @returns true if the wisdom was exported, or false if it could not be written or FFTW is not compiled in
+     */
+    static bool exportFFTWWisdom (const std::string& fileName);
+    
+    /** @returns the number of plans currently in use */
+    static int getNumPlans();
+    
+    //=======================================================================
+    /** @returns the cached plan with the given key, creating it if no FFT is using one
+     * @param implementation the implementation that the plan belongs to (see FFTImplementation)
+     * @param precision the size in bytes of the samples that the plan works in
+     * @param size the size of the FFT
+     * @param direction the direction of the plan (see FFTPlanDirection)
+     * @param flags any implementation-specific options that the plan depends on
+     * @param arguments the arguments to construct the plan with, if it has to be created
+     */
+    template <typename Plan, typename... Arguments>
+    static std::shared_ptr<const Plan> getPlan (int implementation, int precision, int size, int direction, int flags, Arguments... arguments)
+    {
+        std::lock_guard<std::mutex> lock (getLock());
+        
+        Key key (implementation, precision, size, direction, flags);
+        std::map<Key, std::weak_ptr<const void>>& plans = getPlans();
+        
+        auto existingPlan = plans.find (key);
+        
+        if (existingPlan != plans.end())
+        {
+            if (std::shared_ptr<const void> plan = existingPlan->second.lock())
+                return std::static_pointer_cast<const Plan> (plan);
+        }
+        
+        std::shared_ptr<const Plan> plan (new Plan (arguments...), [key] (const Plan* planToDelete)
+        {
+            std::lock_guard<std::mutex> deleteLock (getLock());
+            delete planToDelete;
+            
+            // a new plan may have replaced this one while we waited for the lock
+            std::map<Key, std::weak_ptr<const void>>& remainingPlans = getPlans();
+            auto entry = remainingPlans.find (key);
+            
+            if (entry != remainingPlans.end() && entry->second.expired())
+                remainingPlans.erase (entry);
+        });
+        
+        plans[key] = plan;
+        
+        return plan;
+    }
+    
+    /** @returns true if FFTW plans made now should use FFTW_MEASURE (see setFFTWMeasure()) */
+    static bool isUsingFFTWMeasure();
+    
+private:
+    
+    typedef std::tuple<int, int, int, int, int> Key;
+    
+    static std::mutex& getLock();
+    static std::map<Key, std::weak_ptr<const void>>& getPlans();
+};
+
+//=======================================================================
+/** A real FFT of a fixed size, planned when it is created. The input and output are held in
+ * buffers owned by the FFT, so that an implementation working in the same precision as the
+ * sample type can run on them directly without any copying.
+ *
+ * The forward transform takes size real values from the real buffer and writes (size / 2) + 1
+ * complex values to the complex buffer, as interleaved real and imaginary parts. The inverse
+ * transform goes the other way and, as with FFTW, is not normalised, so a forward transform
+ * followed by an inverse one multiplies the signal by size.
+ *
+ * Plans and twiddle tables are shared with every other FFT of the same implementation, precision
+ * and size through FFTPlanCache. Each FFT has its own buffers, so different FFTs can run at the
+ * same time on different threads, but a single FFT should only be used by one thread at a time.
+ *
+ * @tparam SampleType the type of the samples in the buffers (float or double)
+ */
+template <typename SampleType>
+class FFT
+{
+public:
+
+    /** Destructor */
+    virtual ~FFT() {}
+
+    //=======================================================================
+    /** Creates an FFT, falling back to the default implementation if the requested one
+     * is not available or does not support the size
+     * @param implementation the implementation to use (see FFTImplementation)
+     * @param size the size of the FFT, which must be at least 2
+     */
+    static std::unique_ptr<FFT> create (int implementation, int size);
+
+    /** @returns true if the given implementation was compiled in
+     * @param implementation the implementation (see FFTImplementation)
+     */
+    static bool isAvailable (int implementation);
+
+    /** @returns true if the given implementation was compiled in and supports FFTs of the given size
+     * @param implementation the implementation (see FFTImplementation)
+     * @param size the size of the FFT
+     */
+    static bool isSupported (int implementation, int size);
+
+    /** @returns the implementation used for DefaultFFTImplementation */
+    static int getDefaultImplementation();
+
+    //=======================================================================
+    /** @returns the implementation being used (see FFTImplementation) */
+    virtual int getImplementation() const = 0;
+
+    /** @returns the buffer of size real values, which is the input to the forward transform
+     * and the output of the inverse transform */
+    virtual SampleType* getRealBuffer() = 0;
+
+    /** @returns the buffer of (size / 2) + 1 interleaved complex values, which is the output of the
+     * forward transform and the input to the inverse transform */
+    virtual SampleType* getComplexBuffer() = 0;
+
+    /** Transforms the real buffer into the complex buffer */
+    virtual void performForwardTransform() = 0;
+
+    /** Transforms the complex buffer into the real buffer, overwriting the complex buffer */
+    virtual void performInverseTransform() = 0;
+};
+
+#endif
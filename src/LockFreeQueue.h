@@ -0,0 +1,118 @@
+//=======================================================================
+/** @file LockFreeQueue.h
+ *  @brief A wait-free single producer, single consumer queue
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#ifndef LockFreeQueue_h
+#define LockFreeQueue_h
+
+#include <atomic>
+#include <vector>
+
+//=======================================================================
+/** A queue of a fixed capacity that one thread (the producer) adds items to and another thread
+ * (the consumer) takes them from, without locking or allocating. Both adding and taking an item
+ * finish in a fixed number of steps whatever the other thread is doing, so either thread can be a
+ * real-time thread. If more than one thread adds items, they must take turns, for example with
+ * a lock that the consumer never takes.
+ *
+ * @tparam T the type of the items, which should be default constructible and copyable
+ */
+template <typename T>
+class LockFreeQueue
+{
+public:
+    
+    /** Constructor
+     * @param capacity the largest number of items the queue can hold
+     */
+    LockFreeQueue (int capacity = 64)
+     :  readIndex (0),
+        writeIndex (0)
+    {
+        setCapacity (capacity);
+    }
+    
+    /** Sets the largest number of items the queue can hold and empties it. Neither thread may use
+     * the queue while this is called
+     * @param capacity the largest number of items the queue can hold
+     */
+    void setCapacity (int capacity)
+    {
+        // one slot is always left empty, to tell a full queue from an empty one
+        items.assign (capacity + 1, T());
+        readIndex = 0;
+        writeIndex = 0;
+    }
+    
+    //=======================================================================
+    /** Adds an item to the back of the queue. Only the producer may call this
+     * @param item the item to add
+     * @returns true if the item was added, or false if the queue was full
+     */
+    bool push (const T& item)
+    {
+        int index = writeIndex.load (std::memory_order_relaxed);
+        int nextIndex = next (index);
+        
+        if (nextIndex == readIndex.load (std::memory_order_acquire))
+            return false;
+        
+        items[index] = item;
+        writeIndex.store (nextIndex, std::memory_order_release);
+        return true;
+    }
+    
+    /** Takes the item from the front of the queue. Only the consumer may call this
+     * @param item set to the item taken, if there was one
+     * @returns true if an item was taken, or false if the queue was empty
+     */
+    bool pop (T& item)
+    {
+        int index = readIndex.load (std::memory_order_relaxed);
+        
+        if (index == writeIndex.load (std::memory_order_acquire))
+            return false;
+        
+        item = items[index];
+        readIndex.store (next (index), std::memory_order_release);
+        return true;
+    }
+    
+    /** @returns true if the queue has no items in it. From the producer, the queue may have
+     * emptied since, and from the consumer, items may have been added since */
+    bool isEmpty() const
+    {
+        return readIndex.load (std::memory_order_acquire) == writeIndex.load (std::memory_order_acquire);
+    }
+    
+private:
+    
+    /** @returns the slot after a slot, wrapping around at the end */
+    int next (int index) const
+    {
+        return (index + 1) == static_cast<int> (items.size()) ? 0 : index + 1;
+    }
+    
+    std::vector<T> items;                   /**< the slots for the items, one more than the capacity */
+    std::atomic<int> readIndex;             /**< the slot of the item at the front, written only by the consumer */
+    std::atomic<int> writeIndex;            /**< the slot the next item is added to, written only by the producer */
+};
+
+#endif /* LockFreeQueue_h */
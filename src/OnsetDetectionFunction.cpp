@@ -22,30 +22,33 @@
 #include <math.h>
 #include <algorithm>
 #include "OnsetDetectionFunction.h"
+#include "OnsetDetectionFunctionBodies.h"
 
 //=======================================================================
-OnsetDetectionFunction::OnsetDetectionFunction (int hopSize_, int frameSize_)
- :  onsetDetectionFunctionType (ComplexSpectralDifferenceHWR), windowType (HanningWindow)
+template <typename SampleType>
+BasicOnsetDetectionFunction<SampleType>::BasicOnsetDetectionFunction (int hopSize_, int frameSize_)
+ :  onsetDetectionFunctionType (ComplexSpectralDifferenceHWR), complexDomainPredictionMethod (ComplexArithmeticPrediction), windowType (HanningWindow), featureMask (AllOnsetDetectionFunctionFeatures), fftImplementation (DefaultFFTImplementation)
 {
-    // indicate that we have not initialised yet
-	initialised = false;
-	
 	// set pi
 	pi = 3.14159265358979;
+    
+    // use the fastest version of the per-bin loops that the CPU supports
+    kernels = &SpectralKernels<SampleType>::getBestKernels();
 	
 	// initialise with arguments to constructor
 	initialise (hopSize_, frameSize_, ComplexSpectralDifferenceHWR, HanningWindow);
 }
 
 //=======================================================================
-OnsetDetectionFunction::OnsetDetectionFunction (int hopSize_, int frameSize_, int onsetDetectionFunctionType_, int windowType_)
- :  onsetDetectionFunctionType (ComplexSpectralDifferenceHWR), windowType (HanningWindow)
+template <typename SampleType>
+BasicOnsetDetectionFunction<SampleType>::BasicOnsetDetectionFunction (int hopSize_, int frameSize_, int onsetDetectionFunctionType_, int windowType_)
+ :  onsetDetectionFunctionType (ComplexSpectralDifferenceHWR), complexDomainPredictionMethod (ComplexArithmeticPrediction), windowType (HanningWindow), featureMask (AllOnsetDetectionFunctionFeatures), fftImplementation (DefaultFFTImplementation)
 {	
-	// indicate that we have not initialised yet
-	initialised = false;
-	
 	// set pi
 	pi = 3.14159265358979;	
+    
+    // use the fastest version of the per-bin loops that the CPU supports
+    kernels = &SpectralKernels<SampleType>::getBestKernels();
 	
 	// initialise with arguments to constructor
 	initialise (hopSize_, frameSize_, onsetDetectionFunctionType_, windowType_);
@@ -53,14 +56,14 @@ OnsetDetectionFunction::OnsetDetectionFunction (int hopSize_, int frameSize_, in
 
 
 //=======================================================================
-OnsetDetectionFunction::~OnsetDetectionFunction()
+template <typename SampleType>
+BasicOnsetDetectionFunction<SampleType>::~BasicOnsetDetectionFunction()
 {
-    if (initialised)
-        freeFFT();
 }
 
 //=======================================================================
-void OnsetDetectionFunction::initialise (int hopSize_, int frameSize_)
+template <typename SampleType>
+void BasicOnsetDetectionFunction<SampleType>::initialise (int hopSize_, int frameSize_)
 {
     // use the already initialised onset detection function and window type and
     // pass the new frame and hop size to the main initialisation function
@@ -68,7 +71,8 @@ void OnsetDetectionFunction::initialise (int hopSize_, int frameSize_)
 }
 
 //=======================================================================
-void OnsetDetectionFunction::initialise (int hopSize_, int frameSize_, int onsetDetectionFunctionType_, int windowType_)
+template <typename SampleType>
+void BasicOnsetDetectionFunction<SampleType>::initialise (int hopSize_, int frameSize_, int onsetDetectionFunctionType_, int windowType_)
 {
 	hopSize = hopSize_; // set hopsize
 	frameSize = frameSize_; // set framesize
@@ -76,14 +80,23 @@ void OnsetDetectionFunction::initialise (int hopSize_, int frameSize_, int onset
 	onsetDetectionFunctionType = onsetDetectionFunctionType_; // set detection function type
     windowType = windowType_; // set window type
 		
+    // the FFT of a real frame is conjugate symmetric, so we only keep the bins from DC to Nyquist
+    numBins = (frameSize / 2) + 1;
+		
 	// initialise buffers
     frame.resize (frameSize);
     window.resize (frameSize);
-    magSpec.resize (frameSize);
-    prevMagSpec.resize (frameSize);
-    phase.resize (frameSize);
-    prevPhase.resize (frameSize);
-    prevPhase2.resize (frameSize);
+    magSpec.resize (numBins);
+    prevMagSpec.resize (numBins);
+    phase.resize (numBins);
+    prevPhase.resize (numBins);
+    prevPhase2.resize (numBins);
+    prevPhasorReal.resize (numBins);
+    prevPhasorImag.resize (numBins);
+    prevPhasor2Real.resize (numBins);
+    prevPhasor2Imag.resize (numBins);
+    binWeights.resize (numBins);
+    highFrequencyWeights.resize (numBins);
 	
 	// set the window to the specified type
 	switch (windowType)
@@ -106,86 +119,130 @@ void OnsetDetectionFunction::initialise (int hopSize_, int frameSize_, int onset
 		default:
 			calculateHanningWindow();			// DEFAULT: Hanning Window
 	}
+    
+    // swap the two halves of the window, to match the order in which the frame is windowed (see windowFrame())
+    std::rotate (window.begin(), window.begin() + (frameSize / 2), window.end());
 	
 	// initialise previous magnitude spectrum to zero
-	for (int i = 0; i < frameSize; i++)
+	for (int i = 0; i < numBins; i++)
 	{
 		prevMagSpec[i] = 0.0;
 		prevPhase[i] = 0.0;
 		prevPhase2[i] = 0.0;
-		frame[i] = 0.0;
+        
+        // a phase of zero is a unit phasor of (1, 0)
+        prevPhasorReal[i] = 1.0;
+        prevPhasorImag[i] = 0.0;
+        prevPhasor2Real[i] = 1.0;
+        prevPhasor2Imag[i] = 0.0;
 	}
+    
+    std::fill (frame.begin(), frame.end(), SampleType (0));
+    frameWriteIndex = 0;
+    currentFrame = frame.data();
+    currentFrameStart = 0;
+    
+    // every bin apart from DC and Nyquist also stands in for its mirror image in the upper half of
+    // the spectrum, so we weight it accordingly to give the same sums as the full spectrum would
+    for (int i = 0; i < numBins; i++)
+    {
+        bool hasMirrorImage = (i > 0) && ((2 * i) != frameSize);
+        
+        binWeights[i] = hasMirrorImage ? 2.0 : 1.0;
+        highFrequencyWeights[i] = hasMirrorImage ? static_cast<SampleType> ((i + 1) + (frameSize - i + 1)) : static_cast<SampleType> (i + 1);
+    }
 	
 	prevEnergySum = 0.0;	// initialise previous energy sum value to zero
+    
+    // the frame starts as zeros
+    frameEnergySum = 0.0;
+    hopsSinceEnergyResummation = 0;
 	
     initialiseFFT();
 }
 
 //=======================================================================
-void OnsetDetectionFunction::initialiseFFT()
+template <typename SampleType>
+void BasicOnsetDetectionFunction<SampleType>::initialiseFFT()
 {
-    if (initialised) // if we have already initialised FFT plan
-        freeFFT();
-    
-#ifdef USE_FFTW
-    complexIn = (fftw_complex*) fftw_malloc (sizeof(fftw_complex) * frameSize);		// complex array to hold fft data
-    complexOut = (fftw_complex*) fftw_malloc (sizeof(fftw_complex) * frameSize);	// complex array to hold fft data
-    p = fftw_plan_dft_1d (frameSize, complexIn, complexOut, FFTW_FORWARD, FFTW_ESTIMATE);	// FFT plan initialisation
-#endif
-    
-#ifdef USE_KISS_FFT
-    complexOut.resize (frameSize);
+    // replaces any FFT set up for a previous frame size
+    fft = FFT<SampleType>::create (fftImplementation, frameSize);
+}
+
+//=======================================================================
+template <typename SampleType>
+void BasicOnsetDetectionFunction<SampleType>::setFFTImplementation (int fftImplementation_)
+{
+    fftImplementation = fftImplementation_;
+    initialiseFFT();
+}
+
+//=======================================================================
+template <typename SampleType>
+int BasicOnsetDetectionFunction<SampleType>::getFFTImplementation() const
+{
+    return fft->getImplementation();
+}
+
+//=======================================================================
+template <typename SampleType>
+void BasicOnsetDetectionFunction<SampleType>::setOnsetDetectionFunctionType (int onsetDetectionFunctionType_)
+{
+	onsetDetectionFunctionType = onsetDetectionFunctionType_; // set detection function type
+}
+
+//=======================================================================
+template <typename SampleType>
+void BasicOnsetDetectionFunction<SampleType>::setComplexDomainPredictionMethod (int complexDomainPredictionMethod_)
+{
+    complexDomainPredictionMethod = complexDomainPredictionMethod_; // set prediction method
     
-    for (int i = 0; i < frameSize; i++)
+    // the two methods keep their history in different forms, so start again from silence
+    for (int i = 0; i < numBins; i++)
     {
-        complexOut[i].resize(2);
+        prevMagSpec[i] = 0.0;
+        prevPhase[i] = 0.0;
+        prevPhase2[i] = 0.0;
+        prevPhasorReal[i] = 1.0;
+        prevPhasorImag[i] = 0.0;
+        prevPhasor2Real[i] = 1.0;
+        prevPhasor2Imag[i] = 0.0;
     }
-    
-    fftIn = new kiss_fft_cpx[frameSize];
-    fftOut = new kiss_fft_cpx[frameSize];
-    cfg = kiss_fft_alloc (frameSize, 0, 0, 0);
-#endif
+}
 
-    initialised = true;
+//=======================================================================
+template <typename SampleType>
+void BasicOnsetDetectionFunction<SampleType>::setFeatureMask (unsigned int featureMask_)
+{
+    featureMask = featureMask_ & AllOnsetDetectionFunctionFeatures; // set feature mask
 }
 
 //=======================================================================
-void OnsetDetectionFunction::freeFFT()
+template <typename SampleType>
+SampleType BasicOnsetDetectionFunction<SampleType>::calculateOnsetDetectionFunctionSample (const SampleType* buffer)
 {
-#ifdef USE_FFTW
-    fftw_destroy_plan (p);
-    fftw_free (complexIn);
-    fftw_free (complexOut);
-#endif
+    addHopToFrame (buffer, onsetDetectionFunctionType == EnergyEnvelope || onsetDetectionFunctionType == EnergyDifference);
     
-#ifdef USE_KISS_FFT
-    free (cfg);
-    delete [] fftIn;
-    delete [] fftOut;
-#endif
+    // the oldest sample is now the one that the next hop will overwrite
+    return calculateOnsetDetectionFunctionSample (frame.data(), frameWriteIndex);
 }
 
 //=======================================================================
-void OnsetDetectionFunction::setOnsetDetectionFunctionType (int onsetDetectionFunctionType_)
+template <typename SampleType>
+SampleType BasicOnsetDetectionFunction<SampleType>::calculateOnsetDetectionFunctionSampleFromFrame (const SampleType* fullFrame)
 {
-	onsetDetectionFunctionType = onsetDetectionFunctionType_; // set detection function type
+    // the caller's frame is already in order, so we can read it where it is
+    return calculateOnsetDetectionFunctionSample (fullFrame, 0);
 }
 
 //=======================================================================
-double OnsetDetectionFunction::calculateOnsetDetectionFunctionSample (double* buffer)
-{	
-	double odfSample;
-		
-	// shift audio samples back in frame by hop size
-    std::rotate (frame.begin(), frame.begin() + hopSize, frame.end());
+template <typename SampleType>
+SampleType BasicOnsetDetectionFunction<SampleType>::calculateOnsetDetectionFunctionSample (const SampleType* frameSamples, int oldestSampleIndex)
+{
+	SampleType odfSample;
 	
-	// add new samples to frame from input buffer
-	int j = 0;
-	for (int i = (frameSize - hopSize); i < frameSize; i++)
-	{
-		frame[i] = buffer[j];
-		j++;
-	}
+	currentFrame = frameSamples;
+	currentFrameStart = oldestSampleIndex;
 		
 	switch (onsetDetectionFunctionType)
     {
@@ -260,409 +317,162 @@ double OnsetDetectionFunction::calculateOnsetDetectionFunctionSample (double* bu
 
 
 //=======================================================================
-void OnsetDetectionFunction::performFFT()
+template <typename SampleType>
+const typename BasicOnsetDetectionFunction<SampleType>::FeatureVector& BasicOnsetDetectionFunction<SampleType>::calculateOnsetDetectionFunctionFeatures (const SampleType* buffer)
 {
-    int fsize2 = (frameSize / 2);
+    addHopToFrame (buffer, isFeatureSelected (EnergyEnvelope) || isFeatureSelected (EnergyDifference));
     
-#ifdef USE_FFTW
-	// window frame and copy to complex array, swapping the first and second half of the signal
-	for (int i = 0; i < fsize2; i++)
-	{
-		complexIn[i][0] = frame[i + fsize2] * window[i + fsize2];
-		complexIn[i][1] = 0.0;
-		complexIn[i+fsize2][0] = frame[i] * window[i];
-		complexIn[i+fsize2][1] = 0.0;
-	}
-	
-	// perform the fft
-	fftw_execute (p);
-#endif
+    currentFrame = frame.data();
+    currentFrameStart = frameWriteIndex;
     
-#ifdef USE_KISS_FFT
-    for (int i = 0; i < fsize2; i++)
-    {
-        fftIn[i].r = frame[i + fsize2] * window[i + fsize2];
-        fftIn[i].i = 0.0;
-        fftIn[i + fsize2].r = frame[i] * window[i];
-        fftIn[i + fsize2].i = 0.0;
-    }
-    
-    // execute kiss fft
-    kiss_fft (cfg, fftIn, fftOut);
+    calculateFeatures();
     
-    // store real and imaginary parts of FFT
-    for (int i = 0; i < frameSize; i++)
-    {
-        complexOut[i][0] = fftOut[i].r;
-        complexOut[i][1] = fftOut[i].i;
-    }
-#endif
-}
-
-//////////////////////////////////////////////////////////////////////////////////////////////////////
-//////////////////////////////////////////////////////////////////////////////////////////////////////
-////////////////////////////// Methods for Onset Detection Functions /////////////////////////////////
-
-//=======================================================================
-double OnsetDetectionFunction::energyEnvelope()
-{
-	double sum;
-	
-	sum = 0;	// initialise sum
-	
-	// sum the squares of the samples
-	for (int i = 0; i < frameSize; i++)
-	{
-		sum = sum + (frame[i] * frame[i]);
-	}
-	
-	return sum;		// return sum
+    return features;
 }
 
 //=======================================================================
-double OnsetDetectionFunction::energyDifference()
+template <typename SampleType>
+const typename BasicOnsetDetectionFunction<SampleType>::FeatureVector& BasicOnsetDetectionFunction<SampleType>::calculateOnsetDetectionFunctionFeaturesFromFrame (const SampleType* fullFrame)
 {
-	double sum;
-	double sample;
-	
-	sum = 0;	// initialise sum
-	
-	// sum the squares of the samples
-	for (int i = 0; i < frameSize; i++)
-	{
-		sum = sum + (frame[i] * frame[i]);
-	}
-	
-	sample = sum - prevEnergySum;	// sample is first order difference in energy
-	
-	prevEnergySum = sum;	// store energy value for next calculation
-	
-	if (sample > 0)
-	{
-		return sample;		// return difference
-	}
-	else
-	{
-		return 0;
-	}
-}
-
-//=======================================================================
-double OnsetDetectionFunction::spectralDifference()
-{
-	double diff;
-	double sum;
-	
-	// perform the FFT
-	performFFT();
-	
-	// compute first (N / 2) + 1 mag values
-	for (int i = 0; i < (frameSize / 2) + 1; i++)
-	{
-		magSpec[i] = sqrt (pow (complexOut[i][0], 2) + pow (complexOut[i][1], 2));
-	}
-	// mag spec symmetric above (N / 2) + 1 so copy previous values
-	for (int i = (frameSize / 2) + 1; i < frameSize; i++)
-	{
-		magSpec[i] = magSpec[frameSize - i];
-	}
-	
-	sum = 0;	// initialise sum to zero
-
-	for (int i = 0; i < frameSize; i++)
-	{
-		// calculate difference
-		diff = magSpec[i] - prevMagSpec[i];
-		
-		// ensure all difference values are positive
-		if (diff < 0)
-		{
-			diff = diff * -1;
-		}
-		
-		// add difference to sum
-		sum = sum + diff;
-		
-		// store magnitude spectrum bin for next detection function sample calculation
-		prevMagSpec[i] = magSpec[i];
-	}
-	
-	return sum;		
-}
-
-//=======================================================================
-double OnsetDetectionFunction::spectralDifferenceHWR()
-{
-	double diff;
-	double sum;
-	
-	// perform the FFT
-	performFFT();
-	
-	// compute first (N / 2) + 1 mag values
-	for (int i = 0; i < (frameSize / 2) + 1; i++)
-	{
-		magSpec[i] = sqrt (pow (complexOut[i][0],2) + pow (complexOut[i][1],2));
-	}
-	// mag spec symmetric above (N / 2) + 1 so copy previous values
-	for (int i = (frameSize / 2) + 1; i < frameSize; i++)
-	{
-		magSpec[i] = magSpec[frameSize - i];
-	}
-	
-	sum = 0;	// initialise sum to zero
-	
-	for (int i = 0; i < frameSize; i++)
-	{
-		// calculate difference
-		diff = magSpec[i] - prevMagSpec[i];
-		
-		// only add up positive differences
-		if (diff > 0)
-		{
-			// add difference to sum
-			sum = sum+diff;
-		}
-		
-		// store magnitude spectrum bin for next detection function sample calculation
-		prevMagSpec[i] = magSpec[i];
-	}
-	
-	return sum;		
-}
-
-
-//=======================================================================
-double OnsetDetectionFunction::phaseDeviation()
-{
-	double dev,pdev;
-	double sum;
-	
-	// perform the FFT
-	performFFT();
-	
-	sum = 0; // initialise sum to zero
-	
-	// compute phase values from fft output and sum deviations
-	for (int i = 0; i < frameSize; i++)
-	{
-		// calculate phase value
-		phase[i] = atan2 (complexOut[i][1], complexOut[i][0]);
-		
-		// calculate magnitude value
-		magSpec[i] = sqrt (pow (complexOut[i][0],2) + pow (complexOut[i][1],2));
-		
-		
-		// if bin is not just a low energy bin then examine phase deviation
-		if (magSpec[i] > 0.1)
-		{
-			dev = phase[i] - (2 * prevPhase[i]) + prevPhase2[i];	// phase deviation
-			pdev = princarg (dev);	// wrap into [-pi,pi] range
-		
-			// make all values positive
-			if (pdev < 0)	
-			{
-				pdev = pdev * -1;
-			}
-						
-			// add to sum
-			sum = sum + pdev;
-		}
-				
-		// store values for next calculation
-		prevPhase2[i] = prevPhase[i];
-		prevPhase[i] = phase[i];
-	}
-	
-	return sum;		
+    currentFrame = fullFrame;
+    currentFrameStart = 0;
+    
+    calculateFeatures();
+    
+    return features;
 }
 
 //=======================================================================
-double OnsetDetectionFunction::complexSpectralDifference()
+template <typename SampleType>
+bool BasicOnsetDetectionFunction<SampleType>::isFeatureSelected (int type) const
 {
-	double phaseDeviation;
-	double sum;
-	double csd;
-	
-	// perform the FFT
-	performFFT();
-	
-	sum = 0; // initialise sum to zero
-	
-	// compute phase values from fft output and sum deviations
-	for (int i = 0; i < frameSize; i++)
-	{
-		// calculate phase value
-		phase[i] = atan2 (complexOut[i][1], complexOut[i][0]);
-		
-		// calculate magnitude value
-		magSpec[i] = sqrt (pow (complexOut[i][0],2) + pow(complexOut[i][1],2));
-		
-		// phase deviation
-		phaseDeviation = phase[i] - (2 * prevPhase[i]) + prevPhase2[i];
-		
-        // calculate complex spectral difference for the current spectral bin
-		csd = sqrt (pow (magSpec[i], 2) + pow (prevMagSpec[i], 2) - 2 * magSpec[i] * prevMagSpec[i] * cos (phaseDeviation));
-			
-		// add to sum
-		sum = sum + csd;
-		
-		// store values for next calculation
-		prevPhase2[i] = prevPhase[i];
-		prevPhase[i] = phase[i];
-		prevMagSpec[i] = magSpec[i];
-	}
-	
-	return sum;		
+    return (featureMask & (1u << type)) != 0;
 }
 
 //=======================================================================
-double OnsetDetectionFunction::complexSpectralDifferenceHWR()
+template <typename SampleType>
+void BasicOnsetDetectionFunction<SampleType>::calculateFeatures()
 {
-	double phaseDeviation;
-	double sum;
-	double magnitudeDifference;
-	double csd;
-	
-	// perform the FFT
-	performFFT();
-	
-	sum = 0; // initialise sum to zero
-	
-	// compute phase values from fft output and sum deviations
-	for (int i = 0; i < frameSize; i++)
-	{
-		// calculate phase value
-		phase[i] = atan2 (complexOut[i][1], complexOut[i][0]);
-		
-		// calculate magnitude value
-		magSpec[i] = sqrt (pow (complexOut[i][0],2) + pow(complexOut[i][1],2));
-		
-        // phase deviation
-        phaseDeviation = phase[i] - (2 * prevPhase[i]) + prevPhase2[i];
+    features.fill (SampleType (0));
+    
+    //=======================================================================
+    // energy features
+    
+    if (isFeatureSelected (EnergyEnvelope) || isFeatureSelected (EnergyDifference))
+    {
+        SampleType sum = calculateFrameEnergy();
         
-        // calculate magnitude difference (real part of Euclidean distance between complex frames)
-        magnitudeDifference = magSpec[i] - prevMagSpec[i];
+        if (isFeatureSelected (EnergyEnvelope))
+            features[EnergyEnvelope] = sum;
         
-        // if we have a positive change in magnitude, then include in sum, otherwise ignore (half-wave rectification)
-        if (magnitudeDifference > 0)
-        {
-            // calculate complex spectral difference for the current spectral bin
-            csd = sqrt (pow (magSpec[i], 2) + pow (prevMagSpec[i], 2) - 2 * magSpec[i] * prevMagSpec[i] * cos (phaseDeviation));
+        if (isFeatureSelected (EnergyDifference))
+            features[EnergyDifference] = std::max (sum - prevEnergySum, SampleType (0));
+        
+        prevEnergySum = sum;
+    }
+    
+    //=======================================================================
+    // spectral features
+    
+    if ((featureMask & ~((1u << EnergyEnvelope) | (1u << EnergyDifference))) == 0)
+        return;
+    
+    bool complexDomain = isFeatureSelected (ComplexSpectralDifference) || isFeatureSelected (ComplexSpectralDifferenceHWR);
+    bool complexPrediction = complexDomain && (complexDomainPredictionMethod == ComplexArithmeticPrediction);
+    bool phaseNeeded = isFeatureSelected (PhaseDeviation) || (complexDomain && ! complexPrediction);
+    
+    // perform the FFT and calculate the magnitudes once for every feature
+    performFFT();
+    
+    const SampleType* spectrum = getComplexSpectrum();
+    
+    kernels->calculateMagnitudes (spectrum, magSpec.data(), numBins);
+    
+    // the magnitude differences all compare with the previous magnitude spectrum, which is only updated once they are done
+    if (isFeatureSelected (SpectralDifference))
+        features[SpectralDifference] = kernels->sumMagnitudeDifferences (magSpec.data(), prevMagSpec.data(), binWeights.data(), numBins, false, false);
+    
+    if (isFeatureSelected (SpectralDifferenceHWR))
+        features[SpectralDifferenceHWR] = kernels->sumMagnitudeDifferences (magSpec.data(), prevMagSpec.data(), binWeights.data(), numBins, true, false);
+    
+    if (isFeatureSelected (HighFrequencyContent))
+        features[HighFrequencyContent] = kernels->sumWeighted (magSpec.data(), highFrequencyWeights.data(), numBins);
+    
+    if (isFeatureSelected (HighFrequencySpectralDifference))
+        features[HighFrequencySpectralDifference] = kernels->sumMagnitudeDifferences (magSpec.data(), prevMagSpec.data(), highFrequencyWeights.data(), numBins, false, false);
+    
+    if (isFeatureSelected (HighFrequencySpectralDifferenceHWR))
+        features[HighFrequencySpectralDifferenceHWR] = kernels->sumMagnitudeDifferences (magSpec.data(), prevMagSpec.data(), highFrequencyWeights.data(), numBins, true, false);
+    
+    // phase deviation, and the complex spectral differences if they are found by unwrapping the phase
+    if (phaseNeeded)
+    {
+        double phaseDeviationSum = 0;
+        double csdSum = 0;
+        double csdHWRSum = 0;
         
-            // add to sum
-            sum = sum + csd;
+        for (int i = 0; i < numBins; i++)
+        {
+            phase[i] = atan2 (spectrum[(2 * i) + 1], spectrum[2 * i]);
+            
+            double deviation = phase[i] - (2 * prevPhase[i]) + prevPhase2[i];
+            
+            if (magSpec[i] > 0.1)
+                phaseDeviationSum = phaseDeviationSum + (binWeights[i] * fabs (princarg (deviation)));
+            
+            if (complexDomain && ! complexPrediction)
+            {
+                double csd = sqrt (pow (magSpec[i], 2) + pow (prevMagSpec[i], 2) - 2 * magSpec[i] * prevMagSpec[i] * cos (deviation));
+                
+                csdSum = csdSum + (binWeights[i] * csd);
+                
+                if (magSpec[i] > prevMagSpec[i])
+                    csdHWRSum = csdHWRSum + (binWeights[i] * csd);
+            }
+            
+            prevPhase2[i] = prevPhase[i];
+            prevPhase[i] = phase[i];
         }
         
-		// store values for next calculation
-		prevPhase2[i] = prevPhase[i];
-		prevPhase[i] = phase[i];
-		prevMagSpec[i] = magSpec[i];
-	}
-	
-	return sum;		
-}
-
-
-//=======================================================================
-double OnsetDetectionFunction::highFrequencyContent()
-{
-	double sum;
-	
-	// perform the FFT
-	performFFT();
-	
-	sum = 0; // initialise sum to zero
-	
-	// compute phase values from fft output and sum deviations
-	for (int i = 0; i < frameSize; i++)
-	{		
-		// calculate magnitude value
-		magSpec[i] = sqrt (pow (complexOut[i][0],2) + pow (complexOut[i][1],2));
-		
-		
-		sum = sum + (magSpec[i] * ((double) (i + 1)));
-		
-		// store values for next calculation
-		prevMagSpec[i] = magSpec[i];
-	}
-	
-	return sum;		
-}
-
-//=======================================================================
-double OnsetDetectionFunction::highFrequencySpectralDifference()
-{
-	double sum;
-	double mag_diff;
-	
-	// perform the FFT
-	performFFT();
-	
-	sum = 0; // initialise sum to zero
-	
-	// compute phase values from fft output and sum deviations
-	for (int i = 0; i < frameSize; i++)
-	{		
-		// calculate magnitude value
-		magSpec[i] = sqrt (pow (complexOut[i][0],2) + pow (complexOut[i][1],2));
-		
-		// calculate difference
-		mag_diff = magSpec[i] - prevMagSpec[i];
-		
-		if (mag_diff < 0)
-		{
-			mag_diff = -mag_diff;
-		}
-		
-		sum = sum + (mag_diff * ((double) (i + 1)));
-		
-		// store values for next calculation
-		prevMagSpec[i] = magSpec[i];
-	}
-	
-	return sum;		
-}
-
-//=======================================================================
-double OnsetDetectionFunction::highFrequencySpectralDifferenceHWR()
-{
-	double sum;
-	double mag_diff;
-	
-	// perform the FFT
-	performFFT();
-	
-	sum = 0; // initialise sum to zero
-	
-	// compute phase values from fft output and sum deviations
-	for (int i = 0; i < frameSize; i++)
-	{		
-		// calculate magnitude value
-		magSpec[i] = sqrt (pow (complexOut[i][0],2) + pow (complexOut[i][1],2));
-		
-		// calculate difference
-		mag_diff = magSpec[i] - prevMagSpec[i];
-		
-		if (mag_diff > 0)
-		{
-			sum = sum + (mag_diff * ((double) (i + 1)));
-		}
-
-		// store values for next calculation
-		prevMagSpec[i] = magSpec[i];
-	}
-	
-	return sum;		
+        if (isFeatureSelected (PhaseDeviation))
+            features[PhaseDeviation] = static_cast<SampleType> (phaseDeviationSum);
+        
+        if (isFeatureSelected (ComplexSpectralDifference))
+            features[ComplexSpectralDifference] = static_cast<SampleType> (csdSum);
+        
+        if (isFeatureSelected (ComplexSpectralDifferenceHWR))
+            features[ComplexSpectralDifferenceHWR] = static_cast<SampleType> (csdHWRSum);
+    }
+    
+    // the complex spectral differences by complex prediction, the last of which updates the history
+    if (complexPrediction)
+    {
+        bool halfWaveRectifiedToFollow = isFeatureSelected (ComplexSpectralDifferenceHWR);
+        
+        if (isFeatureSelected (ComplexSpectralDifference))
+            features[ComplexSpectralDifference] = kernels->sumComplexSpectralDifferences (spectrum, magSpec.data(), prevMagSpec.data(),
+                                                                                          prevPhasorReal.data(), prevPhasorImag.data(), prevPhasor2Real.data(), prevPhasor2Imag.data(),
+                                                                                          binWeights.data(), numBins, false, ! halfWaveRectifiedToFollow);
+        
+        if (halfWaveRectifiedToFollow)
+            features[ComplexSpectralDifferenceHWR] = kernels->sumComplexSpectralDifferences (spectrum, magSpec.data(), prevMagSpec.data(),
+                                                                                             prevPhasorReal.data(), prevPhasorImag.data(), prevPhasor2Real.data(), prevPhasor2Imag.data(),
+                                                                                             binWeights.data(), numBins, true, true);
+    }
+    else
+    {
+        // store the magnitude spectrum for the next calculation
+        std::copy (magSpec.begin(), magSpec.end(), prevMagSpec.begin());
+    }
 }
 
-
 ////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////// Methods to Calculate Windows ////////////////////////////////////
 
 //=======================================================================
-void OnsetDetectionFunction::calculateHanningWindow()
+template <typename SampleType>
+void BasicOnsetDetectionFunction<SampleType>::calculateHanningWindow()
 {
 	double N = (double) (frameSize - 1);	// framesize minus 1
 	
@@ -674,7 +484,8 @@ void OnsetDetectionFunction::calculateHanningWindow()
 }
 
 //=======================================================================
-void OnsetDetectionFunction::calclulateHammingWindow()
+template <typename SampleType>
+void BasicOnsetDetectionFunction<SampleType>::calclulateHammingWindow()
 {
 	double N = (double) (frameSize - 1);	// framesize minus 1
 	
@@ -684,7 +495,8 @@ void OnsetDetectionFunction::calclulateHammingWindow()
 }
 
 //=======================================================================
-void OnsetDetectionFunction::calculateBlackmanWindow()
+template <typename SampleType>
+void BasicOnsetDetectionFunction<SampleType>::calculateBlackmanWindow()
 {
 	double N = (double) (frameSize - 1);	// framesize minus 1
 	
@@ -694,7 +506,8 @@ void OnsetDetectionFunction::calculateBlackmanWindow()
 }
 
 //=======================================================================
-void OnsetDetectionFunction::calculateTukeyWindow()
+template <typename SampleType>
+void BasicOnsetDetectionFunction<SampleType>::calculateTukeyWindow()
 {
 	double alpha = 0.5;
 	double N = (double) (frameSize - 1);	// framesize minus 1
@@ -720,27 +533,14 @@ void OnsetDetectionFunction::calculateTukeyWindow()
 }
 
 //=======================================================================
-void OnsetDetectionFunction::calculateRectangularWindow()
+template <typename SampleType>
+void BasicOnsetDetectionFunction<SampleType>::calculateRectangularWindow()
 {
 	// Rectangular window calculation
 	for (int n = 0; n < frameSize; n++)
         window[n] = 1.0;
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////
-////////////////////////////////////////////////////////////////////////////////////////////////
-///////////////////////////////// Other Handy Methods //////////////////////////////////////////
-
 //=======================================================================
-double OnsetDetectionFunction::princarg (double phaseVal)
-{
-	// if phase value is less than or equal to -pi then add 2*pi
-	while (phaseVal <= (-pi))
-        phaseVal = phaseVal + (2 * pi);
-	
-	// if phase value is larger than pi, then subtract 2*pi
-	while (phaseVal > pi)
-        phaseVal = phaseVal - (2 * pi);
-			
-	return phaseVal;
-}
+template class BasicOnsetDetectionFunction<double>;
+template class BasicOnsetDetectionFunction<float>;
@@ -22,15 +22,11 @@
 #ifndef __ONSETDETECTIONFUNCTION_H
 #define __ONSETDETECTIONFUNCTION_H
 
-#ifdef USE_FFTW
-#include "fftw3.h"
-#endif
-
-#ifdef USE_KISS_FFT
-#include "kiss_fft.h"
-#endif
-
+#include "FFT.h"
+#include "SpectralKernels.h"
 #include <vector>
+#include <array>
+#include <memory>
 
 //=======================================================================
 /** The type of onset detection function to calculate */
@@ -45,9 +41,13 @@ enum OnsetDetectionFunctionType
     ComplexSpectralDifferenceHWR,
     HighFrequencyContent,
     HighFrequencySpectralDifference,
-    HighFrequencySpectralDifferenceHWR
+    HighFrequencySpectralDifferenceHWR,
+    NumOnsetDetectionFunctionTypes      /**< the number of onset detection function types (not a type itself) */
 };
 
+/** A feature mask selecting every onset detection function type (see setFeatureMask()) */
+const unsigned int AllOnsetDetectionFunctionFeatures = (1u << NumOnsetDetectionFunctionTypes) - 1;
+
 //=======================================================================
 /** The type of window to use when calculating onset detection function samples */
 enum WindowType
@@ -60,17 +60,39 @@ enum WindowType
 };
 
 //=======================================================================
-/** A class for calculating onset detection functions. */
-class OnsetDetectionFunction
+/** The method used to predict the target spectral bin in the complex spectral difference
+ * detection functions */
+enum ComplexDomainPredictionMethod
+{
+    PhaseUnwrappingPrediction,
+    ComplexArithmeticPrediction
+};
+
+//=======================================================================
+/** A class for calculating onset detection functions.
+ *
+ * The class is a template on the sample type, so that the frame, window and spectra can be held
+ * in either double precision (OnsetDetectionFunction, the reference implementation) or single
+ * precision (OnsetDetectionFunctionFloat). Single precision halves the memory used by each frame
+ * and doubles the number of bins processed by each SIMD instruction. Detection function samples
+ * from the two versions agree to within 1e-4 of the peak detection function value (see README.md).
+ *
+ * @tparam SampleType the type of the audio and spectral samples (float or double)
+ */
+template <typename SampleType>
+class BasicOnsetDetectionFunction
 {
 public:
     
+    /** A vector holding a sample of every onset detection function type, indexed by OnsetDetectionFunctionType */
+    typedef std::array<SampleType, NumOnsetDetectionFunctionTypes> FeatureVector;
+    
     /** Constructor that defaults the onset detection function type to ComplexSpectralDifferenceHWR
      * and the window type to HanningWindow
      * @param hopSize_ the hop size in audio samples
      * @param frameSize_ the frame size in audio samples
      */
-	OnsetDetectionFunction (int hopSize, int frameSize);
+	BasicOnsetDetectionFunction (int hopSize, int frameSize);
     
     
     /** Constructor 
@@ -79,10 +101,10 @@ public:
      * @param onsetDetectionFunctionType_ the type of onset detection function to use - (see OnsetDetectionFunctionType)
      * @param windowType the type of window to use (see WindowType)
      */
-	OnsetDetectionFunction (int hopSize, int frameSize, int onsetDetectionFunctionType, int windowType);
+	BasicOnsetDetectionFunction (int hopSize, int frameSize, int onsetDetectionFunctionType, int windowType);
     
     /** Destructor */
-	~OnsetDetectionFunction();
+	~BasicOnsetDetectionFunction();
     
     /** Initialisation function for only updating hop size and frame size (and not window type 
      * or onset detection function type
@@ -103,48 +125,131 @@ public:
      * @param buffer a pointer to an array containing the audio samples to be processed
      * @returns the onset detection function sample
      */
-	double calculateOnsetDetectionFunctionSample (double* buffer);
+	SampleType calculateOnsetDetectionFunctionSample (const SampleType* buffer);
+    
+    /** Calculate a detection function sample from a complete frame, for offline use where the whole
+     * signal is already in memory. The frame is read where it is, without being copied. Successive frames
+     * should be one hop size apart, as the detection functions compare each frame with the previous ones
+     * @param fullFrame a pointer to frameSize audio samples, the last of which is the most recent
+     * @returns the onset detection function sample
+     */
+    SampleType calculateOnsetDetectionFunctionSampleFromFrame (const SampleType* fullFrame);
+    
+    /** Process input frame and calculate a sample of every onset detection function type selected by the
+     * feature mask, all from a single FFT and a single magnitude (and, if needed, phase) calculation
+     * @param buffer a pointer to an array containing the audio samples to be processed
+     * @returns the feature vector, in which types not selected by the feature mask are zero
+     */
+    const FeatureVector& calculateOnsetDetectionFunctionFeatures (const SampleType* buffer);
+    
+    /** Calculate a sample of every onset detection function type selected by the feature mask from a
+     * complete frame, which is read where it is (see calculateOnsetDetectionFunctionSampleFromFrame())
+     * @param fullFrame a pointer to frameSize audio samples, the last of which is the most recent
+     * @returns the feature vector, in which types not selected by the feature mask are zero
+     */
+    const FeatureVector& calculateOnsetDetectionFunctionFeaturesFromFrame (const SampleType* fullFrame);
     
     /** Set the detection function type 
      * @param onsetDetectionFunctionType_ the type of onset detection function to use - (see OnsetDetectionFunctionType)
      */
 	void setOnsetDetectionFunctionType (int onsetDetectionFunctionType);
+    
+    /** Set the method used to predict the target spectral bin in the complex spectral difference
+     * detection functions. PhaseUnwrappingPrediction is the original formulation, using atan2() and cos()
+     * on every bin. ComplexArithmeticPrediction (the default) gives the same values, up to rounding, using
+     * only complex multiplication. Changing the method clears the previous spectra.
+     * @param complexDomainPredictionMethod the prediction method to use - (see ComplexDomainPredictionMethod)
+     */
+    void setComplexDomainPredictionMethod (int complexDomainPredictionMethod);
+    
+    /** Select the onset detection function types calculated by calculateOnsetDetectionFunctionFeatures().
+     * Bit n of the mask selects the type with value n, e.g. (1 << SpectralDifference) | (1 << HighFrequencyContent).
+     * The default is AllOnsetDetectionFunctionFeatures. The feature vector and the single detection function
+     * type share their previous spectra, so the two should not be calculated from the same object
+     * @param featureMask a bitmask of the onset detection function types to calculate
+     */
+    void setFeatureMask (unsigned int featureMask);
+    
+    /** Set the FFT implementation used to calculate the spectrum. If the implementation was not compiled
+     * in, or does not support the frame size, the default implementation is used instead
+     * @param fftImplementation the FFT implementation to use (see FFTImplementation)
+     */
+    void setFFTImplementation (int fftImplementation);
+    
+    /** @returns the FFT implementation being used to calculate the spectrum (see FFTImplementation) */
+    int getFFTImplementation() const;
 	
-private:
+protected:
 	
-    /** Perform the FFT on the data in 'frame' */
+    /** Calculate a detection function sample from the given frame
+     * @param frameSamples a pointer to frameSize audio samples, held as a ring buffer
+     * @param oldestSampleIndex the index of the oldest sample in frameSamples
+     * @returns the onset detection function sample
+     */
+    SampleType calculateOnsetDetectionFunctionSample (const SampleType* frameSamples, int oldestSampleIndex);
+    
+    /** Write a hop of audio samples over the oldest samples in the frame
+     * @param buffer a pointer to hopSize audio samples
+     * @param shouldKeepFrameEnergy true to keep the running sum of the squares of the samples in the frame
+     * up to date, which only the energy detection functions need
+     */
+    void addHopToFrame (const SampleType* buffer, bool shouldKeepFrameEnergy);
+    
+    /** Calculate the feature vector from the current frame */
+    void calculateFeatures();
+    
+    /** @returns true if the feature mask selects the given onset detection function type */
+    bool isFeatureSelected (int onsetDetectionFunctionType) const;
+    
+    /** Perform the FFT on the current frame */
 	void performFFT();
+    
+    /** Window the current frame into the FFT input, swapping its first and second halves
+     * @param fftInput the FFT input array, which should hold frameSize samples
+     */
+    void windowFrame (SampleType* fftInput);
 
     //=======================================================================
+    /** @returns the sum of the squares of the samples in the current frame. For the internal frame this
+     * is the running sum kept by addHopToFrame(), otherwise the frame is summed */
+    SampleType calculateFrameEnergy();
+    
     /** Calculate energy envelope detection function sample */
-	double energyEnvelope();
+	SampleType energyEnvelope();
     
     /** Calculate energy difference detection function sample */
-	double energyDifference();
+	SampleType energyDifference();
     
     /** Calculate spectral difference detection function sample */
-	double spectralDifference();
+	SampleType spectralDifference();
     
     /** Calculate spectral difference (half wave rectified) detection function sample */
-	double spectralDifferenceHWR();
+	SampleType spectralDifferenceHWR();
     
     /** Calculate phase deviation detection function sample */
-	double phaseDeviation();
+	SampleType phaseDeviation();
     
     /** Calculate complex spectral difference detection function sample */
-	double complexSpectralDifference();
+	SampleType complexSpectralDifference();
     
     /** Calculate complex spectral difference detection function sample (half-wave rectified) */
-	double complexSpectralDifferenceHWR();
+	SampleType complexSpectralDifferenceHWR();
+    
+    /** Calculate a complex spectral difference detection function sample from the current FFT output,
+     * predicting each target bin from the previous two spectra with complex arithmetic rather than
+     * by unwrapping the phase
+     * @param halfWaveRectify if true, only bins whose magnitude has increased are included in the sum
+     */
+    SampleType complexSpectralDifferenceFromComplexPrediction (bool halfWaveRectify);
     
     /** Calculate high frequency content detection function sample */
-	double highFrequencyContent();
+	SampleType highFrequencyContent();
     
     /** Calculate high frequency spectral difference detection function sample */
-	double highFrequencySpectralDifference();
+	SampleType highFrequencySpectralDifference();
     
     /** Calculate high frequency spectral difference detection function sample (half-wave rectified) */
-	double highFrequencySpectralDifferenceHWR();
+	SampleType highFrequencySpectralDifferenceHWR();
 
     //=======================================================================
     /** Calculate a Rectangular window */
@@ -170,44 +275,67 @@ private:
 	double princarg (double phaseVal);
 	
     void initialiseFFT();
-    void freeFFT();
+    
+    /** @returns the FFT output as numBins interleaved real and imaginary parts */
+    const SampleType* getComplexSpectrum();
 	
 	double pi;							/**< pi, the constant */
 	
 	int frameSize;						/**< audio framesize */
 	int hopSize;						/**< audio hopsize */
 	int onsetDetectionFunctionType;		/**< type of detection function */
+    int complexDomainPredictionMethod;  /**< method used to predict target bins in the complex domain */
     int windowType;                     /**< type of window used in calculations */
+    unsigned int featureMask;           /**< the onset detection function types to include in the feature vector */
+
+	int numBins;						/**< number of non-redundant FFT bins, (frameSize / 2) + 1 */
 
     //=======================================================================
-#ifdef USE_FFTW
-	fftw_plan p;						/**< fftw plan */
-	fftw_complex* complexIn;			/**< to hold complex fft values for input */
-	fftw_complex* complexOut;			/**< to hold complex fft values for output */
-#endif
-    
-#ifdef USE_KISS_FFT
-    kiss_fft_cfg cfg;                   /**< Kiss FFT configuration */
-    kiss_fft_cpx* fftIn;                /**< FFT input samples, in complex form */
-    kiss_fft_cpx* fftOut;               /**< FFT output samples, in complex form */
-    std::vector<std::vector<double> > complexOut;
-#endif
+    int fftImplementation;              /**< the requested FFT implementation (see FFTImplementation) */
+    std::unique_ptr<FFT<SampleType>> fft; /**< the real FFT of frameSize samples */
 	
     //=======================================================================
-	bool initialised;					/**< flag indicating whether buffers and FFT plans are initialised */
+    const SpectralKernels<SampleType>* kernels;    /**< the per-bin loops for the best instruction set this CPU supports */
 
-    std::vector<double> frame;          /**< audio frame */
-    std::vector<double> window;         /**< window */
+    std::vector<SampleType> frame;      /**< audio frame, as a ring buffer */
+    std::vector<SampleType> window;     /**< window, with its first and second halves swapped */
+    
+    int frameWriteIndex;                /**< the index in frame that the next hop will be written to, which holds the oldest sample */
+    const SampleType* currentFrame;     /**< the frame being processed, which is either frame or a frame in the caller's memory */
+    int currentFrameStart;              /**< the index of the oldest sample in currentFrame */
+    
+    std::vector<SampleType> binWeights; /**< how many times each non-redundant bin appears in the full spectrum */
+    std::vector<SampleType> highFrequencyWeights; /**< high frequency content weights of each bin and its mirror image */
 	
-	double prevEnergySum;				/**< to hold the previous energy sum value */
+    FeatureVector features;             /**< the most recent feature vector */
+    
+	SampleType prevEnergySum;				/**< to hold the previous energy sum value */
+    
+    SampleType frameEnergySum;          /**< the running sum of the squares of the samples in frame */
+    int hopsSinceEnergyResummation;     /**< the number of hops added to frameEnergySum since it was last summed exactly, or energyResummationInterval if it is out of date */
+    
+    /** the number of hops after which frameEnergySum is summed exactly again, to stop rounding errors building up */
+    static const int energyResummationInterval = 64;
 	
-    std::vector<double> magSpec;        /**< magnitude spectrum */
-    std::vector<double> prevMagSpec;    /**< previous magnitude spectrum */
+    std::vector<SampleType> magSpec;    /**< magnitude spectrum (numBins values) */
+    std::vector<SampleType> prevMagSpec; /**< previous magnitude spectrum */
 	
-    std::vector<double> phase;          /**< FFT phase values */
-    std::vector<double> prevPhase;      /**< previous phase values */
-    std::vector<double> prevPhase2;     /**< second order previous phase values */
+    std::vector<SampleType> phase;      /**< FFT phase values */
+    std::vector<SampleType> prevPhase;  /**< previous phase values */
+    std::vector<SampleType> prevPhase2; /**< second order previous phase values */
+    
+    std::vector<SampleType> prevPhasorReal; /**< real part of the previous unit phasors */
+    std::vector<SampleType> prevPhasorImag; /**< imaginary part of the previous unit phasors */
+    std::vector<SampleType> prevPhasor2Real; /**< real part of the second order previous unit phasors */
+    std::vector<SampleType> prevPhasor2Imag; /**< imaginary part of the second order previous unit phasors */
 };
 
 
+//=======================================================================
+/** The double precision onset detection function, which is the reference implementation */
+typedef BasicOnsetDetectionFunction<double> OnsetDetectionFunction;
+
+/** The single precision onset detection function */
+typedef BasicOnsetDetectionFunction<float> OnsetDetectionFunctionFloat;
+
 #endif
@@ -0,0 +1,404 @@
+//=======================================================================
+/** @file OnsetDetectionFunctionBodies.h
+ *  @brief The per-hop methods of the onset detection function, which can be inlined
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#ifndef __ONSETDETECTIONFUNCTIONBODIES_H
+#define __ONSETDETECTIONFUNCTIONBODIES_H
+
+// The methods that run on every hop are defined here rather than in OnsetDetectionFunction.cpp,
+// so that StaticOnsetDetectionFunction, whose type is fixed at compile time, can inline the
+// chosen detection function and everything it calls into its frame loop
+
+#include <cmath>
+#include <algorithm>
+#include "OnsetDetectionFunction.h"
+
+//=======================================================================
+template <typename SampleType>
+inline void BasicOnsetDetectionFunction<SampleType>::addHopToFrame (const SampleType* buffer, bool shouldKeepFrameEnergy)
+{
+    // the frame is a ring buffer, so rather than shifting the whole frame back by the hop
+    // size we write the new samples over the oldest ones, wrapping around at the end
+    int firstSegmentLength = std::min (hopSize, frameSize - frameWriteIndex);
+    
+    // for the energy detection functions, keep the energy of the frame up to date by removing the
+    // samples about to be overwritten and adding the new ones, so that they only cost O(hopSize).
+    // The frame is summed exactly instead every energyResummationInterval hops
+    hopsSinceEnergyResummation++;
+    bool shouldUpdateFrameEnergy = shouldKeepFrameEnergy && hopsSinceEnergyResummation < energyResummationInterval;
+    SampleType expiredEnergy = 0;
+    
+    if (shouldUpdateFrameEnergy)
+        expiredEnergy = kernels->sumWeighted (frame.data() + frameWriteIndex, frame.data() + frameWriteIndex, firstSegmentLength)
+                      + kernels->sumWeighted (frame.data(), frame.data(), hopSize - firstSegmentLength);
+    
+    std::copy (buffer, buffer + firstSegmentLength, frame.begin() + frameWriteIndex);
+    std::copy (buffer + firstSegmentLength, buffer + hopSize, frame.begin());
+    
+    frameWriteIndex = (frameWriteIndex + hopSize) % frameSize;
+    
+    if (shouldUpdateFrameEnergy)
+    {
+        frameEnergySum += kernels->sumWeighted (buffer, buffer, hopSize) - expiredEnergy;
+    }
+    else if (shouldKeepFrameEnergy)
+    {
+        frameEnergySum = kernels->sumWeighted (frame.data(), frame.data(), frameSize);
+        hopsSinceEnergyResummation = 0;
+    }
+    else
+    {
+        // the sum is now out of date, so the next hop that keeps it sums the frame exactly
+        hopsSinceEnergyResummation = energyResummationInterval;
+    }
+}
+
+//=======================================================================
+template <typename SampleType>
+inline const SampleType* BasicOnsetDetectionFunction<SampleType>::getComplexSpectrum()
+{
+    return fft->getComplexBuffer();
+}
+
+//=======================================================================
+template <typename SampleType>
+inline void BasicOnsetDetectionFunction<SampleType>::performFFT()
+{
+	// window frame and copy to the fft input
+	windowFrame (fft->getRealBuffer());
+	
+	// perform the fft
+	fft->performForwardTransform();
+}
+
+//=======================================================================
+template <typename SampleType>
+inline void BasicOnsetDetectionFunction<SampleType>::windowFrame (SampleType* fftInput)
+{
+    // the first and second halves of the frame are swapped as it is windowed, so we start reading
+    // half way through the frame and wrap around to its start. The window is stored already swapped
+    int readIndex = (currentFrameStart + (frameSize / 2)) % frameSize;
+    int firstSegmentLength = frameSize - readIndex;
+    
+    for (int i = 0; i < firstSegmentLength; i++)
+        fftInput[i] = currentFrame[readIndex + i] * window[i];
+    
+    for (int i = firstSegmentLength; i < frameSize; i++)
+        fftInput[i] = currentFrame[i - firstSegmentLength] * window[i];
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////// Methods for Onset Detection Functions /////////////////////////////////
+
+//=======================================================================
+template <typename SampleType>
+inline SampleType BasicOnsetDetectionFunction<SampleType>::calculateFrameEnergy()
+{
+    // frames read from the caller's memory are not kept up to date hop by hop, so we sum their squares.
+    // The running sum can stray just below zero between exact sums when the frame falls silent
+    if (currentFrame == frame.data())
+        return std::max (frameEnergySum, SampleType (0));
+    else
+        return kernels->sumWeighted (currentFrame, currentFrame, frameSize);
+}
+
+//=======================================================================
+template <typename SampleType>
+inline SampleType BasicOnsetDetectionFunction<SampleType>::energyEnvelope()
+{
+	// sum the squares of the samples
+	return calculateFrameEnergy();
+}
+
+//=======================================================================
+template <typename SampleType>
+inline SampleType BasicOnsetDetectionFunction<SampleType>::energyDifference()
+{
+	SampleType sum;
+	SampleType sample;
+	
+	// sum the squares of the samples
+	sum = calculateFrameEnergy();
+	
+	sample = sum - prevEnergySum;	// sample is first order difference in energy
+	
+	prevEnergySum = sum;	// store energy value for next calculation
+	
+	if (sample > 0)
+	{
+		return sample;		// return difference
+	}
+	else
+	{
+		return 0;
+	}
+}
+
+//=======================================================================
+template <typename SampleType>
+inline SampleType BasicOnsetDetectionFunction<SampleType>::spectralDifference()
+{
+	// perform the FFT
+	performFFT();
+	
+	// compute (N / 2) + 1 mag values
+	kernels->calculateMagnitudes (getComplexSpectrum(), magSpec.data(), numBins);
+	
+	// sum the absolute differences from the previous magnitude spectrum, and store
+	// the magnitude spectrum for the next detection function sample calculation
+	return kernels->sumMagnitudeDifferences (magSpec.data(), prevMagSpec.data(), binWeights.data(), numBins, false, true);
+}
+
+//=======================================================================
+template <typename SampleType>
+inline SampleType BasicOnsetDetectionFunction<SampleType>::spectralDifferenceHWR()
+{
+	// perform the FFT
+	performFFT();
+	
+	// compute (N / 2) + 1 mag values
+	kernels->calculateMagnitudes (getComplexSpectrum(), magSpec.data(), numBins);
+	
+	// sum only the positive differences from the previous magnitude spectrum, and store
+	// the magnitude spectrum for the next detection function sample calculation
+	return kernels->sumMagnitudeDifferences (magSpec.data(), prevMagSpec.data(), binWeights.data(), numBins, true, true);
+}
+
+
+//=======================================================================
+template <typename SampleType>
+inline SampleType BasicOnsetDetectionFunction<SampleType>::phaseDeviation()
+{
+	double dev,pdev;
+	SampleType sum;
+	
+	// perform the FFT
+	performFFT();
+	
+	const SampleType* spectrum = getComplexSpectrum();
+	
+	sum = 0; // initialise sum to zero
+	
+	// compute phase values from fft output and sum deviations
+	for (int i = 0; i < numBins; i++)
+	{
+		// calculate phase value
+		phase[i] = atan2 (spectrum[(2 * i) + 1], spectrum[2 * i]);
+		
+		// calculate magnitude value
+		magSpec[i] = sqrt (pow (spectrum[2 * i],2) + pow (spectrum[(2 * i) + 1],2));
+		
+		
+		// if bin is not just a low energy bin then examine phase deviation
+		if (magSpec[i] > 0.1)
+		{
+			dev = phase[i] - (2 * prevPhase[i]) + prevPhase2[i];	// phase deviation
+			pdev = princarg (dev);	// wrap into [-pi,pi] range
+		
+			// make all values positive
+			if (pdev < 0)	
+			{
+				pdev = pdev * -1;
+			}
+						
+			// add to sum
+			sum = sum + (binWeights[i] * pdev);
+		}
+				
+		// store values for next calculation
+		prevPhase2[i] = prevPhase[i];
+		prevPhase[i] = phase[i];
+	}
+	
+	return sum;		
+}
+
+//=======================================================================
+template <typename SampleType>
+inline SampleType BasicOnsetDetectionFunction<SampleType>::complexSpectralDifference()
+{
+	double phaseDeviation;
+	SampleType sum;
+	double csd;
+	
+	// perform the FFT
+	performFFT();
+	
+	if (complexDomainPredictionMethod == ComplexArithmeticPrediction)
+		return complexSpectralDifferenceFromComplexPrediction (false);
+	
+	const SampleType* spectrum = getComplexSpectrum();
+	
+	sum = 0; // initialise sum to zero
+	
+	// compute phase values from fft output and sum deviations
+	for (int i = 0; i < numBins; i++)
+	{
+		// calculate phase value
+		phase[i] = atan2 (spectrum[(2 * i) + 1], spectrum[2 * i]);
+		
+		// calculate magnitude value
+		magSpec[i] = sqrt (pow (spectrum[2 * i],2) + pow(spectrum[(2 * i) + 1],2));
+		
+		// phase deviation
+		phaseDeviation = phase[i] - (2 * prevPhase[i]) + prevPhase2[i];
+		
+        // calculate complex spectral difference for the current spectral bin
+		csd = sqrt (pow (magSpec[i], 2) + pow (prevMagSpec[i], 2) - 2 * magSpec[i] * prevMagSpec[i] * cos (phaseDeviation));
+			
+		// add to sum
+		sum = sum + (binWeights[i] * csd);
+		
+		// store values for next calculation
+		prevPhase2[i] = prevPhase[i];
+		prevPhase[i] = phase[i];
+		prevMagSpec[i] = magSpec[i];
+	}
+	
+	return sum;		
+}
+
+//=======================================================================
+template <typename SampleType>
+inline SampleType BasicOnsetDetectionFunction<SampleType>::complexSpectralDifferenceHWR()
+{
+	double phaseDeviation;
+	SampleType sum;
+	double magnitudeDifference;
+	double csd;
+	
+	// perform the FFT
+	performFFT();
+	
+	if (complexDomainPredictionMethod == ComplexArithmeticPrediction)
+		return complexSpectralDifferenceFromComplexPrediction (true);
+	
+	const SampleType* spectrum = getComplexSpectrum();
+	
+	sum = 0; // initialise sum to zero
+	
+	// compute phase values from fft output and sum deviations
+	for (int i = 0; i < numBins; i++)
+	{
+		// calculate phase value
+		phase[i] = atan2 (spectrum[(2 * i) + 1], spectrum[2 * i]);
+		
+		// calculate magnitude value
+		magSpec[i] = sqrt (pow (spectrum[2 * i],2) + pow(spectrum[(2 * i) + 1],2));
+		
+        // phase deviation
+        phaseDeviation = phase[i] - (2 * prevPhase[i]) + prevPhase2[i];
+        
+        // calculate magnitude difference (real part of Euclidean distance between complex frames)
+        magnitudeDifference = magSpec[i] - prevMagSpec[i];
+        
+        // if we have a positive change in magnitude, then include in sum, otherwise ignore (half-wave rectification)
+        if (magnitudeDifference > 0)
+        {
+            // calculate complex spectral difference for the current spectral bin
+            csd = sqrt (pow (magSpec[i], 2) + pow (prevMagSpec[i], 2) - 2 * magSpec[i] * prevMagSpec[i] * cos (phaseDeviation));
+        
+            // add to sum
+            sum = sum + (binWeights[i] * csd);
+        }
+        
+		// store values for next calculation
+		prevPhase2[i] = prevPhase[i];
+		prevPhase[i] = phase[i];
+		prevMagSpec[i] = magSpec[i];
+	}
+	
+	return sum;		
+}
+
+//=======================================================================
+template <typename SampleType>
+inline SampleType BasicOnsetDetectionFunction<SampleType>::complexSpectralDifferenceFromComplexPrediction (bool halfWaveRectify)
+{
+	return kernels->sumComplexSpectralDifferences (getComplexSpectrum(), magSpec.data(), prevMagSpec.data(),
+                                                   prevPhasorReal.data(), prevPhasorImag.data(), prevPhasor2Real.data(), prevPhasor2Imag.data(),
+                                                   binWeights.data(), numBins, halfWaveRectify, true);
+}
+
+//=======================================================================
+template <typename SampleType>
+inline SampleType BasicOnsetDetectionFunction<SampleType>::highFrequencyContent()
+{
+	// perform the FFT
+	performFFT();
+	
+	// calculate magnitude values
+	kernels->calculateMagnitudes (getComplexSpectrum(), magSpec.data(), numBins);
+	
+	// store values for next calculation
+	std::copy (magSpec.begin(), magSpec.end(), prevMagSpec.begin());
+	
+	return kernels->sumWeighted (magSpec.data(), highFrequencyWeights.data(), numBins);
+}
+
+//=======================================================================
+template <typename SampleType>
+inline SampleType BasicOnsetDetectionFunction<SampleType>::highFrequencySpectralDifference()
+{
+	// perform the FFT
+	performFFT();
+	
+	// calculate magnitude values
+	kernels->calculateMagnitudes (getComplexSpectrum(), magSpec.data(), numBins);
+	
+	// sum the frequency weighted absolute differences, storing values for next calculation
+	return kernels->sumMagnitudeDifferences (magSpec.data(), prevMagSpec.data(), highFrequencyWeights.data(), numBins, false, true);
+}
+
+//=======================================================================
+template <typename SampleType>
+inline SampleType BasicOnsetDetectionFunction<SampleType>::highFrequencySpectralDifferenceHWR()
+{
+	// perform the FFT
+	performFFT();
+	
+	// calculate magnitude values
+	kernels->calculateMagnitudes (getComplexSpectrum(), magSpec.data(), numBins);
+	
+	// sum the frequency weighted positive differences, storing values for next calculation
+	return kernels->sumMagnitudeDifferences (magSpec.data(), prevMagSpec.data(), highFrequencyWeights.data(), numBins, true, true);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////// Other Handy Methods //////////////////////////////////////////
+
+//=======================================================================
+template <typename SampleType>
+inline double BasicOnsetDetectionFunction<SampleType>::princarg (double phaseVal)
+{
+	// if phase value is less than or equal to -pi then add 2*pi
+	while (phaseVal <= (-pi))
+        phaseVal = phaseVal + (2 * pi);
+	
+	// if phase value is larger than pi, then subtract 2*pi
+	while (phaseVal > pi)
+        phaseVal = phaseVal - (2 * pi);
+			
+	return phaseVal;
+}
+
+#endif
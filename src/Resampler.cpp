@@ -0,0 +1,207 @@
+//=======================================================================
+/** @file Resampler.cpp
+ *  @brief A fixed-ratio polyphase resampler for the onset detection function
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#include <algorithm>
+#include <cmath>
+#include "Resampler.h"
+
+#ifdef USE_LIBSAMPLERATE
+#include "samplerate.h"
+#endif
+
+//=======================================================================
+Resampler::Resampler()
+{
+    setup (512, 512, HighQualityResampling);
+}
+
+//=======================================================================
+void Resampler::setup (int inputLength_, int outputLength_, int quality_)
+{
+    inputLength = inputLength_;
+    outputLength = outputLength_;
+    quality = quality_;
+
+#ifdef USE_LIBSAMPLERATE
+    if (quality == LibsamplerateResampling)
+    {
+        floatInput.resize (inputLength);
+        floatOutput.resize (outputLength);
+        paddedInput.assign (inputLength, 0.);
+        numTaps = 0;
+        return;
+    }
+#else
+    if (quality == LibsamplerateResampling)
+        quality = HighQualityResampling;
+#endif
+
+    // the number of zero crossings of the sinc each side of the centre, and the Kaiser window's beta
+    int zeroCrossings = 32;
+    double beta = 10.;
+
+    if (quality == LowQualityResampling)
+    {
+        zeroCrossings = 8;
+        beta = 4.5;
+    }
+    else if (quality == MediumQualityResampling)
+    {
+        zeroCrossings = 16;
+        beta = 7.9;
+    }
+
+    // reduce the ratio to its lowest terms
+    int divisor = inputLength;
+
+    for (int remainder = outputLength; remainder != 0;)
+    {
+        int previous = remainder;
+        remainder = divisor % remainder;
+        divisor = previous;
+    }
+
+    numPhases = outputLength / divisor;
+    inputStep = inputLength / divisor;
+
+    // when downsampling, the cutoff falls to the output Nyquist frequency and the filter widens to match
+    double cutoff = std::min (1., static_cast<double> (outputLength) / static_cast<double> (inputLength));
+    double halfWidth = zeroCrossings / cutoff;
+    int halfTaps = static_cast<int> (ceil (halfWidth));
+    numTaps = 2 * halfTaps;
+
+    coefficients.resize (numPhases * numTaps);
+
+    double windowNormalisation = besselI0 (beta);
+
+    for (int phase = 0; phase < numPhases; phase++)
+    {
+        double fraction = static_cast<double> (phase) / static_cast<double> (numPhases);
+        double* phaseCoefficients = &coefficients[phase * numTaps];
+        double sum = 0;
+
+        // tap j multiplies the input sample (halfTaps - 1 - j) + fraction before the output position
+        for (int j = 0; j < numTaps; j++)
+        {
+            double distance = fraction + halfTaps - 1 - j;
+            double coefficient = 0;
+
+            if (fabs (distance) < halfWidth)
+            {
+                double x = M_PI * cutoff * distance;
+                double sinc = (distance == 0) ? 1. : sin (x) / x;
+                double windowPosition = distance / halfWidth;
+                double window = besselI0 (beta * sqrt (1. - windowPosition * windowPosition)) / windowNormalisation;
+
+                // keep the zeros of an integer-spaced sinc exact, so that equal lengths copy the input
+                if (phase == 0 && cutoff == 1. && distance != 0)
+                    sinc = 0;
+
+                coefficient = cutoff * sinc * window;
+            }
+
+            phaseCoefficients[j] = coefficient;
+            sum += coefficient;
+        }
+
+        // normalise each phase to unity gain at DC
+        if (sum != 0)
+            for (int j = 0; j < numTaps; j++)
+                phaseCoefficients[j] /= sum;
+    }
+
+    paddedInput.assign (inputLength + numTaps, 0.);
+}
+
+//=======================================================================
+double* Resampler::getInputBuffer()
+{
+    return paddedInput.data() + (numTaps / 2);
+}
+
+//=======================================================================
+void Resampler::process (double* output)
+{
+#ifdef USE_LIBSAMPLERATE
+    if (quality == LibsamplerateResampling)
+    {
+        std::copy (paddedInput.begin(), paddedInput.end(), floatInput.begin());
+
+        SRC_DATA src_data;
+        src_data.data_in = floatInput.data();
+        src_data.input_frames = inputLength;
+        src_data.src_ratio = static_cast<double> (outputLength) / static_cast<double> (inputLength);
+        src_data.data_out = floatOutput.data();
+        src_data.output_frames = outputLength;
+
+        src_simple (&src_data, SRC_SINC_BEST_QUALITY, 1);
+
+        std::copy (floatOutput.begin(), floatOutput.end(), output);
+        return;
+    }
+#endif
+
+    int inputIndex = 0;
+    int phase = 0;
+
+    for (int n = 0; n < outputLength; n++)
+    {
+        // the input before the output position starts numTaps / 2 samples into the padded input
+        const double* input = &paddedInput[inputIndex + 1];
+        const double* phaseCoefficients = &coefficients[phase * numTaps];
+        double sum = 0;
+
+        for (int j = 0; j < numTaps; j++)
+            sum += phaseCoefficients[j] * input[j];
+
+        output[n] = sum;
+
+        // advance the position by inputStep / numPhases input samples
+        phase += inputStep;
+        inputIndex += phase / numPhases;
+        phase %= numPhases;
+    }
+}
+
+//=======================================================================
+int Resampler::getQuality() const
+{
+    return quality;
+}
+
+//=======================================================================
+double Resampler::besselI0 (double x)
+{
+    double sum = 1;
+    double term = 1;
+    double halfX = x / 2.;
+
+    for (int k = 1; k < 50; k++)
+    {
+        term *= (halfX / k) * (halfX / k);
+        sum += term;
+
+        if (term < sum * 1e-16)
+            break;
+    }
+
+    return sum;
+}
@@ -0,0 +1,92 @@
+//=======================================================================
+/** @file Resampler.h
+ *  @brief A fixed-ratio polyphase resampler for the onset detection function
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#ifndef __RESAMPLER_H
+#define __RESAMPLER_H
+
+#include <vector>
+
+//=======================================================================
+/** The quality of the resampling used before tempo estimation */
+enum ResamplingQuality
+{
+    LowQualityResampling,               /**< a Kaiser windowed sinc filter with 8 zero crossings each side */
+    MediumQualityResampling,            /**< a Kaiser windowed sinc filter with 16 zero crossings each side */
+    HighQualityResampling,              /**< a Kaiser windowed sinc filter with 32 zero crossings each side (the default) */
+    LibsamplerateResampling             /**< libsamplerate's best sinc converter, as used by earlier versions (requires USE_LIBSAMPLERATE, otherwise HighQualityResampling is used) */
+};
+
+//=======================================================================
+/** Resamples a block of a fixed length to a block of another fixed length, treating the signal
+ * as zero outside the block. Output sample n is taken from the input at position
+ * n * inputLength / outputLength, as with libsamplerate's src_simple().
+ *
+ * Once the ratio is reduced to its lowest terms, numPhases / inputStep, the fractional part of
+ * that position only takes numPhases different values, so the windowed sinc filter for each of
+ * them is calculated once in setup() and each output sample is a single dot product. When
+ * downsampling, the filter's cutoff is lowered to the output Nyquist frequency.
+ */
+class Resampler
+{
+public:
+
+    /** Constructor, which sets up a resampler that copies 512 samples unchanged */
+    Resampler();
+
+    /** Sets the lengths of the input and output and calculates the filter coefficients
+     * @param inputLength the number of input samples
+     * @param outputLength the number of output samples
+     * @param quality the resampling quality (see ResamplingQuality)
+     */
+    void setup (int inputLength, int outputLength, int quality);
+
+    /** @returns the buffer of inputLength samples that the next call to process() resamples */
+    double* getInputBuffer();
+
+    /** Resamples the input buffer
+     * @param output an array of outputLength samples to write the result to
+     */
+    void process (double* output);
+
+    /** @returns the resampling quality in use (see ResamplingQuality) */
+    int getQuality() const;
+
+private:
+
+    /** @returns the zeroth order modified Bessel function of the first kind, for the Kaiser window */
+    static double besselI0 (double x);
+
+    int inputLength;                        /**< the number of input samples */
+    int outputLength;                       /**< the number of output samples */
+    int quality;                            /**< the resampling quality (see ResamplingQuality) */
+
+    int numPhases;                          /**< the number of different fractional input positions */
+    int inputStep;                          /**< the distance in input samples between numPhases consecutive output samples */
+    int numTaps;                            /**< the number of filter coefficients for each phase */
+
+    std::vector<double> coefficients;       /**< numTaps coefficients for each phase */
+    std::vector<double> paddedInput;        /**< the input, with numTaps / 2 zeros either side */
+
+    std::vector<float> floatInput;          /**< the input in single precision, for libsamplerate */
+    std::vector<float> floatOutput;         /**< the output in single precision, from libsamplerate */
+};
+
+#endif
@@ -0,0 +1,110 @@
+//=======================================================================
+/** @file SeqLock.h
+ *  @brief A sequence lock for publishing a value from one thread to any number of others
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#ifndef SeqLock_h
+#define SeqLock_h
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+//=======================================================================
+/** Publishes the latest value of something from one thread (the writer) to any number of other
+ * threads (the readers). The writer never waits, so it can be a real-time thread, and the readers
+ * never change anything the writer uses, so there can be as many of them as needed.
+ *
+ * A sequence number is made odd while the writer changes the value and even again afterwards. A
+ * reader copies the value and then checks that the sequence number was the same even number
+ * before and after, and if not, copies it again. The value is held in words that are each read
+ * and written atomically, so that a copy made while the writer is changing it is only ever thrown
+ * away, never a data race.
+ *
+ * @tparam T the type of the value, which must be trivially copyable
+ */
+template <typename T>
+class SeqLock
+{
+public:
+
+    static_assert (std::is_trivially_copyable<T>::value, "SeqLock values must be trivially copyable");
+
+    /** Constructor, which publishes a default constructed value */
+    SeqLock()
+     :  sequence (0)
+    {
+        write (T());
+    }
+
+    //=======================================================================
+    /** Publishes a new value. Only one thread may call this at a time
+     * @param value the value to publish
+     */
+    void write (const T& value)
+    {
+        std::uint32_t buffer[numWords] = {};
+        std::memcpy (buffer, &value, sizeof (T));
+
+        unsigned int start = sequence.load (std::memory_order_relaxed);
+        sequence.store (start + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+
+        for (int i = 0; i < numWords; i++)
+            words[i].store (buffer[i], std::memory_order_relaxed);
+
+        sequence.store (start + 2, std::memory_order_release);
+    }
+
+    //=======================================================================
+    /** @returns the latest value to be published. Any number of threads may call this at once,
+     * and it only waits while the writer is publishing a value */
+    T read() const
+    {
+        std::uint32_t buffer[numWords];
+        unsigned int start;
+        unsigned int end;
+
+        do
+        {
+            start = sequence.load (std::memory_order_acquire);
+
+            for (int i = 0; i < numWords; i++)
+                buffer[i] = words[i].load (std::memory_order_relaxed);
+
+            std::atomic_thread_fence (std::memory_order_acquire);
+            end = sequence.load (std::memory_order_relaxed);
+        }
+        while ((start & 1) != 0 || start != end);
+
+        T value;
+        std::memcpy (&value, buffer, sizeof (T));
+        return value;
+    }
+
+private:
+
+    static const int numWords = (sizeof (T) + sizeof (std::uint32_t) - 1) / sizeof (std::uint32_t);   /**< the number of words the value is held in */
+
+    std::atomic<std::uint32_t> words[numWords];     /**< the value */
+    std::atomic<unsigned int> sequence;             /**< odd while the writer is changing the value, and incremented twice for each value */
+};
+
+#endif /* SeqLock_h */
@@ -0,0 +1,214 @@
+//=======================================================================
+/** @file SpectralKernelBodies.h
+ *  @brief The bodies of the spectral kernels, written once for all instruction sets
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+// This file has no include guard. It is included by SpectralKernels.cpp once for each
+// instruction set and sample type, inside a namespace that defines the sample type Real,
+// the vector type Vec, the number of samples in a vector (vectorWidth), the KERNEL_TARGET
+// function attribute and the vector helper functions. Each loop processes whole vectors
+// and then finishes with scalar code.
+
+//=======================================================================
+KERNEL_TARGET void calculateMagnitudes (const Real* complexSpectrum, Real* magnitudeSpectrum, int numBins)
+{
+    int i = 0;
+
+    for (; i + vectorWidth <= numBins; i += vectorWidth)
+    {
+        Vec real, imag;
+        loadComplex (complexSpectrum + (2 * i), real, imag);
+        store (magnitudeSpectrum + i, squareRoot (add (mul (real, real), mul (imag, imag))));
+    }
+
+    for (; i < numBins; i++)
+    {
+        Real real = complexSpectrum[2 * i];
+        Real imag = complexSpectrum[(2 * i) + 1];
+        magnitudeSpectrum[i] = std::sqrt ((real * real) + (imag * imag));
+    }
+}
+
+//=======================================================================
+KERNEL_TARGET Real sumMagnitudeDifferences (const Real* magnitudeSpectrum, Real* prevMagnitudeSpectrum, const Real* weights, int numBins, bool halfWaveRectify, bool updateHistory)
+{
+    Vec vectorSum = set (Real (0));
+    int i = 0;
+
+    for (; i + vectorWidth <= numBins; i += vectorWidth)
+    {
+        Vec magnitude = load (magnitudeSpectrum + i);
+        Vec difference = sub (magnitude, load (prevMagnitudeSpectrum + i));
+        difference = halfWaveRectify ? maximum (difference, set (Real (0))) : absolute (difference);
+
+        vectorSum = add (vectorSum, mul (load (weights + i), difference));
+        
+        if (updateHistory)
+            store (prevMagnitudeSpectrum + i, magnitude);
+    }
+
+    Real sum = horizontalSum (vectorSum);
+
+    for (; i < numBins; i++)
+    {
+        Real difference = magnitudeSpectrum[i] - prevMagnitudeSpectrum[i];
+        difference = halfWaveRectify ? std::max (difference, Real (0)) : std::abs (difference);
+
+        sum = sum + (weights[i] * difference);
+        
+        if (updateHistory)
+            prevMagnitudeSpectrum[i] = magnitudeSpectrum[i];
+    }
+
+    return sum;
+}
+
+//=======================================================================
+KERNEL_TARGET Real sumWeighted (const Real* values, const Real* weights, int numValues)
+{
+    Vec vectorSum = set (Real (0));
+    int i = 0;
+
+    for (; i + vectorWidth <= numValues; i += vectorWidth)
+        vectorSum = add (vectorSum, mul (load (values + i), load (weights + i)));
+
+    Real sum = horizontalSum (vectorSum);
+
+    for (; i < numValues; i++)
+        sum = sum + (values[i] * weights[i]);
+
+    return sum;
+}
+
+//=======================================================================
+KERNEL_TARGET Real sumComplexSpectralDifferences (const Real* complexSpectrum, Real* magnitudeSpectrum, Real* prevMagnitudeSpectrum,
+                                                    Real* prevPhasorReal, Real* prevPhasorImag, Real* prevPhasor2Real, Real* prevPhasor2Imag,
+                                                    const Real* weights, int numBins, bool halfWaveRectify, bool updateHistory)
+{
+    // The target bin has the previous magnitude and a phase continuing at the previous rate,
+    // 2 * prevPhase - prevPhase2. As a unit phasor this is prevPhasor * prevPhasor * conj (prevPhasor2),
+    // and the current bin times the conjugate of that phasor has a real part of magnitude * cos (phase
+    // deviation). This gives the same distance as unwrapping the phase, without atan2() or cos()
+
+    Vec vectorSum = set (Real (0));
+    int i = 0;
+
+    for (; i + vectorWidth <= numBins; i += vectorWidth)
+    {
+        Vec real, imag;
+        loadComplex (complexSpectrum + (2 * i), real, imag);
+
+        Vec magnitudeSquared = add (mul (real, real), mul (imag, imag));
+        Vec magnitude = squareRoot (magnitudeSquared);
+        Vec prevMagnitude = load (prevMagnitudeSpectrum + i);
+        Vec phasorReal = load (prevPhasorReal + i);
+        Vec phasorImag = load (prevPhasorImag + i);
+        Vec phasor2Real = load (prevPhasor2Real + i);
+        Vec phasor2Imag = load (prevPhasor2Imag + i);
+
+        // predict the target unit phasor
+        Vec squaredReal = sub (mul (phasorReal, phasorReal), mul (phasorImag, phasorImag));
+        Vec squaredImag = mul (add (phasorReal, phasorReal), phasorImag);
+        Vec targetReal = add (mul (squaredReal, phasor2Real), mul (squaredImag, phasor2Imag));
+        Vec targetImag = sub (mul (squaredImag, phasor2Real), mul (squaredReal, phasor2Imag));
+
+        // magnitude * cos (phase deviation)
+        Vec projection = add (mul (real, targetReal), mul (imag, targetImag));
+
+        // calculate complex spectral difference for each bin
+        Vec csdSquared = sub (add (magnitudeSquared, mul (prevMagnitude, prevMagnitude)), mul (set (Real (2)), mul (prevMagnitude, projection)));
+        Vec csd = squareRoot (maximum (csdSquared, set (Real (0))));
+
+        if (halfWaveRectify)
+            csd = selectGreater (magnitude, prevMagnitude, csd, set (Real (0)));
+
+        vectorSum = add (vectorSum, mul (load (weights + i), csd));
+        store (magnitudeSpectrum + i, magnitude);
+
+        // store values for next calculation, with a zero bin taking a phase of zero as atan2() would give
+        if (updateHistory)
+        {
+            store (prevPhasor2Real + i, phasorReal);
+            store (prevPhasor2Imag + i, phasorImag);
+            store (prevPhasorReal + i, selectGreater (magnitude, set (Real (0)), div (real, magnitude), set (Real (1))));
+            store (prevPhasorImag + i, selectGreater (magnitude, set (Real (0)), div (imag, magnitude), set (Real (0))));
+            store (prevMagnitudeSpectrum + i, magnitude);
+        }
+    }
+
+    Real sum = horizontalSum (vectorSum);
+
+    for (; i < numBins; i++)
+    {
+        Real real = complexSpectrum[2 * i];
+        Real imag = complexSpectrum[(2 * i) + 1];
+        Real magnitudeSquared = (real * real) + (imag * imag);
+
+        magnitudeSpectrum[i] = std::sqrt (magnitudeSquared);
+
+        if (! halfWaveRectify || magnitudeSpectrum[i] > prevMagnitudeSpectrum[i])
+        {
+            Real squaredReal = (prevPhasorReal[i] * prevPhasorReal[i]) - (prevPhasorImag[i] * prevPhasorImag[i]);
+            Real squaredImag = Real (2) * prevPhasorReal[i] * prevPhasorImag[i];
+            Real targetReal = (squaredReal * prevPhasor2Real[i]) + (squaredImag * prevPhasor2Imag[i]);
+            Real targetImag = (squaredImag * prevPhasor2Real[i]) - (squaredReal * prevPhasor2Imag[i]);
+            Real projection = (real * targetReal) + (imag * targetImag);
+            Real csdSquared = magnitudeSquared + (prevMagnitudeSpectrum[i] * prevMagnitudeSpectrum[i]) - (Real (2) * prevMagnitudeSpectrum[i] * projection);
+
+            sum = sum + (weights[i] * std::sqrt (std::max (csdSquared, Real (0))));
+        }
+
+        if (updateHistory)
+        {
+            prevPhasor2Real[i] = prevPhasorReal[i];
+            prevPhasor2Imag[i] = prevPhasorImag[i];
+            prevPhasorReal[i] = magnitudeSpectrum[i] > 0 ? real / magnitudeSpectrum[i] : Real (1);
+            prevPhasorImag[i] = magnitudeSpectrum[i] > 0 ? imag / magnitudeSpectrum[i] : Real (0);
+            prevMagnitudeSpectrum[i] = magnitudeSpectrum[i];
+        }
+    }
+
+    return sum;
+}
+
+//=======================================================================
+KERNEL_TARGET void updateMaximumProducts (const Real* values, Real weight, Real* maxima, int numValues)
+{
+    Vec vectorWeight = set (weight);
+    int i = 0;
+
+    for (; i + vectorWidth <= numValues; i += vectorWidth)
+        store (maxima + i, maximum (load (maxima + i), mul (load (values + i), vectorWeight)));
+
+    for (; i < numValues; i++)
+        maxima[i] = std::max (maxima[i], values[i] * weight);
+}
+
+//=======================================================================
+KERNEL_TARGET void updateMaximumSums (const Real* values, Real offset, Real* maxima, int numValues)
+{
+    Vec vectorOffset = set (offset);
+    int i = 0;
+
+    for (; i + vectorWidth <= numValues; i += vectorWidth)
+        store (maxima + i, maximum (load (maxima + i), add (load (values + i), vectorOffset)));
+
+    for (; i < numValues; i++)
+        maxima[i] = std::max (maxima[i], values[i] + offset);
+}
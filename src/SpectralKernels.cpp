@@ -0,0 +1,472 @@
+//=======================================================================
+/** @file SpectralKernels.cpp
+ *  @brief SIMD versions of the per-bin loops used by the onset detection functions and tempo model
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#include <cmath>
+#include <algorithm>
+#include "SpectralKernels.h"
+
+//=======================================================================
+// The x86 kernels are compiled with per-function target attributes (or, with MSVC, which
+// allows any intrinsic anywhere, without them) so that no compiler flags are needed, and
+// are only ever called if the CPU reports support for them
+#if (defined (__x86_64__) || defined (__i386__) || defined (_M_X64)) && ! defined (BTRACK_NO_SIMD)
+#define BTRACK_X86_SIMD 1
+
+// some versions of GCC warn about the undefined registers used inside the AVX-512 intrinsics
+#if defined (__GNUC__) && ! defined (__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+#else
+#include <immintrin.h>
+#endif
+
+#if defined (_MSC_VER)
+#include <intrin.h>
+#define SSE2_TARGET
+#define AVX2_TARGET
+#define AVX512_TARGET
+#else
+#define SSE2_TARGET __attribute__ ((target ("sse2")))
+#define AVX2_TARGET __attribute__ ((target ("avx2")))
+#define AVX512_TARGET __attribute__ ((target ("avx512f")))
+#endif
+#endif
+
+//=======================================================================
+// Each instruction set has a namespace of vector helpers, overloaded for float and double
+// vectors, and the kernel bodies are compiled once for each sample type in the nested
+// Double and Float namespaces
+namespace ScalarKernels
+{
+    template <typename Real> inline Real set (Real v) { return v; }
+    template <typename Real> inline Real load (const Real* p) { return *p; }
+    template <typename Real> inline void store (Real* p, Real v) { *p = v; }
+    template <typename Real> inline Real add (Real a, Real b) { return a + b; }
+    template <typename Real> inline Real sub (Real a, Real b) { return a - b; }
+    template <typename Real> inline Real mul (Real a, Real b) { return a * b; }
+    template <typename Real> inline Real div (Real a, Real b) { return a / b; }
+    template <typename Real> inline Real squareRoot (Real v) { return std::sqrt (v); }
+    template <typename Real> inline Real maximum (Real a, Real b) { return std::max (a, b); }
+    template <typename Real> inline Real absolute (Real v) { return std::abs (v); }
+    template <typename Real> inline Real selectGreater (Real a, Real b, Real x, Real y) { return a > b ? x : y; }
+    template <typename Real> inline Real horizontalSum (Real v) { return v; }
+    template <typename Real> inline void loadComplex (const Real* p, Real& real, Real& imag) { real = p[0]; imag = p[1]; }
+
+#define KERNEL_TARGET
+    namespace Double
+    {
+        typedef double Real;
+        typedef double Vec;
+        const int vectorWidth = 1;
+#include "SpectralKernelBodies.h"
+    }
+
+    namespace Float
+    {
+        typedef float Real;
+        typedef float Vec;
+        const int vectorWidth = 1;
+#include "SpectralKernelBodies.h"
+    }
+#undef KERNEL_TARGET
+}
+
+#ifdef BTRACK_X86_SIMD
+//=======================================================================
+namespace SSE2Kernels
+{
+    SSE2_TARGET inline __m128d set (double v) { return _mm_set1_pd (v); }
+    SSE2_TARGET inline __m128d load (const double* p) { return _mm_loadu_pd (p); }
+    SSE2_TARGET inline void store (double* p, __m128d v) { _mm_storeu_pd (p, v); }
+    SSE2_TARGET inline __m128d add (__m128d a, __m128d b) { return _mm_add_pd (a, b); }
+    SSE2_TARGET inline __m128d sub (__m128d a, __m128d b) { return _mm_sub_pd (a, b); }
+    SSE2_TARGET inline __m128d mul (__m128d a, __m128d b) { return _mm_mul_pd (a, b); }
+    SSE2_TARGET inline __m128d div (__m128d a, __m128d b) { return _mm_div_pd (a, b); }
+    SSE2_TARGET inline __m128d squareRoot (__m128d v) { return _mm_sqrt_pd (v); }
+    SSE2_TARGET inline __m128d maximum (__m128d a, __m128d b) { return _mm_max_pd (a, b); }
+    SSE2_TARGET inline __m128d absolute (__m128d v) { return _mm_andnot_pd (_mm_set1_pd (-0.), v); }
+
+    SSE2_TARGET inline __m128d selectGreater (__m128d a, __m128d b, __m128d x, __m128d y)
+    {
+        __m128d mask = _mm_cmpgt_pd (a, b);
+        return _mm_or_pd (_mm_and_pd (mask, x), _mm_andnot_pd (mask, y));
+    }
+
+    SSE2_TARGET inline double horizontalSum (__m128d v)
+    {
+        return _mm_cvtsd_f64 (_mm_add_sd (v, _mm_unpackhi_pd (v, v)));
+    }
+
+    SSE2_TARGET inline void loadComplex (const double* p, __m128d& real, __m128d& imag)
+    {
+        __m128d a = _mm_loadu_pd (p);       // r0 i0
+        __m128d b = _mm_loadu_pd (p + 2);   // r1 i1
+        real = _mm_unpacklo_pd (a, b);
+        imag = _mm_unpackhi_pd (a, b);
+    }
+
+    SSE2_TARGET inline __m128 set (float v) { return _mm_set1_ps (v); }
+    SSE2_TARGET inline __m128 load (const float* p) { return _mm_loadu_ps (p); }
+    SSE2_TARGET inline void store (float* p, __m128 v) { _mm_storeu_ps (p, v); }
+    SSE2_TARGET inline __m128 add (__m128 a, __m128 b) { return _mm_add_ps (a, b); }
+    SSE2_TARGET inline __m128 sub (__m128 a, __m128 b) { return _mm_sub_ps (a, b); }
+    SSE2_TARGET inline __m128 mul (__m128 a, __m128 b) { return _mm_mul_ps (a, b); }
+    SSE2_TARGET inline __m128 div (__m128 a, __m128 b) { return _mm_div_ps (a, b); }
+    SSE2_TARGET inline __m128 squareRoot (__m128 v) { return _mm_sqrt_ps (v); }
+    SSE2_TARGET inline __m128 maximum (__m128 a, __m128 b) { return _mm_max_ps (a, b); }
+    SSE2_TARGET inline __m128 absolute (__m128 v) { return _mm_andnot_ps (_mm_set1_ps (-0.f), v); }
+
+    SSE2_TARGET inline __m128 selectGreater (__m128 a, __m128 b, __m128 x, __m128 y)
+    {
+        __m128 mask = _mm_cmpgt_ps (a, b);
+        return _mm_or_ps (_mm_and_ps (mask, x), _mm_andnot_ps (mask, y));
+    }
+
+    SSE2_TARGET inline float horizontalSum (__m128 v)
+    {
+        __m128 pair = _mm_add_ps (v, _mm_movehl_ps (v, v));
+        return _mm_cvtss_f32 (_mm_add_ss (pair, _mm_shuffle_ps (pair, pair, _MM_SHUFFLE (1, 1, 1, 1))));
+    }
+
+    SSE2_TARGET inline void loadComplex (const float* p, __m128& real, __m128& imag)
+    {
+        __m128 a = _mm_loadu_ps (p);        // r0 i0 r1 i1
+        __m128 b = _mm_loadu_ps (p + 4);    // r2 i2 r3 i3
+        real = _mm_shuffle_ps (a, b, _MM_SHUFFLE (2, 0, 2, 0));
+        imag = _mm_shuffle_ps (a, b, _MM_SHUFFLE (3, 1, 3, 1));
+    }
+
+#define KERNEL_TARGET SSE2_TARGET
+    namespace Double
+    {
+        typedef double Real;
+        typedef __m128d Vec;
+        const int vectorWidth = 2;
+#include "SpectralKernelBodies.h"
+    }
+
+    namespace Float
+    {
+        typedef float Real;
+        typedef __m128 Vec;
+        const int vectorWidth = 4;
+#include "SpectralKernelBodies.h"
+    }
+#undef KERNEL_TARGET
+}
+
+//=======================================================================
+namespace AVX2Kernels
+{
+    AVX2_TARGET inline __m256d set (double v) { return _mm256_set1_pd (v); }
+    AVX2_TARGET inline __m256d load (const double* p) { return _mm256_loadu_pd (p); }
+    AVX2_TARGET inline void store (double* p, __m256d v) { _mm256_storeu_pd (p, v); }
+    AVX2_TARGET inline __m256d add (__m256d a, __m256d b) { return _mm256_add_pd (a, b); }
+    AVX2_TARGET inline __m256d sub (__m256d a, __m256d b) { return _mm256_sub_pd (a, b); }
+    AVX2_TARGET inline __m256d mul (__m256d a, __m256d b) { return _mm256_mul_pd (a, b); }
+    AVX2_TARGET inline __m256d div (__m256d a, __m256d b) { return _mm256_div_pd (a, b); }
+    AVX2_TARGET inline __m256d squareRoot (__m256d v) { return _mm256_sqrt_pd (v); }
+    AVX2_TARGET inline __m256d maximum (__m256d a, __m256d b) { return _mm256_max_pd (a, b); }
+    AVX2_TARGET inline __m256d absolute (__m256d v) { return _mm256_andnot_pd (_mm256_set1_pd (-0.), v); }
+
+    AVX2_TARGET inline __m256d selectGreater (__m256d a, __m256d b, __m256d x, __m256d y)
+    {
+        return _mm256_blendv_pd (y, x, _mm256_cmp_pd (a, b, _CMP_GT_OQ));
+    }
+
+    AVX2_TARGET inline double horizontalSum (__m256d v)
+    {
+        __m128d pair = _mm_add_pd (_mm256_castpd256_pd128 (v), _mm256_extractf128_pd (v, 1));
+        return _mm_cvtsd_f64 (_mm_add_sd (pair, _mm_unpackhi_pd (pair, pair)));
+    }
+
+    AVX2_TARGET inline void loadComplex (const double* p, __m256d& real, __m256d& imag)
+    {
+        __m256d a = _mm256_loadu_pd (p);        // r0 i0 r1 i1
+        __m256d b = _mm256_loadu_pd (p + 4);    // r2 i2 r3 i3
+        real = _mm256_permute4x64_pd (_mm256_unpacklo_pd (a, b), _MM_SHUFFLE (3, 1, 2, 0));
+        imag = _mm256_permute4x64_pd (_mm256_unpackhi_pd (a, b), _MM_SHUFFLE (3, 1, 2, 0));
+    }
+
+    AVX2_TARGET inline __m256 set (float v) { return _mm256_set1_ps (v); }
+    AVX2_TARGET inline __m256 load (const float* p) { return _mm256_loadu_ps (p); }
+    AVX2_TARGET inline void store (float* p, __m256 v) { _mm256_storeu_ps (p, v); }
+    AVX2_TARGET inline __m256 add (__m256 a, __m256 b) { return _mm256_add_ps (a, b); }
+    AVX2_TARGET inline __m256 sub (__m256 a, __m256 b) { return _mm256_sub_ps (a, b); }
+    AVX2_TARGET inline __m256 mul (__m256 a, __m256 b) { return _mm256_mul_ps (a, b); }
+    AVX2_TARGET inline __m256 div (__m256 a, __m256 b) { return _mm256_div_ps (a, b); }
+    AVX2_TARGET inline __m256 squareRoot (__m256 v) { return _mm256_sqrt_ps (v); }
+    AVX2_TARGET inline __m256 maximum (__m256 a, __m256 b) { return _mm256_max_ps (a, b); }
+    AVX2_TARGET inline __m256 absolute (__m256 v) { return _mm256_andnot_ps (_mm256_set1_ps (-0.f), v); }
+
+    AVX2_TARGET inline __m256 selectGreater (__m256 a, __m256 b, __m256 x, __m256 y)
+    {
+        return _mm256_blendv_ps (y, x, _mm256_cmp_ps (a, b, _CMP_GT_OQ));
+    }
+
+    AVX2_TARGET inline float horizontalSum (__m256 v)
+    {
+        __m128 quad = _mm_add_ps (_mm256_castps256_ps128 (v), _mm256_extractf128_ps (v, 1));
+        __m128 pair = _mm_add_ps (quad, _mm_movehl_ps (quad, quad));
+        return _mm_cvtss_f32 (_mm_add_ss (pair, _mm_shuffle_ps (pair, pair, _MM_SHUFFLE (1, 1, 1, 1))));
+    }
+
+    AVX2_TARGET inline void loadComplex (const float* p, __m256& real, __m256& imag)
+    {
+        __m256 a = _mm256_loadu_ps (p);        // r0 i0 r1 i1 r2 i2 r3 i3
+        __m256 b = _mm256_loadu_ps (p + 8);    // r4 i4 r5 i5 r6 i6 r7 i7
+
+        // the shuffles work within 128-bit lanes, so the 64-bit pairs are then put back in order
+        __m256 realPairs = _mm256_shuffle_ps (a, b, _MM_SHUFFLE (2, 0, 2, 0));
+        __m256 imagPairs = _mm256_shuffle_ps (a, b, _MM_SHUFFLE (3, 1, 3, 1));
+        real = _mm256_castpd_ps (_mm256_permute4x64_pd (_mm256_castps_pd (realPairs), _MM_SHUFFLE (3, 1, 2, 0)));
+        imag = _mm256_castpd_ps (_mm256_permute4x64_pd (_mm256_castps_pd (imagPairs), _MM_SHUFFLE (3, 1, 2, 0)));
+    }
+
+#define KERNEL_TARGET AVX2_TARGET
+    namespace Double
+    {
+        typedef double Real;
+        typedef __m256d Vec;
+        const int vectorWidth = 4;
+#include "SpectralKernelBodies.h"
+    }
+
+    namespace Float
+    {
+        typedef float Real;
+        typedef __m256 Vec;
+        const int vectorWidth = 8;
+#include "SpectralKernelBodies.h"
+    }
+#undef KERNEL_TARGET
+}
+
+//=======================================================================
+namespace AVX512Kernels
+{
+    AVX512_TARGET inline __m512d set (double v) { return _mm512_set1_pd (v); }
+    AVX512_TARGET inline __m512d load (const double* p) { return _mm512_loadu_pd (p); }
+    AVX512_TARGET inline void store (double* p, __m512d v) { _mm512_storeu_pd (p, v); }
+    AVX512_TARGET inline __m512d add (__m512d a, __m512d b) { return _mm512_add_pd (a, b); }
+    AVX512_TARGET inline __m512d sub (__m512d a, __m512d b) { return _mm512_sub_pd (a, b); }
+    AVX512_TARGET inline __m512d mul (__m512d a, __m512d b) { return _mm512_mul_pd (a, b); }
+    AVX512_TARGET inline __m512d div (__m512d a, __m512d b) { return _mm512_div_pd (a, b); }
+    AVX512_TARGET inline __m512d squareRoot (__m512d v) { return _mm512_sqrt_pd (v); }
+    AVX512_TARGET inline __m512d maximum (__m512d a, __m512d b) { return _mm512_max_pd (a, b); }
+    AVX512_TARGET inline __m512d absolute (__m512d v) { return _mm512_abs_pd (v); }
+
+    AVX512_TARGET inline __m512d selectGreater (__m512d a, __m512d b, __m512d x, __m512d y)
+    {
+        return _mm512_mask_blend_pd (_mm512_cmp_pd_mask (a, b, _CMP_GT_OQ), y, x);
+    }
+
+    AVX512_TARGET inline double horizontalSum (__m512d v)
+    {
+        return _mm512_reduce_add_pd (v);
+    }
+
+    AVX512_TARGET inline void loadComplex (const double* p, __m512d& real, __m512d& imag)
+    {
+        __m512d a = _mm512_loadu_pd (p);
+        __m512d b = _mm512_loadu_pd (p + 8);
+        real = _mm512_permutex2var_pd (a, _mm512_set_epi64 (14, 12, 10, 8, 6, 4, 2, 0), b);
+        imag = _mm512_permutex2var_pd (a, _mm512_set_epi64 (15, 13, 11, 9, 7, 5, 3, 1), b);
+    }
+
+    AVX512_TARGET inline __m512 set (float v) { return _mm512_set1_ps (v); }
+    AVX512_TARGET inline __m512 load (const float* p) { return _mm512_loadu_ps (p); }
+    AVX512_TARGET inline void store (float* p, __m512 v) { _mm512_storeu_ps (p, v); }
+    AVX512_TARGET inline __m512 add (__m512 a, __m512 b) { return _mm512_add_ps (a, b); }
+    AVX512_TARGET inline __m512 sub (__m512 a, __m512 b) { return _mm512_sub_ps (a, b); }
+    AVX512_TARGET inline __m512 mul (__m512 a, __m512 b) { return _mm512_mul_ps (a, b); }
+    AVX512_TARGET inline __m512 div (__m512 a, __m512 b) { return _mm512_div_ps (a, b); }
+    AVX512_TARGET inline __m512 squareRoot (__m512 v) { return _mm512_sqrt_ps (v); }
+    AVX512_TARGET inline __m512 maximum (__m512 a, __m512 b) { return _mm512_max_ps (a, b); }
+    AVX512_TARGET inline __m512 absolute (__m512 v) { return _mm512_abs_ps (v); }
+
+    AVX512_TARGET inline __m512 selectGreater (__m512 a, __m512 b, __m512 x, __m512 y)
+    {
+        return _mm512_mask_blend_ps (_mm512_cmp_ps_mask (a, b, _CMP_GT_OQ), y, x);
+    }
+
+    AVX512_TARGET inline float horizontalSum (__m512 v)
+    {
+        return _mm512_reduce_add_ps (v);
+    }
+
+    AVX512_TARGET inline void loadComplex (const float* p, __m512& real, __m512& imag)
+    {
+        __m512 a = _mm512_loadu_ps (p);
+        __m512 b = _mm512_loadu_ps (p + 16);
+        real = _mm512_permutex2var_ps (a, _mm512_set_epi32 (30, 28, 26, 24, 22, 20, 18, 16, 14, 12, 10, 8, 6, 4, 2, 0), b);
+        imag = _mm512_permutex2var_ps (a, _mm512_set_epi32 (31, 29, 27, 25, 23, 21, 19, 17, 15, 13, 11, 9, 7, 5, 3, 1), b);
+    }
+
+#define KERNEL_TARGET AVX512_TARGET
+    namespace Double
+    {
+        typedef double Real;
+        typedef __m512d Vec;
+        const int vectorWidth = 8;
+#include "SpectralKernelBodies.h"
+    }
+
+    namespace Float
+    {
+        typedef float Real;
+        typedef __m512 Vec;
+        const int vectorWidth = 16;
+#include "SpectralKernelBodies.h"
+    }
+#undef KERNEL_TARGET
+}
+
+//=======================================================================
+static bool cpuSupports (int instructionSet)
+{
+#if defined (_MSC_VER)
+    int info[4];
+    __cpuid (info, 0);
+    int maxLeaf = info[0];
+
+    __cpuid (info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+
+    if (instructionSet == SSE2Instructions)
+        return sse2;
+
+    if (! osxsave || maxLeaf < 7)
+        return false;
+
+    unsigned long long enabledState = _xgetbv (0);
+    __cpuidex (info, 7, 0);
+
+    if (instructionSet == AVX2Instructions)
+        return ((enabledState & 0x6) == 0x6) && (info[1] & (1 << 5)) != 0;
+
+    if (instructionSet == AVX512Instructions)
+        return ((enabledState & 0xE6) == 0xE6) && (info[1] & (1 << 16)) != 0;
+
+    return false;
+#else
+    __builtin_cpu_init();
+
+    switch (instructionSet)
+    {
+        case SSE2Instructions:
+            return __builtin_cpu_supports ("sse2");
+        case AVX2Instructions:
+            return __builtin_cpu_supports ("avx2");
+        case AVX512Instructions:
+            return __builtin_cpu_supports ("avx512f");
+        default:
+            return false;
+    }
+#endif
+}
+#endif
+
+//=======================================================================
+#define BTRACK_SPECTRAL_KERNEL_TABLE(Namespace) \
+    { Namespace::calculateMagnitudes, Namespace::sumMagnitudeDifferences, Namespace::sumWeighted, Namespace::sumComplexSpectralDifferences, \
+      Namespace::updateMaximumProducts, Namespace::updateMaximumSums }
+
+// the kernel tables for each sample type, indexed by SIMDInstructionSet
+static const SpectralKernels<double> doubleKernels[] =
+{
+    BTRACK_SPECTRAL_KERNEL_TABLE (ScalarKernels::Double),
+#ifdef BTRACK_X86_SIMD
+    BTRACK_SPECTRAL_KERNEL_TABLE (SSE2Kernels::Double),
+    BTRACK_SPECTRAL_KERNEL_TABLE (AVX2Kernels::Double),
+    BTRACK_SPECTRAL_KERNEL_TABLE (AVX512Kernels::Double)
+#endif
+};
+
+static const SpectralKernels<float> floatKernels[] =
+{
+    BTRACK_SPECTRAL_KERNEL_TABLE (ScalarKernels::Float),
+#ifdef BTRACK_X86_SIMD
+    BTRACK_SPECTRAL_KERNEL_TABLE (SSE2Kernels::Float),
+    BTRACK_SPECTRAL_KERNEL_TABLE (AVX2Kernels::Float),
+    BTRACK_SPECTRAL_KERNEL_TABLE (AVX512Kernels::Float)
+#endif
+};
+
+//=======================================================================
+template <typename Real>
+bool SpectralKernels<Real>::isSupported (int instructionSet)
+{
+    if (instructionSet == ScalarInstructions)
+        return true;
+
+#ifdef BTRACK_X86_SIMD
+    return cpuSupports (instructionSet);
+#else
+    return false;
+#endif
+}
+
+//=======================================================================
+template <typename Real>
+int SpectralKernels<Real>::getBestSupportedInstructionSet()
+{
+    if (isSupported (AVX512Instructions))
+        return AVX512Instructions;
+
+    if (isSupported (AVX2Instructions))
+        return AVX2Instructions;
+
+    if (isSupported (SSE2Instructions))
+        return SSE2Instructions;
+
+    return ScalarInstructions;
+}
+
+//=======================================================================
+template <>
+const SpectralKernels<double>& SpectralKernels<double>::getKernels (int instructionSet)
+{
+    return isSupported (instructionSet) ? doubleKernels[instructionSet] : doubleKernels[ScalarInstructions];
+}
+
+//=======================================================================
+template <>
+const SpectralKernels<float>& SpectralKernels<float>::getKernels (int instructionSet)
+{
+    return isSupported (instructionSet) ? floatKernels[instructionSet] : floatKernels[ScalarInstructions];
+}
+
+//=======================================================================
+template <typename Real>
+const SpectralKernels<Real>& SpectralKernels<Real>::getBestKernels()
+{
+    static const SpectralKernels<Real>& bestKernels = getKernels (getBestSupportedInstructionSet());
+    return bestKernels;
+}
+
+//=======================================================================
+template struct SpectralKernels<double>;
+template struct SpectralKernels<float>;
@@ -0,0 +1,132 @@
+//=======================================================================
+/** @file SpectralKernels.h
+ *  @brief SIMD versions of the per-bin loops used by the onset detection functions and tempo model
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#ifndef __SPECTRALKERNELS_H
+#define __SPECTRALKERNELS_H
+
+//=======================================================================
+/** The instruction sets that the spectral kernels are compiled for */
+enum SIMDInstructionSet
+{
+    ScalarInstructions,
+    SSE2Instructions,
+    AVX2Instructions,
+    AVX512Instructions
+};
+
+//=======================================================================
+/** A table of the per-bin loops used to calculate onset detection functions (and the per-state
+ * loops of the tempo model), compiled for one instruction set. On x86 processors, versions for SSE2, AVX2 and AVX-512 are
+ * built without any special compiler flags and the best one is chosen at run time from
+ * the features of the CPU. Everywhere else the scalar versions are used.
+ *
+ * Complex spectra are arrays of interleaved real and imaginary parts, as produced by
+ * FFTW and Kiss FFT.
+ *
+ * @tparam Real the sample type (float or double). Float kernels process twice as many
+ * bins per instruction.
+ */
+template <typename Real>
+struct SpectralKernels
+{
+    /** Calculates the magnitude of each bin of a complex spectrum
+     * @param complexSpectrum the complex spectrum (numBins interleaved real and imaginary parts)
+     * @param magnitudeSpectrum the array to write the magnitudes to
+     * @param numBins the number of bins
+     */
+    void (*calculateMagnitudes) (const Real* complexSpectrum, Real* magnitudeSpectrum, int numBins);
+
+    /** Sums the weighted differences between a magnitude spectrum and the previous one, and then
+     * optionally stores the magnitude spectrum as the previous one for the next call
+     * @param magnitudeSpectrum the current magnitude spectrum
+     * @param prevMagnitudeSpectrum the previous magnitude spectrum
+     * @param weights the weight of each bin
+     * @param numBins the number of bins
+     * @param halfWaveRectify if true, only increases in magnitude are summed, otherwise absolute differences are summed
+     * @param updateHistory if true, prevMagnitudeSpectrum is overwritten with the current magnitude spectrum
+     * @returns the weighted sum of differences
+     */
+    Real (*sumMagnitudeDifferences) (const Real* magnitudeSpectrum, Real* prevMagnitudeSpectrum, const Real* weights, int numBins, bool halfWaveRectify, bool updateHistory);
+
+    /** Calculates the weighted sum of an array
+     * @param values the values to sum
+     * @param weights the weight of each value
+     * @param numValues the number of values
+     * @returns the sum of values[i] * weights[i]
+     */
+    Real (*sumWeighted) (const Real* values, const Real* weights, int numValues);
+
+    /** Sums the weighted complex spectral difference of each bin, predicting the target bin from the
+     * previous magnitude and the previous two unit phasors, and then optionally updates the history for the next call
+     * @param complexSpectrum the complex spectrum (numBins interleaved real and imaginary parts)
+     * @param magnitudeSpectrum the array to write the magnitudes to
+     * @param prevMagnitudeSpectrum the previous magnitude spectrum
+     * @param prevPhasorReal the real parts of the previous unit phasors
+     * @param prevPhasorImag the imaginary parts of the previous unit phasors
+     * @param prevPhasor2Real the real parts of the second order previous unit phasors
+     * @param prevPhasor2Imag the imaginary parts of the second order previous unit phasors
+     * @param weights the weight of each bin
+     * @param numBins the number of bins
+     * @param halfWaveRectify if true, only bins whose magnitude has increased are summed
+     * @param updateHistory if true, the previous magnitudes and unit phasors are updated from the current spectrum
+     * @returns the weighted sum of complex spectral differences
+     */
+    Real (*sumComplexSpectralDifferences) (const Real* complexSpectrum, Real* magnitudeSpectrum, Real* prevMagnitudeSpectrum,
+                                           Real* prevPhasorReal, Real* prevPhasorImag, Real* prevPhasor2Real, Real* prevPhasor2Imag,
+                                           const Real* weights, int numBins, bool halfWaveRectify, bool updateHistory);
+
+    /** Raises each running maximum to the matching value times a weight, if that is larger. This is
+     * one diagonal of the max-product used by the tempo model's Viterbi update
+     * @param values the values
+     * @param weight the weight to multiply every value by
+     * @param maxima the running maxima, which are updated
+     * @param numValues the number of values
+     */
+    void (*updateMaximumProducts) (const Real* values, Real weight, Real* maxima, int numValues);
+
+    /** Raises each running maximum to the matching value plus an offset, if that is larger. This is
+     * one diagonal of the max-sum used by the tempo model's Viterbi update in the log domain
+     * @param values the values
+     * @param offset the offset to add to every value
+     * @param maxima the running maxima, which are updated
+     * @param numValues the number of values
+     */
+    void (*updateMaximumSums) (const Real* values, Real offset, Real* maxima, int numValues);
+
+    //=======================================================================
+    /** @returns true if kernels for the given instruction set were compiled and the CPU supports them
+     * @param instructionSet the instruction set (see SIMDInstructionSet)
+     */
+    static bool isSupported (int instructionSet);
+
+    /** @returns the best instruction set supported by both the build and the CPU */
+    static int getBestSupportedInstructionSet();
+
+    /** @returns the kernels for the given instruction set, or the scalar kernels if it is not supported
+     * @param instructionSet the instruction set (see SIMDInstructionSet)
+     */
+    static const SpectralKernels& getKernels (int instructionSet);
+
+    /** @returns the kernels for the best supported instruction set, which is chosen on the first call */
+    static const SpectralKernels& getBestKernels();
+};
+
+#endif
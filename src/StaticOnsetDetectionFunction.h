@@ -0,0 +1,144 @@
+//=======================================================================
+/** @file StaticOnsetDetectionFunction.h
+ *  @brief An onset detection function whose type and window are chosen at compile time
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#ifndef __STATICONSETDETECTIONFUNCTION_H
+#define __STATICONSETDETECTIONFUNCTION_H
+
+#include "OnsetDetectionFunction.h"
+#include "OnsetDetectionFunctionBodies.h"
+
+//=======================================================================
+// inlines everything the detection function calls into the function it is applied to, where the compiler supports it
+#if defined (__GNUC__)
+#define BTRACK_INLINE_CALLEES __attribute__ ((flatten))
+#else
+#define BTRACK_INLINE_CALLEES
+#endif
+
+//=======================================================================
+/** An onset detection function whose type and window are template parameters. Where
+ * OnsetDetectionFunction chooses the detection function with a switch on every hop,
+ * this class calls the chosen one directly, and it cannot be changed at run time.
+ * It gives exactly the same detection function samples as OnsetDetectionFunction
+ * configured with the same type and window.
+ *
+ * The class is built on the run-time configurable one, privately, so that the two share one
+ * implementation of the frame buffer, FFT and detection functions. The detection functions are
+ * defined in OnsetDetectionFunctionBodies.h, so the one chosen here is inlined into
+ * calculateOnsetDetectionFunctionSample() rather than called out of line.
+ *
+ * @tparam Type the type of onset detection function to calculate (see OnsetDetectionFunctionType)
+ * @tparam Window the type of window to use (see WindowType)
+ * @tparam SampleType the type of the audio and spectral samples (float or double)
+ */
+template <OnsetDetectionFunctionType Type, WindowType Window = HanningWindow, typename SampleType = double>
+class StaticOnsetDetectionFunction : private BasicOnsetDetectionFunction<SampleType>
+{
+    typedef BasicOnsetDetectionFunction<SampleType> Base;
+    
+    static_assert (Type >= EnergyEnvelope && Type < NumOnsetDetectionFunctionTypes, "Type must be an onset detection function type");
+    
+public:
+    
+    /** Constructor
+     * @param hopSize the hop size in audio samples
+     * @param frameSize the frame size in audio samples
+     */
+    StaticOnsetDetectionFunction (int hopSize, int frameSize)
+     :  Base (hopSize, frameSize, Type, Window)
+    {
+    }
+    
+    /** Initialisation function for updating the hop size and frame size
+     * @param hopSize the hop size in audio samples
+     * @param frameSize the frame size in audio samples
+     */
+    void initialise (int hopSize, int frameSize)
+    {
+        Base::initialise (hopSize, frameSize);
+    }
+    
+    /** Process input frame and calculate detection function sample
+     * @param buffer a pointer to an array containing the audio samples to be processed
+     * @returns the onset detection function sample
+     */
+    BTRACK_INLINE_CALLEES SampleType calculateOnsetDetectionFunctionSample (const SampleType* buffer)
+    {
+        this->addHopToFrame (buffer, Type == EnergyEnvelope || Type == EnergyDifference);
+        
+        this->currentFrame = this->frame.data();
+        this->currentFrameStart = this->frameWriteIndex;
+        
+        return calculateSampleFromCurrentFrame();
+    }
+    
+    /** Calculate a detection function sample from a complete frame, which is read where it is
+     * (see OnsetDetectionFunction::calculateOnsetDetectionFunctionSampleFromFrame())
+     * @param fullFrame a pointer to frameSize audio samples, the last of which is the most recent
+     * @returns the onset detection function sample
+     */
+    SampleType calculateOnsetDetectionFunctionSampleFromFrame (const SampleType* fullFrame)
+    {
+        this->currentFrame = fullFrame;
+        this->currentFrameStart = 0;
+        
+        return calculateSampleFromCurrentFrame();
+    }
+    
+    using Base::setComplexDomainPredictionMethod;
+    using Base::setFFTImplementation;
+    using Base::getFFTImplementation;
+    
+private:
+    
+    /** @returns the detection function sample for the current frame. Type is a constant,
+     * so the compiler reduces the switch to the chosen detection function, which is inlined */
+    BTRACK_INLINE_CALLEES SampleType calculateSampleFromCurrentFrame()
+    {
+        switch (Type)
+        {
+            case EnergyEnvelope:
+                return this->energyEnvelope();
+            case EnergyDifference:
+                return this->energyDifference();
+            case SpectralDifference:
+                return this->spectralDifference();
+            case SpectralDifferenceHWR:
+                return this->spectralDifferenceHWR();
+            case PhaseDeviation:
+                return this->phaseDeviation();
+            case ComplexSpectralDifference:
+                return this->complexSpectralDifference();
+            case ComplexSpectralDifferenceHWR:
+                return this->complexSpectralDifferenceHWR();
+            case HighFrequencyContent:
+                return this->highFrequencyContent();
+            case HighFrequencySpectralDifference:
+                return this->highFrequencySpectralDifference();
+            case HighFrequencySpectralDifferenceHWR:
+                return this->highFrequencySpectralDifferenceHWR();
+            default:
+                return SampleType (1);
+        }
+    }
+};
+
+#endif
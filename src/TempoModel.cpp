@@ -0,0 +1,321 @@
+//=======================================================================
+/** @file TempoModel.cpp
+ *  @brief The hidden Markov model of tempo used to choose the beat period
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include "TempoModel.h"
+
+//=======================================================================
+template <int NumStates>
+TempoModel<NumStates>::TempoModel (const TempoRange& tempoRange)
+{
+    numStates = NumStates != DynamicNumTempoStates ? NumStates : std::max (tempoRange.numStates, 2);
+
+    // keep the range above the slowest tempo that can be tracked, and the right way round
+    minimumTempo = std::max (tempoRange.minimumTempo, getSlowestTempo());
+    double maximumTempo = tempoRange.maximumTempo > minimumTempo ? tempoRange.maximumTempo : minimumTempo + (numStates - 1);
+    tempoStep = (maximumTempo - minimumTempo) / (numStates - 1);
+    tempoFixed = false;
+    logDomain = false;
+    logOffset = 0;
+    kernels = &SpectralKernels<double>::getBestKernels();
+
+    TempoStateStorage<double, NumStates>::resize (transitionWeights, numStates);
+    TempoStateStorage<double, NumStates>::resize (logTransitionWeights, numStates);
+    TempoStateStorage<double, 3 * NumStates>::resize (paddedPrevDelta, 3 * numStates);
+    TempoStateStorage<double, NumStates>::resize (tempoObservationVector, numStates);
+    TempoStateStorage<double, NumStates>::resize (delta, numStates);
+    TempoStateStorage<double, NumStates>::resize (prevDelta, numStates);
+    TempoStateStorage<double, NumStates>::resize (prevDeltaFixed, numStates);
+    TempoStateStorage<int, NumStates>::resize (observationLags, numStates);
+    TempoStateStorage<int, NumStates>::resize (halfObservationLags, numStates);
+
+    std::fill (delta.begin(), delta.end(), 0);
+    std::fill (prevDeltaFixed.begin(), prevDeltaFixed.end(), 0);
+
+    // initialise prevDelta
+    std::fill (prevDelta.begin(), prevDelta.end(), 1);
+
+    // the transitions have a standard deviation of 10 bpm (5 states for the default range)
+    double m_sig = 10. / tempoStep;
+
+    // create the tempo transition weights, which only depend on the distance between states
+    for (int d = 0; d < numStates; d++)
+    {
+        double x = d + 1;
+        double t_mu = 1;
+        transitionWeights[d] = (1 / (m_sig * sqrt (2 * M_PI))) * exp((-1 * pow ((x - t_mu), 2)) / (2 * pow (m_sig, 2)) );
+        logTransitionWeights[d] = log (transitionWeights[d]);
+    }
+
+    setTransitionCutoff (1e-6);
+    padPreviousEstimate();
+
+    calculateObservationLags (60. * 44100. / 512., 128);
+}
+
+//=======================================================================
+template <int NumStates>
+double TempoModel<NumStates>::getMinimumTempo() const
+{
+    return minimumTempo;
+}
+
+//=======================================================================
+template <int NumStates>
+double TempoModel<NumStates>::getMaximumTempo() const
+{
+    return getTempo (getNumStates() - 1);
+}
+
+//=======================================================================
+template <int NumStates>
+double TempoModel<NumStates>::getTempoStep() const
+{
+    return tempoStep;
+}
+
+//=======================================================================
+template <int NumStates>
+double TempoModel<NumStates>::getTempo (int state) const
+{
+    return minimumTempo + state * tempoStep;
+}
+
+//=======================================================================
+template <int NumStates>
+double TempoModel<NumStates>::foldTempoIntoRange (double tempo) const
+{
+    if (tempo <= 0)
+        return tempo;
+
+    double maximumTempo = getMaximumTempo();
+
+    while (tempo > maximumTempo)
+        tempo = tempo / 2;
+
+    while (tempo < minimumTempo)
+        tempo = tempo * 2;
+
+    return tempo;
+}
+
+//=======================================================================
+template <int NumStates>
+int TempoModel<NumStates>::getNearestState (double tempo) const
+{
+    // convert tempo from bpm value to integer index of tempo probability
+    int state = (int) round ((foldTempoIntoRange (tempo) - minimumTempo) / tempoStep);
+
+    return std::min (std::max (state, 0), getNumStates() - 1);
+}
+
+//=======================================================================
+template <int NumStates>
+void TempoModel<NumStates>::setTransitionCutoff (double cutoff)
+{
+    bandwidth = getNumStates() - 1;
+
+    // the probability of moving by d states, relative to staying, is exp (-d^2 / (2 * sigma^2))
+    if (cutoff > 0 && cutoff < 1)
+    {
+        double m_sig = 10. / tempoStep;
+        bandwidth = std::min (bandwidth, (int) floor (m_sig * sqrt (-2. * log (cutoff))));
+    }
+    else if (cutoff >= 1)
+    {
+        bandwidth = 0;
+    }
+}
+
+//=======================================================================
+template <int NumStates>
+int TempoModel<NumStates>::getTransitionBandwidth() const
+{
+    return bandwidth;
+}
+
+//=======================================================================
+template <int NumStates>
+void TempoModel<NumStates>::setLogDomain (bool shouldUseLogDomain)
+{
+    if (shouldUseLogDomain == logDomain)
+        return;
+
+    // convert the previous estimate, which is normalised in either domain
+    for (int i = 0; i < getNumStates(); i++)
+        prevDelta[i] = shouldUseLogDomain ? log (prevDelta[i]) : exp (prevDelta[i] - logOffset);
+
+    logDomain = shouldUseLogDomain;
+    logOffset = 0;
+    padPreviousEstimate();
+}
+
+//=======================================================================
+template <int NumStates>
+bool TempoModel<NumStates>::isUsingLogDomain() const
+{
+    return logDomain;
+}
+
+//=======================================================================
+template <int NumStates>
+void TempoModel<NumStates>::padPreviousEstimate()
+{
+    int n = getNumStates();
+    double zeroProbability = logDomain ? -std::numeric_limits<double>::infinity() : 0.;
+
+    std::fill (paddedPrevDelta.begin(), paddedPrevDelta.begin() + n, zeroProbability);
+    std::copy (prevDelta.begin(), prevDelta.begin() + n, paddedPrevDelta.begin() + n);
+    std::fill (paddedPrevDelta.begin() + (2 * n), paddedPrevDelta.begin() + (3 * n), zeroProbability);
+}
+
+//=======================================================================
+template <int NumStates>
+void TempoModel<NumStates>::calculateObservationLags (double tempoToLagFactor, int numLags)
+{
+    for (int i = 0; i < getNumStates(); i++)
+    {
+        int tempoIndex1 = (int) round (tempoToLagFactor / getTempo (i));
+        int tempoIndex2 = (int) round (tempoToLagFactor / (2 * getTempo (i)));
+
+        observationLags[i] = std::min (std::max (tempoIndex1, 1), numLags) - 1;
+        halfObservationLags[i] = std::min (std::max (tempoIndex2, 1), numLags) - 1;
+    }
+}
+
+//=======================================================================
+template <int NumStates>
+void TempoModel<NumStates>::setTempo (double tempo)
+{
+    // now set previous tempo observations to zero and set desired tempo index to 1
+    std::fill (prevDelta.begin(), prevDelta.end(), logDomain ? -std::numeric_limits<double>::infinity() : 0.);
+    prevDelta[getNearestState (tempo)] = logDomain ? 0. : 1.;
+    logOffset = 0;
+}
+
+//=======================================================================
+template <int NumStates>
+void TempoModel<NumStates>::fixTempo (double tempo)
+{
+    // now set previous fixed previous tempo observation values to zero
+    std::fill (prevDeltaFixed.begin(), prevDeltaFixed.end(), 0);
+
+    // set desired tempo index to 1
+    prevDeltaFixed[getNearestState (tempo)] = 1;
+
+    // set the tempo fix flag
+    tempoFixed = true;
+}
+
+//=======================================================================
+template <int NumStates>
+void TempoModel<NumStates>::doNotFixTempo()
+{
+    // set the tempo fix flag
+    tempoFixed = false;
+}
+
+//=======================================================================
+template <int NumStates>
+bool TempoModel<NumStates>::isTempoFixed() const
+{
+    return tempoFixed;
+}
+
+//=======================================================================
+template <int NumStates>
+int TempoModel<NumStates>::update (const std::vector<double>& combFilterBankOutput)
+{
+    int n = getNumStates();
+
+    // calculate tempo observation vector from beat period observation vector
+    for (int i = 0; i < n; i++)
+        tempoObservationVector[i] = combFilterBankOutput[observationLags[i]] + combFilterBankOutput[halfObservationLags[i]];
+
+    // if tempo is fixed then always use a fixed set of tempi as the previous observation probability function
+    if (tempoFixed)
+    {
+        for (int k = 0; k < n; k++)
+            prevDelta[k] = logDomain ? log (prevDeltaFixed[k]) : prevDeltaFixed[k];
+
+        logOffset = 0;
+    }
+
+    // find the most likely transition into each state, one diagonal of the band at a time
+    std::copy (prevDelta.begin(), prevDelta.begin() + n, paddedPrevDelta.begin() + n);
+    std::fill (delta.begin(), delta.begin() + n, paddedPrevDelta[0]);
+
+    for (int d = -bandwidth; d <= bandwidth; d++)
+    {
+        const double* previous = &paddedPrevDelta[n + d];
+
+        if (logDomain)
+            kernels->updateMaximumSums (previous, logTransitionWeights[std::abs (d)], &delta[0], n);
+        else
+            kernels->updateMaximumProducts (previous, transitionWeights[std::abs (d)], &delta[0], n);
+    }
+
+    int maxIndex = 0;
+
+    if (logDomain)
+    {
+        // rather than normalising, the largest previous log probability is subtracted. Observations
+        // are floored so that silence (where they are all zero) cannot leave every state at -inf
+        const double smallestObservation = std::numeric_limits<double>::min();
+
+        for (int j = 0; j < n; j++)
+            delta[j] = delta[j] + log (std::max (tempoObservationVector[j], smallestObservation)) - logOffset;
+    }
+    else
+    {
+        for (int j = 0; j < n; j++)
+            delta[j] = delta[j] * tempoObservationVector[j];
+
+        // normalise
+        double sum = std::accumulate (delta.begin(), delta.begin() + n, 0.0);
+
+        if (sum > 0)
+        {
+            for (int j = 0; j < n; j++)
+                delta[j] = delta[j] / sum;
+        }
+    }
+
+    for (int j = 0; j < n; j++)
+    {
+        if (delta[j] > delta[maxIndex])
+            maxIndex = j;
+
+        prevDelta[j] = delta[j];
+    }
+
+    if (logDomain)
+        logOffset = std::isfinite (delta[maxIndex]) ? delta[maxIndex] : 0.;
+
+    return maxIndex;
+}
+
+//=======================================================================
+template class TempoModel<41>;
+template class TempoModel<DynamicNumTempoStates>;
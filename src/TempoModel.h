@@ -0,0 +1,228 @@
+//=======================================================================
+/** @file TempoModel.h
+ *  @brief The hidden Markov model of tempo used to choose the beat period
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#ifndef __TEMPOMODEL_H
+#define __TEMPOMODEL_H
+
+#include <array>
+#include <vector>
+#include "SpectralKernels.h"
+
+//=======================================================================
+/** Use as the number of tempo states to choose the number of states at run time */
+static const int DynamicNumTempoStates = 0;
+
+//=======================================================================
+/** The tempi the beat tracker can choose between: numStates tempi, evenly spaced from
+ * minimumTempo to maximumTempo. The default is 41 states from 80 to 160 bpm, in steps of 2 bpm.
+ *
+ * Each tempo is observed at its own beat period and at half of it, and the comb filter bank
+ * covers beat periods of up to 127 lags of 512 audio samples, so tempi below about 41 bpm
+ * (at 44.1kHz) are observed at that longest period.
+ *
+ * The TempoModel raises a minimum tempo below TempoModel::getSlowestTempo() to that tempo, and if
+ * the maximum tempo is not above the minimum, spaces the tempi 1 bpm apart from the minimum instead.
+ */
+struct TempoRange
+{
+    /** Constructor
+     * @param minimumTempo the slowest tempo, in beats per minute
+     * @param maximumTempo the fastest tempo, in beats per minute
+     * @param numStates the number of tempi (at least 2)
+     */
+    TempoRange (double minimumTempo = 80., double maximumTempo = 160., int numStates = 41)
+     :  minimumTempo (minimumTempo),
+        maximumTempo (maximumTempo),
+        numStates (numStates)
+    {
+    }
+
+    double minimumTempo;                    /**< the slowest tempo, in beats per minute */
+    double maximumTempo;                    /**< the fastest tempo, in beats per minute */
+    int numStates;                          /**< the number of tempi */
+};
+
+//=======================================================================
+/** Holds a value for each tempo state (or each pair of states) in a fixed-size array when the
+ * number of states is known at compile time, or in a vector otherwise
+ */
+template <typename T, int Size>
+struct TempoStateStorage
+{
+    typedef std::array<T, Size> Type;
+    static void resize (Type&, int) {}
+};
+
+template <typename T>
+struct TempoStateStorage<T, DynamicNumTempoStates>
+{
+    typedef std::vector<T> Type;
+    static void resize (Type& storage, int size)   { storage.resize (size); }
+};
+
+//=======================================================================
+/** The hidden Markov model of tempo. At each tempo estimate, the comb filter bank output gives
+ * an observation for each tempo state, and the Viterbi algorithm combines it with the previous
+ * estimate through a Gaussian transition matrix (see chapter 3 of Adam Stark's PhD thesis).
+ *
+ * The transition probabilities only depend on the distance between two states, so they are held
+ * as a band of weights either side of the diagonal, cut off where they become negligible (see
+ * setTransitionCutoff()). The Viterbi update then works along each diagonal of the band with the
+ * SIMD kernels in SpectralKernels. It can also be carried out in the log domain (see
+ * setLogDomain()), where the probabilities cannot underflow and are not normalised each time.
+ *
+ * The number of states is a template parameter so that the default 41 states keep fixed-size
+ * arrays and loops of a known length. With DynamicNumTempoStates, the number of states is taken
+ * from the TempoRange at construction instead.
+ *
+ * @tparam NumStates the number of tempo states, or DynamicNumTempoStates
+ */
+template <int NumStates>
+class TempoModel
+{
+public:
+
+    /** Constructor
+     * @param tempoRange the tempi to choose between. With a fixed number of states, its number of
+     * states is ignored and the tempi are spread over NumStates states instead
+     */
+    TempoModel (const TempoRange& tempoRange = TempoRange());
+
+    //=======================================================================
+    /** @returns the number of tempo states */
+    int getNumStates() const    { return NumStates != DynamicNumTempoStates ? NumStates : numStates; }
+
+    /** @returns the slowest tempo, in beats per minute */
+    double getMinimumTempo() const;
+
+    /** @returns the slowest tempo any range can have, in beats per minute. The beat tracker looks
+     * back over two beat periods of an onset detection function holding 512 samples at the rate
+     * of a 512 sample hop at 44.1kHz, so a beat period can be at most 256 of those samples */
+    static double getSlowestTempo()     { return (60. * 44100. / 512.) / 256.; }
+
+    /** @returns the fastest tempo, in beats per minute */
+    double getMaximumTempo() const;
+
+    /** @returns the difference between neighbouring tempo states, in beats per minute */
+    double getTempoStep() const;
+
+    /** @returns the tempo of a state, in beats per minute
+     * @param state the index of the state
+     */
+    double getTempo (int state) const;
+
+    /** @returns the state nearest to a tempo, after halving or doubling it to bring it into range
+     * @param tempo the tempo in beats per minute
+     */
+    int getNearestState (double tempo) const;
+
+    /** @returns a tempo halved or doubled to bring it into range (it may still lie outside
+     * the range if the range is less than an octave)
+     * @param tempo the tempo in beats per minute
+     */
+    double foldTempoIntoRange (double tempo) const;
+
+    //=======================================================================
+    /** Sets which transitions between tempo states are considered. Transitions whose probability is
+     * less than cutoff times that of staying at the same tempo are ignored. The default is 1e-6,
+     * which ignores transitions of more than about 5 standard deviations (26 states, or 52 bpm, in
+     * the default range). Those transitions are so unlikely that ignoring them does not change the
+     * tempo estimates in practice, and the tests check that it finds the same beats as a cutoff of
+     * 0, which considers every transition
+     * @param cutoff the cutoff, relative to the probability of staying at the same tempo
+     */
+    void setTransitionCutoff (double cutoff);
+
+    /** @returns the number of states either side of the current one that can be moved to */
+    int getTransitionBandwidth() const;
+
+    /** Chooses whether the Viterbi update is carried out on probabilities, normalising them after each
+     * update (the default), or on log probabilities, which need no normalisation
+     * @param shouldUseLogDomain true to use log probabilities
+     */
+    void setLogDomain (bool shouldUseLogDomain);
+
+    /** @returns true if the Viterbi update is carried out on log probabilities */
+    bool isUsingLogDomain() const;
+
+    //=======================================================================
+    /** Calculates which comb filter bank outputs are observed for each tempo state
+     * @param tempoToLagFactor the number of comb filter bank lags in the beat period of 1 bpm
+     * @param numLags the number of comb filter bank outputs
+     */
+    void calculateObservationLags (double tempoToLagFactor, int numLags);
+
+    //=======================================================================
+    /** Resets the previous estimate to a single tempo
+     * @param tempo the tempo in beats per minute
+     */
+    void setTempo (double tempo);
+
+    /** Fixes the previous estimate at a single tempo for every future estimate
+     * @param tempo the tempo in beats per minute
+     */
+    void fixTempo (double tempo);
+
+    /** Stops fixing the previous estimate */
+    void doNotFixTempo();
+
+    /** @returns true if the tempo is fixed */
+    bool isTempoFixed() const;
+
+    //=======================================================================
+    /** Makes a new tempo estimate
+     * @param combFilterBankOutput the comb filter bank output, after the adaptive threshold
+     * @returns the most likely tempo state
+     */
+    int update (const std::vector<double>& combFilterBankOutput);
+
+private:
+
+    /** Copies the previous estimate into the middle of the padded previous estimate, and sets
+     * the padding either side to a probability of zero */
+    void padPreviousEstimate();
+
+    typedef typename TempoStateStorage<double, NumStates>::Type StateVector;
+    typedef typename TempoStateStorage<double, 3 * NumStates>::Type PaddedStateVector;
+    typedef typename TempoStateStorage<int, NumStates>::Type StateLags;
+
+    int numStates;                          /**< the number of tempo states */
+    double minimumTempo;                    /**< the slowest tempo, in beats per minute */
+    double tempoStep;                       /**< the difference between neighbouring tempo states, in beats per minute */
+    bool tempoFixed;                        /**< indicates whether the tempo should be fixed or not */
+    bool logDomain;                         /**< indicates whether delta and prevDelta hold log probabilities */
+    int bandwidth;                          /**< the number of states either side of the current one that can be moved to */
+    double logOffset;                       /**< the largest log probability in prevDelta, which is subtracted in the next update */
+
+    StateVector transitionWeights;          /**< the probability of moving by d states, at [d] */
+    StateVector logTransitionWeights;       /**< the log probability of moving by d states, at [d] */
+    PaddedStateVector paddedPrevDelta;      /**< prevDelta, with numStates states of zero probability either side */
+    StateVector tempoObservationVector;     /**< to hold tempo version of comb filter output */
+    StateVector delta;                      /**< to hold final tempo candidate array */
+    StateVector prevDelta;                  /**< previous delta */
+    StateVector prevDeltaFixed;             /**< fixed tempo version of previous delta */
+    StateLags observationLags;              /**< the comb filter bank output observed at each state's beat period */
+    StateLags halfObservationLags;          /**< the comb filter bank output observed at half of each state's beat period */
+
+    const SpectralKernels<double>* kernels; /**< the SIMD kernels for the Viterbi update */
+};
+
+#endif
@@ -0,0 +1,107 @@
+//=======================================================================
+/** @file TripleBuffer.h
+ *  @brief A lock-free triple buffer for handing values from one thread to another
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#ifndef TripleBuffer_h
+#define TripleBuffer_h
+
+#include <atomic>
+
+//=======================================================================
+/** Hands the latest value of something from one thread (the writer) to another (the reader)
+ * without locking or allocating, so that either thread can be a real-time thread.
+ *
+ * There are three copies of the value. The writer owns one, which it fills in and then publishes,
+ * the reader owns another, which it reads after picking up the latest one to be published, and
+ * the third is exchanged between them with a single atomic operation. Neither thread ever waits
+ * for the other, and a value that is published before the reader picks up the one before it
+ * replaces it, so the reader always gets the latest value.
+ *
+ * @tparam T the type of the value, which should be default constructible and copyable
+ */
+template <typename T>
+class TripleBuffer
+{
+public:
+    
+    /** Constructor */
+    TripleBuffer()
+     :  writeIndex (0),
+        readIndex (1),
+        sharedIndex (2)
+    {
+    }
+    
+    /** Sets all three copies to a value and forgets anything published but not yet picked up.
+     * Neither thread may use the buffer while this is called */
+    void reset (const T& value)
+    {
+        for (int i = 0; i < 3; i++)
+            buffers[i] = value;
+        
+        writeIndex = 0;
+        readIndex = 1;
+        sharedIndex = 2;
+    }
+    
+    //=======================================================================
+    /** @returns the copy of the value that the writer fills in before calling publish() */
+    T& getWriteBuffer()
+    {
+        return buffers[writeIndex];
+    }
+    
+    /** Makes the write buffer available to the reader and gives the writer another to fill in */
+    void publish()
+    {
+        writeIndex = sharedIndex.exchange (writeIndex | newValueFlag, std::memory_order_acq_rel) & indexMask;
+    }
+    
+    //=======================================================================
+    /** Picks up the latest value to be published, if there is one that has not been picked up yet
+     * @returns true if there was a new value, which is now in the read buffer
+     */
+    bool read()
+    {
+        if ((sharedIndex.load (std::memory_order_relaxed) & newValueFlag) == 0)
+            return false;
+        
+        readIndex = sharedIndex.exchange (readIndex, std::memory_order_acq_rel) & indexMask;
+        return true;
+    }
+    
+    /** @returns the copy of the value that the reader last picked up */
+    T& getReadBuffer()
+    {
+        return buffers[readIndex];
+    }
+    
+private:
+    
+    static const int indexMask = 3;         /**< the bits of sharedIndex that hold an index */
+    static const int newValueFlag = 4;      /**< the bit of sharedIndex that is set when it holds a value that has not been read */
+    
+    T buffers[3];                           /**< the three copies of the value */
+    int writeIndex;                         /**< the copy owned by the writer */
+    int readIndex;                          /**< the copy owned by the reader */
+    std::atomic<int> sharedIndex;           /**< the copy owned by neither, with newValueFlag set if it was published since it was last read */
+};
+
+#endif /* TripleBuffer_h */
@@ -0,0 +1,139 @@
+//=======================================================================
+/** @file WorkerThread.cpp
+ *  @brief A background thread that runs a task each time it is triggered
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#include "WorkerThread.h"
+
+#if defined (_WIN32)
+#include <windows.h>
+#include <climits>
+#elif defined (__APPLE__)
+#include <dispatch/dispatch.h>
+#else
+#include <cerrno>
+#endif
+
+//=======================================================================
+Semaphore::Semaphore()
+{
+#if defined (_WIN32)
+    handle = CreateSemaphore (nullptr, 0, LONG_MAX, nullptr);
+#elif defined (__APPLE__)
+    handle = dispatch_semaphore_create (0);
+#else
+    sem_init (&semaphore, 0, 0);
+#endif
+}
+
+//=======================================================================
+Semaphore::~Semaphore()
+{
+#if defined (_WIN32)
+    CloseHandle (handle);
+#elif defined (__APPLE__)
+    dispatch_release (static_cast<dispatch_semaphore_t> (handle));
+#else
+    sem_destroy (&semaphore);
+#endif
+}
+
+//=======================================================================
+void Semaphore::post()
+{
+#if defined (_WIN32)
+    ReleaseSemaphore (handle, 1, nullptr);
+#elif defined (__APPLE__)
+    dispatch_semaphore_signal (static_cast<dispatch_semaphore_t> (handle));
+#else
+    sem_post (&semaphore);
+#endif
+}
+
+//=======================================================================
+void Semaphore::wait()
+{
+#if defined (_WIN32)
+    WaitForSingleObject (handle, INFINITE);
+#elif defined (__APPLE__)
+    dispatch_semaphore_wait (static_cast<dispatch_semaphore_t> (handle), DISPATCH_TIME_FOREVER);
+#else
+    // a signal can interrupt the wait without the semaphore having been posted
+    while (sem_wait (&semaphore) != 0 && errno == EINTR)
+    {
+    }
+#endif
+}
+
+//=======================================================================
+WorkerThread::WorkerThread (std::function<void()> task_)
+ :  task (task_),
+    triggered (false),
+    shouldStop (false),
+    thread (&WorkerThread::run, this)
+{
+}
+
+//=======================================================================
+WorkerThread::~WorkerThread()
+{
+    shouldStop = true;
+    wakeUp.post();
+    thread.join();
+}
+
+//=======================================================================
+void WorkerThread::trigger()
+{
+    // only post when the flag is newly set, so that the count stays small however often this is called
+    if (! triggered.exchange (true))
+        wakeUp.post();
+}
+
+//=======================================================================
+void WorkerThread::waitUntilIdle()
+{
+    // the thread clears the flag with the lock held and keeps it until the task has finished
+    std::unique_lock<std::mutex> heldLock (lock);
+    finished.wait (heldLock, [this] { return ! triggered; });
+}
+
+//=======================================================================
+std::mutex& WorkerThread::getLock()
+{
+    return lock;
+}
+
+//=======================================================================
+void WorkerThread::run()
+{
+    while (! shouldStop)
+    {
+        wakeUp.wait();
+        
+        {
+            std::lock_guard<std::mutex> heldLock (lock);
+            
+            if (! shouldStop && triggered.exchange (false))
+                task();
+        }
+        
+        finished.notify_all();
+    }
+}
@@ -0,0 +1,112 @@
+//=======================================================================
+/** @file WorkerThread.h
+ *  @brief A background thread that runs a task each time it is triggered
+ *  @author Adam Stark
+ *  @copyright Copyright (C) 2008-2014  Queen Mary University of London
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+//=======================================================================
+
+#ifndef __WORKERTHREAD_H
+#define __WORKERTHREAD_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#if ! defined (_WIN32) && ! defined (__APPLE__)
+#include <semaphore.h>
+#endif
+
+//=======================================================================
+/** A counting semaphore. Posting never blocks and takes no lock, so a real-time thread can
+ * wake another thread with it, and a post made before the other thread waits is never lost.
+ */
+class Semaphore
+{
+public:
+    
+    /** Constructor, which starts the count at zero */
+    Semaphore();
+    
+    /** Destructor */
+    ~Semaphore();
+    
+    /** Adds one to the count, waking a thread that is waiting */
+    void post();
+    
+    /** Waits until the count is above zero, then takes one from it */
+    void wait();
+    
+private:
+    
+    Semaphore (const Semaphore&) = delete;
+    Semaphore& operator= (const Semaphore&) = delete;
+    
+#if defined (_WIN32) || defined (__APPLE__)
+    void* handle;                           /**< the HANDLE of a Windows semaphore, or a dispatch_semaphore_t */
+#else
+    sem_t semaphore;                        /**< the POSIX semaphore */
+#endif
+};
+
+//=======================================================================
+/** A thread that runs a task each time it is triggered, so that work can be moved off a
+ * real-time thread. Triggering never blocks: it sets a flag and posts a semaphore, without
+ * taking a lock. The thread sleeps on the semaphore until then, so it costs nothing while idle
+ * and never misses a trigger.
+ *
+ * The task runs with a lock held, which other (non real-time) threads can take with getLock()
+ * to change the state the task works on while it is not running.
+ */
+class WorkerThread
+{
+public:
+    
+    /** Constructor, which starts the thread
+     * @param task the function to run each time the thread is triggered
+     */
+    WorkerThread (std::function<void()> task);
+    
+    /** Destructor, which waits for the task to finish if it is running and stops the thread */
+    ~WorkerThread();
+    
+    /** Asks the thread to run the task. If it is already running, it runs once more afterwards */
+    void trigger();
+    
+    /** Waits until the thread has run the task for every trigger so far. This must not be called
+     * from a real-time thread */
+    void waitUntilIdle();
+    
+    /** @returns the lock held while the task runs */
+    std::mutex& getLock();
+    
+private:
+    
+    /** Waits to be triggered and runs the task until asked to stop */
+    void run();
+    
+    std::function<void()> task;             /**< the task to run when triggered */
+    std::mutex lock;                        /**< held by the thread while the task runs */
+    Semaphore wakeUp;                       /**< posted when the thread is triggered or should stop */
+    std::condition_variable finished;       /**< signalled each time the thread finishes the task */
+    std::atomic<bool> triggered;            /**< set when the task should run */
+    std::atomic<bool> shouldStop;           /**< set when the thread should stop */
+    std::thread thread;                     /**< the thread, started last so that everything above exists when it starts */
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "doctest.h"
+#include <AdaptiveThreshold.h>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+//======================================================================
+//========================= ADAPTIVE THRESHOLD =========================
+//======================================================================
+TEST_SUITE ("adaptiveThreshold")
+{
+    //======================================================================
+    /** The direct calculation, summing each window separately */
+    double calculateMean (const std::vector<double>& x, int startIndex, int endIndex)
+    {
+        int length = endIndex - startIndex;
+        return length > 0 ? std::accumulate (x.begin() + startIndex, x.begin() + endIndex, 0.0) / length : 0.;
+    }
+
+    //======================================================================
+    std::vector<double> calculateDirectly (std::vector<double> x)
+    {
+        int N = (int) x.size();
+        std::vector<double> threshold (N + 1);
+        int t = std::min (N, 7);
+
+        for (int i = 0; i <= t; i++)
+            threshold[i] = calculateMean (x, 1, std::min (i + 8, N));
+
+        for (int i = t + 1; i < N - 7; i++)
+            threshold[i] = calculateMean (x, i - 8, i + 7);
+
+        for (int i = std::max (N - 7, 0); i < N; i++)
+            threshold[i] = calculateMean (x, std::max (i - 7, 1), N);
+
+        for (int i = 0; i < N; i++)
+            x[i] = std::max (x[i] - threshold[i], 0.);
+
+        return x;
+    }
+
+    //======================================================================
+    TEST_CASE ("matchesDirectCalculation")
+    {
+        AdaptiveThreshold adaptiveThreshold (512);
+
+        for (int length : {512, 128, 16, 5})
+        {
+            CAPTURE (length);
+
+            std::vector<double> x (length);
+
+            for (int i = 0; i < length; i++)
+                x[i] = static_cast<double> (random() % 1000) / 100. + ((i % 20) == 0 ? 50. : 0.);
+
+            std::vector<double> expected = calculateDirectly (x);
+            double total = std::accumulate (x.begin(), x.end(), 0.0);
+
+            adaptiveThreshold.process (x);
+
+            for (int i = 0; i < length; i++)
+                CHECK (fabs (x[i] - expected[i]) <= total * length * 1e-16);
+        }
+    }
+
+    //======================================================================
+    TEST_CASE ("constantSignalIsRemoved")
+    {
+        AdaptiveThreshold adaptiveThreshold (128);
+        std::vector<double> x (128, 3.);
+
+        adaptiveThreshold.process (x);
+
+        for (int i = 0; i < 128; i++)
+            CHECK_EQ (x[i], 0.);
+    }
+
+    //======================================================================
+    TEST_CASE ("longerSignalsAreProcessed")
+    {
+        AdaptiveThreshold adaptiveThreshold (16);
+        std::vector<double> x (1024, 0.);
+        x[500] = 1.;
+
+        adaptiveThreshold.process (x);
+
+        CHECK_EQ (x[500], doctest::Approx (1. - 1. / 15.));
+        CHECK_EQ (x[499], 0.);
+    }
+}
@@ -0,0 +1,228 @@
+#include "doctest.h"
+#include <BTrack.h>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+//======================================================================
+// Every allocation made on a thread while it is counting allocations is counted. Allocations
+// in C++ go through operator new, which is replaced here. With glibc, malloc, calloc and realloc
+// are also replaced, so that allocations made by C code (such as an FFT library) are counted.
+static thread_local bool isCountingAllocations = false;
+static std::atomic<int> numAllocations (0);
+
+static void countAllocation()
+{
+    if (isCountingAllocations)
+        numAllocations++;
+}
+
+void* operator new (std::size_t size)
+{
+    countAllocation();
+    
+    if (void* p = std::malloc (size == 0 ? 1 : size))
+        return p;
+    
+    throw std::bad_alloc();
+}
+
+// GCC warns when these are inlined into code that allocated with operator new, as it does not
+// know that operator new has been replaced with malloc
+#if defined (__GNUC__) && ! defined (__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void operator delete (void* p) noexcept
+{
+    std::free (p);
+}
+
+void operator delete (void* p, std::size_t) noexcept
+{
+    std::free (p);
+}
+
+#if defined (__GNUC__) && ! defined (__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#if defined (__GLIBC__)
+extern "C"
+{
+    void* __libc_malloc (size_t size);
+    void* __libc_calloc (size_t count, size_t size);
+    void* __libc_realloc (void* p, size_t size);
+    
+    void* malloc (size_t size)
+    {
+        countAllocation();
+        return __libc_malloc (size);
+    }
+    
+    void* calloc (size_t count, size_t size)
+    {
+        countAllocation();
+        return __libc_calloc (count, size);
+    }
+    
+    void* realloc (void* p, size_t size)
+    {
+        countAllocation();
+        return __libc_realloc (p, size);
+    }
+}
+#endif
+
+//======================================================================
+/** Counts the allocations made on this thread while it is in scope */
+struct AllocationCounter
+{
+    AllocationCounter()
+    {
+        numAllocations = 0;
+        isCountingAllocations = true;
+    }
+    
+    ~AllocationCounter()
+    {
+        isCountingAllocations = false;
+    }
+    
+    int getNumAllocations() const
+    {
+        return numAllocations;
+    }
+};
+
+//======================================================================
+//============================= ALLOCATION =============================
+//======================================================================
+TEST_SUITE ("allocation")
+{
+    //======================================================================
+    /** A click track whose tempo rises from 90 to 150 bpm, so that the beat period keeps changing */
+    template <typename SampleType>
+    std::vector<SampleType> makeClickTrack (int numSamples)
+    {
+        std::vector<SampleType> signal (numSamples);
+        double phase = 0;
+        
+        for (int i = 0; i < numSamples; i++)
+        {
+            double tempo = 90. + 60. * static_cast<double> (i) / numSamples;
+            phase += tempo / (60. * 44100.);
+            
+            double timeSinceClick = fmod (phase, 1.) * 60. / tempo;
+            signal[i] = static_cast<SampleType> (exp (-100. * timeSinceClick) * sin (2. * M_PI * 1000. * i / 44100.));
+        }
+        
+        return signal;
+    }
+    
+    //======================================================================
+    template <typename Tracker, typename SampleType>
+    void checkProcessingDoesNotAllocate (Tracker& b, int hopSize)
+    {
+        int numWarmUpFrames = 300;
+        int numFrames = 3000;
+        std::vector<SampleType> signal = makeClickTrack<SampleType> ((numWarmUpFrames + numFrames + 1) * hopSize);
+        
+        // the first frames may allocate, for example to set up the FFT
+        for (int i = 0; i < numWarmUpFrames; i++)
+            b.processAudioFrame (&signal[i * hopSize]);
+        
+        int frameAllocations, sampleAllocations;
+        int numBeats = 0;
+        
+        {
+            AllocationCounter counter;
+            
+            for (int i = numWarmUpFrames; i < numWarmUpFrames + numFrames; i++)
+            {
+                b.processAudioFrame (&signal[i * hopSize]);
+                numBeats += b.beatDueInCurrentFrame() ? 1 : 0;
+            }
+            
+            frameAllocations = counter.getNumAllocations();
+        }
+        
+        {
+            AllocationCounter counter;
+            
+            for (int i = 0; i < numFrames; i++)
+                b.processOnsetDetectionFunctionSample ((i % 40) == 0 ? SampleType (1) : SampleType (0));
+            
+            sampleAllocations = counter.getNumAllocations();
+        }
+        
+        CHECK (numBeats > 0);
+        CHECK_EQ (frameAllocations, 0);
+        CHECK_EQ (sampleAllocations, 0);
+    }
+    
+    //======================================================================
+    TEST_CASE ("allocationsAreCounted")
+    {
+        AllocationCounter counter;
+        std::vector<double>* v = new std::vector<double> (100);
+        delete v;
+        
+        CHECK (counter.getNumAllocations() >= 2);
+    }
+    
+    //======================================================================
+    TEST_CASE ("processingDoesNotAllocateAfterWarmUp")
+    {
+        for (int hopSize : {512, 256, 64})
+        {
+            CAPTURE (hopSize);
+            
+            BTrack b (hopSize);
+            checkProcessingDoesNotAllocate<BTrack, double> (b, hopSize);
+            
+            BTrackFloat f (hopSize);
+            checkProcessingDoesNotAllocate<BTrackFloat, float> (f, hopSize);
+        }
+        
+        // Kiss FFT allocates for factors of the frame size other than 2, 3, 4 and 5, so the frame is a power of two
+        BasicBTrack<double, OnsetDetectionFunction> runTime (512);
+        checkProcessingDoesNotAllocate<BasicBTrack<double, OnsetDetectionFunction>, double> (runTime, 512);
+    }
+    
+    //======================================================================
+    TEST_CASE ("processingWithAWideTempoRangeDoesNotAllocateAfterWarmUp")
+    {
+        BTrackDynamicTempoStates b (256, 512, TempoRange (45., 240., 196));
+        b.setLogDomainTempoEstimation (true);
+        checkProcessingDoesNotAllocate<BTrackDynamicTempoStates, double> (b, 256);
+    }
+    
+    //======================================================================
+    TEST_CASE ("processingDoesNotAllocateWhenEstimatingTempoAsynchronously")
+    {
+        // only allocations on this thread are counted, so the tempo estimation thread is free to allocate
+        BTrack b (512);
+        b.setAsynchronousTempoEstimation (true);
+        checkProcessingDoesNotAllocate<BTrack, double> (b, 512);
+    }
+    
+    //======================================================================
+    TEST_CASE ("processingDoesNotAllocateWhenAmortisingTempoEstimation")
+    {
+        BTrack b (128);
+        b.setAmortisedTempoEstimation (true);
+        checkProcessingDoesNotAllocate<BTrack, double> (b, 128);
+    }
+    
+    //======================================================================
+    TEST_CASE ("processingDoesNotAllocateWhenQueueingEvents")
+    {
+        BTrack b (512);
+        b.setEventQueueCapacity (16);
+        checkProcessingDoesNotAllocate<BTrack, double> (b, 512);
+    }
+}
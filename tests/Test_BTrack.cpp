@@ -1,5 +1,30 @@
 #include "doctest.h"
 #include <BTrack.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+
+//======================================================================
+/** Fills a frame with the next hop of a decaying 440 Hz tone re-triggered at 120 bpm
+ * @param frame the hopSize samples to fill
+ * @param hopSize the hop size
+ * @param frameIndex the index of the frame, counting from 0
+ * @param sampleRate the sample rate of the tone, in Hz
+ * @param noiseLevel the level of the uniform noise added to the tone, or 0 for none
+ */
+static void makeDecayingToneFrame (double* frame, int hopSize, int frameIndex, double sampleRate = 44100., double noiseLevel = 0.)
+{
+    for (int n = 0; n < hopSize; n++)
+    {
+        double t = static_cast<double> ((static_cast<long> (frameIndex) * hopSize) + n) / sampleRate;
+        frame[n] = exp (-20. * fmod (t, 0.5)) * sin (2. * M_PI * 440. * t);
+        
+        if (noiseLevel > 0)
+            frame[n] += noiseLevel * ((static_cast<double> (random() % 2000) / 1000.) - 1.);
+    }
+}
 
 //======================================================================
 //==================== CHECKING INITIALISATION =========================
@@ -233,4 +258,968 @@ TEST_SUITE("processingSimpleValues")
         // of the total number of beats
         CHECK (((double)correct) > (((double)numBeats)*0.99));
     }
-}
\ No newline at end of file
+}
+//======================================================================
+//========================== SAMPLE TYPES ==============================
+//======================================================================
+
+TEST_SUITE ("sampleTypes")
+{
+    //======================================================================
+    TEST_CASE ("singlePrecisionFindsTheSameBeats")
+    {
+        int hopSize = 512;
+        int numFrames = 2000;
+        
+        BTrack reference (hopSize);
+        BTrackFloat singlePrecision (hopSize);
+        
+        std::vector<double> frame (hopSize);
+        std::vector<float> floatFrame (hopSize);
+        std::vector<int> expectedBeats, actualBeats;
+        
+        for (int i = 0; i < numFrames; i++)
+        {
+            makeDecayingToneFrame (frame.data(), hopSize, i, 44100., 0.05);
+            
+            for (int n = 0; n < hopSize; n++)
+                floatFrame[n] = static_cast<float> (frame[n]);
+            
+            reference.processAudioFrame (frame.data());
+            singlePrecision.processAudioFrame (floatFrame.data());
+            
+            if (reference.beatDueInCurrentFrame())
+                expectedBeats.push_back (i);
+            
+            if (singlePrecision.beatDueInCurrentFrame())
+                actualBeats.push_back (i);
+        }
+        
+        REQUIRE (actualBeats.size() == expectedBeats.size());
+        
+        // the documented tolerance is one detection function sample
+        for (size_t i = 0; i < expectedBeats.size(); i++)
+            CHECK (abs (actualBeats[i] - expectedBeats[i]) <= 1);
+    }
+}
+
+//======================================================================
+//====================== DETECTION FUNCTION TYPES ======================
+//======================================================================
+
+TEST_SUITE ("detectionFunctionTypes")
+{
+    //======================================================================
+    TEST_CASE ("runTimeDetectionFunctionFindsTheSameBeats")
+    {
+        int hopSize = 512;
+        int numFrames = 1000;
+        
+        BTrack compileTime (hopSize);
+        BasicBTrack<double, OnsetDetectionFunction> runTime (hopSize);
+        
+        std::vector<double> frame (hopSize);
+        
+        for (int i = 0; i < numFrames; i++)
+        {
+            makeDecayingToneFrame (frame.data(), hopSize, i);
+            
+            compileTime.processAudioFrame (frame.data());
+            runTime.processAudioFrame (frame.data());
+            
+            REQUIRE (compileTime.beatDueInCurrentFrame() == runTime.beatDueInCurrentFrame());
+            REQUIRE (compileTime.getLatestCumulativeScoreValue() == runTime.getLatestCumulativeScoreValue());
+        }
+    }
+}
+
+//======================================================================
+//============================ TEMPO RANGE =============================
+//======================================================================
+
+TEST_SUITE ("tempoRange")
+{
+    //======================================================================
+    TEST_CASE ("dynamicTempoStatesFindTheSameBeatsWithTheDefaultRange")
+    {
+        BTrack fixedStates;
+        BTrackDynamicTempoStates dynamicStates (512, 1024, TempoRange (80., 160., 41));
+        
+        CHECK_EQ (dynamicStates.getTempoModel().getNumStates(), 41);
+        CHECK_EQ (dynamicStates.getTempoModel().getTempoStep(), 2.);
+        
+        for (int i = 0; i < 4000; i++)
+        {
+            double sample = (i % 37) == 0 ? 1. : static_cast<double> (random() % 100) / 1000.;
+            
+            fixedStates.processOnsetDetectionFunctionSample (sample);
+            dynamicStates.processOnsetDetectionFunctionSample (sample);
+            
+            REQUIRE (fixedStates.beatDueInCurrentFrame() == dynamicStates.beatDueInCurrentFrame());
+            REQUIRE (fixedStates.getCurrentTempoEstimate() == dynamicStates.getCurrentTempoEstimate());
+        }
+    }
+    
+    //======================================================================
+    TEST_CASE ("widerRangeTracksSlowTempi")
+    {
+        // a pulse every 80 detection function samples is 64.6 bpm
+        BTrack defaultRange;
+        BTrackDynamicTempoStates widerRange (512, 1024, TempoRange (60., 200., 71));
+        
+        for (int i = 0; i < 4000; i++)
+        {
+            double sample = (i % 80) == 0 ? 1. : 0.;
+            defaultRange.processOnsetDetectionFunctionSample (sample);
+            widerRange.processOnsetDetectionFunctionSample (sample);
+        }
+        
+        CHECK (defaultRange.getCurrentTempoEstimate() > 80.);
+        CHECK (fabs (widerRange.getCurrentTempoEstimate() - 64.6) < 2.);
+    }
+    
+    //======================================================================
+    TEST_CASE ("defaultTransitionCutoffFindsTheSameBeatsAsEveryTransition")
+    {
+        const int periods[] = {43, 30, 60, 36, 25, 50};
+        
+        for (bool logDomain : {false, true})
+        {
+            CAPTURE (logDomain);
+            
+            BTrackDynamicTempoStates banded (512, 1024, TempoRange (60., 200., 71));
+            BTrackDynamicTempoStates full (512, 1024, TempoRange (60., 200., 71));
+            full.setTempoTransitionCutoff (0);
+            banded.setLogDomainTempoEstimation (logDomain);
+            full.setLogDomainTempoEstimation (logDomain);
+            
+            std::mt19937 generator (1);
+            std::uniform_real_distribution<double> noise (0., 0.3);
+            int phase = 0;
+            
+            for (int i = 0; i < 12000; i++)
+            {
+                int period = periods[i / 2000];
+                double sample = (phase % period) == 0 ? 1. : noise (generator);
+                phase = (phase + 1) % period;
+                
+                banded.processOnsetDetectionFunctionSample (sample);
+                full.processOnsetDetectionFunctionSample (sample);
+                
+                REQUIRE (banded.beatDueInCurrentFrame() == full.beatDueInCurrentFrame());
+                REQUIRE (banded.getCurrentTempoEstimate() == full.getCurrentTempoEstimate());
+            }
+        }
+    }
+    
+    //======================================================================
+    TEST_CASE ("slowRangesStayWithinTheOnsetDetectionFunction")
+    {
+        // tempi below about 20 bpm would need more than the onset detection function holds
+        for (int hopSize : {512, 128})
+        {
+            CAPTURE (hopSize);
+            
+            BTrackDynamicTempoStates b (hopSize, 2 * hopSize, TempoRange (5., 60., 56));
+            b.setDecimation (false);
+            
+            CHECK_EQ (b.getTempoModel().getMinimumTempo(), TempoModel<DynamicNumTempoStates>::getSlowestTempo());
+            
+            // a few slow beats and then silence, which leaves the tempo estimate at the slowest tempo
+            int period = 250 * 512 / hopSize;
+            int numSamples = 4000 * 512 / hopSize;
+            
+            for (int i = 0; i < numSamples; i++)
+                b.processOnsetDetectionFunctionSample ((i < numSamples / 4 && (i % period) == 0) ? 1. : 0.);
+            
+            CHECK (b.getCurrentTempoEstimate() >= 20.);
+            CHECK (b.getCurrentTempoEstimate() <= 60.);
+        }
+    }
+    
+    //======================================================================
+    TEST_CASE ("tempiAreFoldedIntoRangesOfLessThanAnOctave")
+    {
+        BTrackDynamicTempoStates b (512, 1024, TempoRange (100., 150., 26));
+        const TempoModel<DynamicNumTempoStates>& tempoModel = b.getTempoModel();
+        
+        CHECK_EQ (tempoModel.getMaximumTempo(), 150.);
+        CHECK_EQ (tempoModel.getNearestState (160.), 25);
+        CHECK_EQ (tempoModel.getNearestState (70.), 20);
+        CHECK_EQ (tempoModel.getNearestState (240.), 10);
+        
+        b.setTempo (160.);
+        b.fixTempo (70.);
+        
+        for (int i = 0; i < 1000; i++)
+            b.processOnsetDetectionFunctionSample ((i % 43) == 0 ? 1. : 0.);
+        
+        CHECK (tempoModel.isTempoFixed());
+        CHECK (b.getCurrentTempoEstimate() > 95.);
+        CHECK (b.getCurrentTempoEstimate() < 155.);
+    }
+    
+    //======================================================================
+    TEST_CASE ("fixedNumberOfStatesSpreadsTheRange")
+    {
+        BTrack b (512, 1024, TempoRange (100., 180., 10));
+        
+        CHECK_EQ (b.getTempoModel().getNumStates(), 41);
+        CHECK_EQ (b.getTempoModel().getTempo (40), 180.);
+    }
+}
+
+//======================================================================
+//============================= DECIMATION =============================
+//======================================================================
+
+TEST_SUITE ("decimation")
+{
+    //======================================================================
+    TEST_CASE ("decimationFactorMatchesAHopOf512")
+    {
+        BTrack b (64);
+        CHECK_EQ (b.getDecimationFactor(), 1);
+        
+        b.setDecimation (true);
+        CHECK_EQ (b.getDecimationFactor(), 8);
+        CHECK_EQ (b.getHopSize(), 64);
+        
+        b.updateHopAndFrameSize (256, 512);
+        CHECK_EQ (b.getDecimationFactor(), 2);
+        
+        b.updateHopAndFrameSize (512, 1024);
+        CHECK_EQ (b.getDecimationFactor(), 1);
+        
+        b.updateHopAndFrameSize (128, 256);
+        b.setDecimation (false);
+        CHECK_EQ (b.getDecimationFactor(), 1);
+    }
+    
+    //======================================================================
+    TEST_CASE ("decimatedTrackerReportsBeatsInSingleHops")
+    {
+        int hopSize = 64;
+        int numFrames = 12000;
+        
+        BTrack b (hopSize);
+        b.setDecimation (true);
+        
+        std::vector<double> frame (hopSize);
+        std::vector<int> beats;
+        
+        for (int i = 0; i < numFrames; i++)
+        {
+            makeDecayingToneFrame (frame.data(), hopSize, i);
+            
+            b.processAudioFrame (frame.data());
+            
+            if (b.beatDueInCurrentFrame())
+                beats.push_back (i);
+        }
+        
+        CHECK (fabs (b.getCurrentTempoEstimate() - 120.) < 3.);
+        REQUIRE (beats.size() > 10);
+        
+        // once the tracker has settled, beats are half a second (344.5 hops) apart, give or take a decimated sample
+        for (size_t i = beats.size() - 8; i < beats.size(); i++)
+        {
+            CAPTURE (i);
+            CHECK (abs (beats[i] - beats[i - 1] - 344) <= 8);
+        }
+    }
+}
+
+//======================================================================
+//============================ SAMPLE RATE =============================
+//======================================================================
+
+TEST_SUITE ("sampleRate")
+{
+    //======================================================================
+    /** @returns the tempo a beat tracker estimates for a decaying tone re-triggered at 120 bpm */
+    double estimateTempoAtSampleRate (BTrack& b, double sampleRate, int hopSize, std::vector<int>& beats)
+    {
+        std::vector<double> frame (hopSize);
+        int numFrames = static_cast<int> (20. * sampleRate / hopSize);
+        
+        for (int i = 0; i < numFrames; i++)
+        {
+            makeDecayingToneFrame (frame.data(), hopSize, i, sampleRate);
+            
+            b.processAudioFrame (frame.data());
+            
+            if (b.beatDueInCurrentFrame())
+                beats.push_back (i);
+        }
+        
+        return b.getCurrentTempoEstimate();
+    }
+    
+    //======================================================================
+    TEST_CASE ("tempoIsEstimatedAtTheGivenSampleRate")
+    {
+        for (double sampleRate : {44100., 48000., 96000.})
+        {
+            CAPTURE (sampleRate);
+            
+            BTrack b (512, 1024, sampleRate);
+            CHECK_EQ (b.getSampleRate(), sampleRate);
+            
+            std::vector<int> beats;
+            CHECK (fabs (estimateTempoAtSampleRate (b, sampleRate, 512, beats) - 120.) < 4.);
+            
+            // half a second between the last two beats, to within a hop
+            REQUIRE (beats.size() > 10);
+            CHECK (fabs ((beats.back() - beats[beats.size() - 2]) - (0.5 * sampleRate / 512.)) <= 1.);
+        }
+    }
+    
+    //======================================================================
+    TEST_CASE ("updatingTheSampleRateMatchesConstructingWithIt")
+    {
+        BTrack constructed (256, 512, 48000.);
+        BTrack updated (256);
+        
+        CHECK_EQ (updated.getSampleRate(), 44100.);
+        updated.updateSampleRate (48000.);
+        CHECK_EQ (updated.getSampleRate(), 48000.);
+        
+        std::vector<int> constructedBeats, updatedBeats;
+        estimateTempoAtSampleRate (constructed, 48000., 256, constructedBeats);
+        estimateTempoAtSampleRate (updated, 48000., 256, updatedBeats);
+        
+        CHECK (constructedBeats == updatedBeats);
+    }
+    
+    //======================================================================
+    TEST_CASE ("decimationMatchesAHopOf512At44100")
+    {
+        BTrack b (64, 128, 96000.);
+        b.setDecimation (true);
+        
+        // 512 samples at 44.1kHz is 1114.6 samples at 96kHz
+        CHECK_EQ (b.getDecimationFactor(), 17);
+    }
+}
+
+//======================================================================
+//==================== ASYNCHRONOUS TEMPO ESTIMATION ===================
+//======================================================================
+
+TEST_SUITE ("asynchronousTempoEstimation")
+{
+    //======================================================================
+    TEST_CASE ("asynchronousEstimationFindsTheSameTempo")
+    {
+        BTrack synchronous;
+        BTrack asynchronous;
+        asynchronous.setAsynchronousTempoEstimation (true);
+        
+        CHECK_FALSE (synchronous.isEstimatingTempoAsynchronously());
+        CHECK (asynchronous.isEstimatingTempoAsynchronously());
+        
+        int numSynchronousBeats = 0;
+        int numAsynchronousBeats = 0;
+        
+        for (int i = 0; i < 4000; i++)
+        {
+            double sample = (i % 43) == 0 ? 1. : static_cast<double> (random() % 100) / 1000.;
+            
+            synchronous.processOnsetDetectionFunctionSample (sample);
+            asynchronous.processOnsetDetectionFunctionSample (sample);
+            
+            numSynchronousBeats += synchronous.beatDueInCurrentFrame() ? 1 : 0;
+            
+            if (asynchronous.beatDueInCurrentFrame())
+            {
+                numAsynchronousBeats++;
+                
+                // make sure the estimate is ready for the next frame, as it would be after a real-time audio callback
+                asynchronous.waitForTempoEstimation();
+            }
+        }
+        
+        CHECK (abs (numSynchronousBeats - numAsynchronousBeats) <= 2);
+        CHECK_EQ (asynchronous.getCurrentTempoEstimate(), synchronous.getCurrentTempoEstimate());
+    }
+    
+    //======================================================================
+    TEST_CASE ("tempoCanBeControlledWhileEstimatingAsynchronously")
+    {
+        BTrackDynamicTempoStates b (512, 1024, TempoRange (60., 200., 71));
+        b.setAsynchronousTempoEstimation (true);
+        
+        for (int i = 0; i < 3000; i++)
+        {
+            b.processOnsetDetectionFunctionSample ((i % 43) == 0 ? 1. : 0.);
+            
+            if (i == 1000)
+                b.setTempo (90.);
+            
+            if (i == 2000)
+            {
+                b.fixTempo (120.);
+                b.setTempoTransitionCutoff (1e-4);
+                b.updateHopAndFrameSize (256, 512);
+            }
+        }
+        
+        b.setAsynchronousTempoEstimation (false);
+        
+        CHECK_FALSE (b.isEstimatingTempoAsynchronously());
+        CHECK (b.getTempoModel().isTempoFixed());
+    }
+}
+
+//======================================================================
+//===================== AMORTISED TEMPO ESTIMATION =====================
+//======================================================================
+
+TEST_SUITE ("amortisedTempoEstimation")
+{
+    //======================================================================
+    TEST_CASE ("amortisedEstimationFindsTheSameTempo")
+    {
+        BTrack synchronous;
+        BTrack amortised;
+        amortised.setAmortisedTempoEstimation (true);
+        
+        CHECK (amortised.isAmortisingTempoEstimation());
+        
+        int numSynchronousBeats = 0;
+        int numAmortisedBeats = 0;
+        
+        for (int i = 0; i < 4000; i++)
+        {
+            double sample = (i % 43) == 0 ? 1. : static_cast<double> (random() % 100) / 1000.;
+            
+            synchronous.processOnsetDetectionFunctionSample (sample);
+            amortised.processOnsetDetectionFunctionSample (sample);
+            
+            numSynchronousBeats += synchronous.beatDueInCurrentFrame() ? 1 : 0;
+            numAmortisedBeats += amortised.beatDueInCurrentFrame() ? 1 : 0;
+        }
+        
+        CHECK (abs (numSynchronousBeats - numAmortisedBeats) <= 2);
+        CHECK_EQ (amortised.getCurrentTempoEstimate(), synchronous.getCurrentTempoEstimate());
+    }
+    
+    //======================================================================
+    TEST_CASE ("amortisedAndAsynchronousEstimationAreExclusive")
+    {
+        BTrack b;
+        
+        b.setAmortisedTempoEstimation (true);
+        b.setAsynchronousTempoEstimation (true);
+        CHECK_FALSE (b.isAmortisingTempoEstimation());
+        CHECK (b.isEstimatingTempoAsynchronously());
+        
+        b.setAmortisedTempoEstimation (true);
+        CHECK (b.isAmortisingTempoEstimation());
+        CHECK_FALSE (b.isEstimatingTempoAsynchronously());
+    }
+    
+    //======================================================================
+    TEST_CASE ("tempoIsUpdatedAfterTheStagesFollowingABeat")
+    {
+        BTrack b;
+        b.setAmortisedTempoEstimation (true);
+        
+        // settle on a pulse every 43 samples (120 bpm), then switch to one every 36 (143.6 bpm)
+        int i = 0;
+        
+        for (; i < 2000; i++)
+            b.processOnsetDetectionFunctionSample ((i % 43) == 0 ? 1. : 0.);
+        
+        for (; i < 4000; i++)
+            b.processOnsetDetectionFunctionSample ((i % 36) == 0 ? 1. : 0.);
+        
+        CHECK (fabs (b.getCurrentTempoEstimate() - 143.6) < 5.);
+    }
+}
+
+//======================================================================
+//========================== TEMPO CONTROL =============================
+//======================================================================
+
+TEST_SUITE ("tempoControl")
+{
+    //======================================================================
+    TEST_CASE ("changesOfTempoAreMadeAtTheNextSample")
+    {
+        BTrack b;
+        
+        b.fixTempo (100.);
+        CHECK_FALSE (b.getTempoModel().isTempoFixed());
+        
+        b.processOnsetDetectionFunctionSample (0.);
+        CHECK (b.getTempoModel().isTempoFixed());
+        
+        b.doNotFixTempo();
+        b.processOnsetDetectionFunctionSample (0.);
+        CHECK_FALSE (b.getTempoModel().isTempoFixed());
+    }
+    
+    //======================================================================
+    TEST_CASE ("theLatestChangesAreMadeHoweverManyAreAskedFor")
+    {
+        for (bool asynchronous : {false, true})
+        {
+            CAPTURE (asynchronous);
+            
+            BTrack b;
+            b.setAsynchronousTempoEstimation (asynchronous);
+            b.setEventQueueCapacity (16);
+            
+            // far more changes than the 64 a queue of them used to hold
+            for (int i = 0; i < 1000; i++)
+            {
+                b.setTempo (90. + i % 20);
+                b.fixTempo (100. + i % 40);
+                b.doNotFixTempo();
+            }
+            
+            b.setTempo (100.);
+            b.fixTempo (130.);
+            b.processOnsetDetectionFunctionSample (0.);
+            
+            BTrackEvent event;
+            REQUIRE (b.getNextEvent (event));
+            CHECK_EQ (event.type, TempoFixedEvent);
+            CHECK_EQ (event.tempo, 130.);
+            
+            // stopping the tempo estimation thread makes any changes it had not made yet
+            b.setAsynchronousTempoEstimation (false);
+            CHECK (b.getTempoModel().isTempoFixed());
+            
+            for (int i = 0; i < 1000; i++)
+                b.fixTempo (100. + i % 40);
+            
+            b.doNotFixTempo();
+            b.processOnsetDetectionFunctionSample (0.);
+            
+            REQUIRE (b.getNextEvent (event));
+            CHECK_EQ (event.type, TempoNotFixedEvent);
+            CHECK_FALSE (b.getTempoModel().isTempoFixed());
+        }
+    }
+    
+    //======================================================================
+    TEST_CASE ("settingTheTempoMakesTheCurrentSampleABeat")
+    {
+        BTrack b;
+        
+        for (int i = 0; i < 1000; i++)
+            b.processOnsetDetectionFunctionSample ((i % 43) == 0 ? 1. : 0.);
+        
+        // a beat is predicted half a beat period (at the new tempo of 100 bpm, 52 samples) after it was set
+        b.setTempo (100.);
+        b.processOnsetDetectionFunctionSample (0.);
+        
+        int samplesToNextBeat = 0;
+        
+        for (; samplesToNextBeat < 200; samplesToNextBeat++)
+        {
+            b.processOnsetDetectionFunctionSample (0.);
+            
+            if (b.beatDueInCurrentFrame())
+                break;
+        }
+        
+        CHECK (samplesToNextBeat > 26);
+        CHECK (samplesToNextBeat < 104);
+    }
+    
+    //======================================================================
+    TEST_CASE ("tempoCanBeChangedFromOtherThreadsWhileProcessing")
+    {
+        for (bool asynchronous : {false, true})
+        {
+            CAPTURE (asynchronous);
+            
+            BTrack b;
+            b.setAsynchronousTempoEstimation (asynchronous);
+            
+            std::atomic<bool> finished (false);
+            std::vector<std::thread> controllers;
+            
+            for (int t = 0; t < 2; t++)
+            {
+                controllers.emplace_back ([&b, &finished, t]
+                {
+                    for (int i = 0; ! finished; i++)
+                    {
+                        if (i % 3 == 0)
+                            b.setTempo (90. + t * 20.);
+                        else if (i % 3 == 1)
+                            b.fixTempo (100. + i % 40);
+                        else
+                            b.doNotFixTempo();
+                        
+                        std::this_thread::sleep_for (std::chrono::microseconds (100));
+                    }
+                });
+            }
+            
+            int numBeats = 0;
+            
+            for (int i = 0; i < 20000; i++)
+            {
+                b.processOnsetDetectionFunctionSample ((i % 43) == 0 ? 1. : 0.);
+                numBeats += b.beatDueInCurrentFrame() ? 1 : 0;
+            }
+            
+            finished = true;
+            
+            for (std::thread& controller : controllers)
+                controller.join();
+            
+            CHECK (numBeats > 0);
+            CHECK (b.getCurrentTempoEstimate() >= 80.);
+            CHECK (b.getCurrentTempoEstimate() <= 160.);
+        }
+    }
+}
+
+//======================================================================
+//========================= PUBLISHED STATE ============================
+//======================================================================
+
+TEST_SUITE ("publishedState")
+{
+    //======================================================================
+    TEST_CASE ("publishedStateMatchesTheStateAfterEachFrame")
+    {
+        BTrackFloat b;
+        
+        BTrackState state = b.getPublishedState();
+        CHECK_EQ (state.frameIndex, -1);
+        CHECK_EQ (state.lastBeatFrameIndex, -1);
+        CHECK_FALSE (state.beatDue);
+        CHECK_EQ (state.tempo, b.getCurrentTempoEstimate());
+        
+        long lastBeatFrameIndex = -1;
+        
+        for (int i = 0; i < 2000; i++)
+        {
+            b.processOnsetDetectionFunctionSample ((i % 43) == 0 ? 1.f : 0.f);
+            
+            if (b.beatDueInCurrentFrame())
+                lastBeatFrameIndex = i;
+            
+            state = b.getPublishedState();
+            
+            REQUIRE_EQ (state.frameIndex, i);
+            REQUIRE_EQ (state.beatDue, b.beatDueInCurrentFrame());
+            REQUIRE_EQ (state.lastBeatFrameIndex, lastBeatFrameIndex);
+            REQUIRE_EQ (state.tempo, b.getCurrentTempoEstimate());
+            REQUIRE_EQ (state.cumulativeScore, b.getLatestCumulativeScoreValue());
+        }
+        
+        CHECK (lastBeatFrameIndex >= 0);
+        
+        // resetting the beat tracker starts counting frames again
+        b.updateHopAndFrameSize (256, 512);
+        state = b.getPublishedState();
+        CHECK_EQ (state.frameIndex, -1);
+        CHECK_EQ (state.lastBeatFrameIndex, -1);
+    }
+    
+    //======================================================================
+    TEST_CASE ("publishedStateCanBeReadFromOtherThreadsWhileProcessing")
+    {
+        BTrack b;
+        
+        std::atomic<bool> finished (false);
+        std::vector<std::thread> readers;
+        std::vector<int> numInconsistentReads (3, 0);
+        
+        for (int t = 0; t < 3; t++)
+        {
+            readers.emplace_back ([&b, &finished, &numInconsistentReads, t]
+            {
+                long previousFrameIndex = -1;
+                
+                while (! finished)
+                {
+                    BTrackState state = b.getPublishedState();
+                    
+                    // the fields of one frame's state must agree with each other and frames never go backwards
+                    bool consistent = state.frameIndex >= previousFrameIndex
+                                        && state.lastBeatFrameIndex <= state.frameIndex
+                                        && (! state.beatDue || state.lastBeatFrameIndex == state.frameIndex)
+                                        && state.tempo >= 80. && state.tempo <= 160.;
+                    
+                    if (! consistent)
+                        numInconsistentReads[t]++;
+                    
+                    previousFrameIndex = state.frameIndex;
+                    std::this_thread::yield();
+                }
+            });
+        }
+        
+        for (int i = 0; i < 20000; i++)
+            b.processOnsetDetectionFunctionSample ((i % 43) == 0 ? 1. : 0.);
+        
+        finished = true;
+        
+        for (std::thread& reader : readers)
+            reader.join();
+        
+        for (int t = 0; t < 3; t++)
+            CHECK_EQ (numInconsistentReads[t], 0);
+        
+        CHECK_EQ (b.getPublishedState().frameIndex, 19999);
+    }
+}
+
+//======================================================================
+//=========================== EVENT QUEUE ==============================
+//======================================================================
+
+TEST_SUITE ("eventQueue")
+{
+    //======================================================================
+    TEST_CASE ("eventsAreNotQueuedByDefault")
+    {
+        BTrack b;
+        
+        for (int i = 0; i < 1000; i++)
+            b.processOnsetDetectionFunctionSample ((i % 43) == 0 ? 1. : 0.);
+        
+        BTrackEvent event;
+        CHECK_FALSE (b.getNextEvent (event));
+    }
+    
+    //======================================================================
+    TEST_CASE ("eventsMatchTheBeatsAndTempiOfEachFrame")
+    {
+        for (int hopSize : {512, 128})
+        {
+            CAPTURE (hopSize);
+            
+            BTrack b (hopSize);
+            b.setDecimation (true);
+            b.setEventQueueCapacity (1000);
+            
+            std::vector<long> beatFrames;
+            std::vector<double> tempi;
+            double tempo = b.getCurrentTempoEstimate();
+            int period = 43 * 512 / hopSize;
+            
+            for (int i = 0; i < 5000; i++)
+            {
+                b.processOnsetDetectionFunctionSample ((i % period) == 0 ? 1. : 0.);
+                
+                if (b.getCurrentTempoEstimate() != tempo)
+                {
+                    tempo = b.getCurrentTempoEstimate();
+                    tempi.push_back (tempo);
+                }
+                
+                if (b.beatDueInCurrentFrame())
+                    beatFrames.push_back (i);
+            }
+            
+            REQUIRE (beatFrames.size() > 10);
+            
+            std::vector<long> beatEventFrames;
+            std::vector<double> tempoEvents;
+            BTrackEvent event;
+            
+            while (b.getNextEvent (event))
+            {
+                CHECK_EQ (event.samplePosition, event.frameIndex * hopSize);
+                CHECK (event.sampleOffset >= 0);
+                CHECK (event.sampleOffset < hopSize);
+                
+                if (event.type != BeatEvent)
+                    CHECK_EQ (event.sampleOffset, 0);
+                
+                if (event.type == BeatEvent)
+                    beatEventFrames.push_back (event.frameIndex);
+                else if (event.type == TempoChangeEvent)
+                    tempoEvents.push_back (event.tempo);
+            }
+            
+            CHECK (beatEventFrames == beatFrames);
+            CHECK (tempoEvents == tempi);
+        }
+    }
+    
+    //======================================================================
+    TEST_CASE ("sampleOffsetsPlaceBeatsWithinTheirHops")
+    {
+        // clicks at 120 bpm are 43.07 hops apart, so they fall at a different point in each hop
+        const int hopSize = 512;
+        const long clickPeriod = 22050;
+        
+        for (long clickPhase : {100L, 356L})
+        {
+            CAPTURE (clickPhase);
+            
+            BTrack b (hopSize);
+            b.setEventQueueCapacity (1000);
+            std::vector<double> frame (hopSize);
+            std::vector<double> errors;
+            std::vector<double> errorsWithoutOffsets;
+            
+            for (long i = 0; i < 4000; i++)
+            {
+                for (int j = 0; j < hopSize; j++)
+                {
+                    long position = (((i * hopSize) + j - clickPhase) % clickPeriod + clickPeriod) % clickPeriod;
+                    frame[j] = position < 200 ? sin (position * 0.5) * exp (-position / 40.) : 0.;
+                }
+                
+                b.processAudioFrame (frame.data());
+                
+                BTrackEvent event;
+                
+                // leave the beat clock time to settle
+                while (b.getNextEvent (event))
+                {
+                    if (event.type == BeatEvent && i >= 2000)
+                    {
+                        errors.push_back (remainder (static_cast<double> (event.samplePosition + event.sampleOffset - clickPhase), clickPeriod));
+                        errorsWithoutOffsets.push_back (remainder (static_cast<double> (event.samplePosition - clickPhase), clickPeriod));
+                    }
+                }
+            }
+            
+            REQUIRE (errors.size() > 40);
+            
+            // the error is the same at every beat, give or take a small part of a hop
+            auto standardDeviation = [] (const std::vector<double>& values)
+            {
+                double mean = 0;
+                double sumOfSquares = 0;
+                
+                for (double value : values)
+                    mean += value / values.size();
+                
+                for (double value : values)
+                    sumOfSquares += (value - mean) * (value - mean);
+                
+                return sqrt (sumOfSquares / values.size());
+            };
+            
+            CHECK (standardDeviation (errors) < hopSize / 6);
+            CHECK (standardDeviation (errors) < standardDeviation (errorsWithoutOffsets) / 2);
+        }
+    }
+    
+    //======================================================================
+    TEST_CASE ("fixingTheTempoQueuesEvents")
+    {
+        BTrack b;
+        b.setEventQueueCapacity (16);
+        
+        b.fixTempo (100.);
+        b.processOnsetDetectionFunctionSample (0.);
+        b.doNotFixTempo();
+        b.doNotFixTempo();
+        b.processOnsetDetectionFunctionSample (0.);
+        
+        BTrackEvent event;
+        
+        // the audio thread can tell that there is an event to take, even without a beat
+        CHECK (b.hasEvents());
+        CHECK_FALSE (b.beatDueInCurrentFrame());
+        
+        REQUIRE (b.getNextEvent (event));
+        CHECK_EQ (event.type, TempoFixedEvent);
+        CHECK_EQ (event.frameIndex, 0);
+        CHECK_EQ (event.tempo, doctest::Approx (100.).epsilon (0.02));
+        
+        // only a change of the fixed state is an event, so the second doNotFixTempo() adds nothing
+        REQUIRE (b.getNextEvent (event));
+        CHECK_EQ (event.type, TempoNotFixedEvent);
+        CHECK_EQ (event.frameIndex, 1);
+        
+        CHECK_FALSE (b.getNextEvent (event));
+        CHECK_FALSE (b.hasEvents());
+    }
+    
+    //======================================================================
+    TEST_CASE ("eventsAreDroppedWhenTheQueueIsFull")
+    {
+        BTrack b;
+        b.setEventQueueCapacity (2);
+        
+        for (int i = 0; i < 2000; i++)
+            b.processOnsetDetectionFunctionSample ((i % 43) == 0 ? 1. : 0.);
+        
+        BTrackEvent first;
+        BTrackEvent second;
+        BTrackEvent third;
+        
+        REQUIRE (b.getNextEvent (first));
+        REQUIRE (b.getNextEvent (second));
+        CHECK_FALSE (b.getNextEvent (third));
+        
+        // the oldest events are kept
+        CHECK (first.frameIndex <= second.frameIndex);
+        CHECK (second.frameIndex < 1000);
+        
+        b.setEventQueueCapacity (0);
+        
+        for (int i = 0; i < 200; i++)
+            b.processOnsetDetectionFunctionSample ((i % 43) == 0 ? 1. : 0.);
+        
+        CHECK_FALSE (b.getNextEvent (third));
+    }
+    
+    //======================================================================
+    TEST_CASE ("eventsCanBeTakenOnAnotherThreadWhileProcessing")
+    {
+        // enough room for every event, so that none are dropped however the threads are scheduled
+        BTrack b;
+        b.setEventQueueCapacity (4096);
+        
+        std::atomic<bool> finished (false);
+        int numBeatEvents = 0;
+        int numOutOfOrderEvents = 0;
+        
+        std::thread consumer ([&]
+        {
+            long lastFrameIndex = -1;
+            BTrackEvent event;
+            
+            while (true)
+            {
+                // check finished before draining, so that nothing queued before it was set is missed
+                bool wasFinished = finished;
+                
+                while (b.getNextEvent (event))
+                {
+                    numOutOfOrderEvents += event.frameIndex < lastFrameIndex ? 1 : 0;
+                    numBeatEvents += event.type == BeatEvent ? 1 : 0;
+                    lastFrameIndex = event.frameIndex;
+                }
+                
+                if (wasFinished)
+                    break;
+                
+                std::this_thread::sleep_for (std::chrono::microseconds (200));
+            }
+        });
+        
+        int numBeats = 0;
+        
+        for (int i = 0; i < 20000; i++)
+        {
+            b.processOnsetDetectionFunctionSample ((i % 43) == 0 ? 1. : 0.);
+            numBeats += b.beatDueInCurrentFrame() ? 1 : 0;
+        }
+        
+        finished = true;
+        consumer.join();
+        
+        CHECK (numBeats > 100);
+        CHECK_EQ (numBeatEvents, numBeats);
+        CHECK_EQ (numOutOfOrderEvents, 0);
+    }
+}
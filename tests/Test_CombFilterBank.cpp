@@ -0,0 +1,98 @@
+#include "doctest.h"
+#include <CombFilterBank.h>
+#include <BTrack.h>
+#include <cmath>
+#include <vector>
+
+//======================================================================
+//========================== COMB FILTER BANK ==========================
+//======================================================================
+TEST_SUITE ("combFilterBank")
+{
+    //======================================================================
+    TEST_CASE ("balancedCombFilterBankMatchesDirectCalculation")
+    {
+        std::vector<double> weighting (128);
+        std::vector<double> acf (512);
+
+        for (int n = 0; n < 128; n++)
+            weighting[n] = (n / (43. * 43.)) * exp (-(n * n) / (2. * 43. * 43.));
+
+        for (int i = 0; i < 512; i++)
+            acf[i] = static_cast<double> (random() % 1000) / 1000.;
+
+        CombFilterBank combFilterBank = CombFilterBank::createBalancedCombFilterBank (weighting, 2, 127, 4);
+
+        CHECK_EQ (combFilterBank.getNumRows(), 128);
+        CHECK_EQ (combFilterBank.getNumTaps(), 126 * 16);
+        CHECK_EQ (combFilterBank.getInputLength(), 4 * 127 + 3);
+
+        std::vector<double> output (128);
+        combFilterBank.process (acf.data(), output.data());
+
+        CHECK_EQ (output[0], 0.);
+        CHECK_EQ (output[127], 0.);
+
+        for (int i = 2; i <= 127; i++)
+        {
+            double expected = 0;
+
+            for (int a = 1; a <= 4; a++)
+                for (int b = 1 - a; b <= a - 1; b++)
+                    expected += (acf[(a * i + b) - 1] * weighting[i - 1]) / (2 * a - 1);
+
+            CHECK_EQ (output[i - 1], doctest::Approx (expected).epsilon (1e-12));
+        }
+    }
+
+    //======================================================================
+    TEST_CASE ("customRowsAreSummed")
+    {
+        CombFilterBank combFilterBank;
+        combFilterBank.addRow();
+        combFilterBank.addRow();
+        combFilterBank.addTap (1, 2.);
+        combFilterBank.addTap (3, 0.5);
+        combFilterBank.addRow();
+        combFilterBank.addTap (0, -1.);
+
+        double input[] = {1., 2., 3., 4.};
+        double output[3];
+        combFilterBank.process (input, output);
+
+        CHECK_EQ (combFilterBank.getNumRows(), 3);
+        CHECK_EQ (combFilterBank.getInputLength(), 4);
+        CHECK_EQ (output[0], 0.);
+        CHECK_EQ (output[1], 6.);
+        CHECK_EQ (output[2], -1.);
+    }
+
+    //======================================================================
+    TEST_CASE ("beatTrackerOnlyAcceptsBanksThatFit")
+    {
+        BTrack b;
+
+        CHECK_EQ (b.getCombFilterBank().getNumRows(), 128);
+
+        CombFilterBank tooManyLags;
+        tooManyLags.addTap (512, 1.);
+        CHECK_FALSE (b.setCombFilterBank (tooManyLags));
+
+        // a single comb element per period still finds beats
+        std::vector<double> weighting (128, 1.);
+        CHECK (b.setCombFilterBank (CombFilterBank::createBalancedCombFilterBank (weighting, 2, 127, 1)));
+        CHECK_EQ (b.getCombFilterBank().getNumTaps(), 126);
+
+        int numBeats = 0;
+
+        for (int i = 0; i < 2000; i++)
+        {
+            b.processOnsetDetectionFunctionSample ((i % 43) == 0 ? 1. : 0.);
+
+            if (b.beatDueInCurrentFrame())
+                numBeats++;
+        }
+
+        CHECK (numBeats > 0);
+    }
+}
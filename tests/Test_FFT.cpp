@@ -0,0 +1,248 @@
+#include "doctest.h"
+#include <FFT.h>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+#include <thread>
+
+//======================================================================
+//======================== FFT IMPLEMENTATIONS =========================
+//======================================================================
+TEST_SUITE ("fftImplementations")
+{
+    //======================================================================
+    template <typename SampleType>
+    void checkMatchesDirectDFT (FFT<SampleType>* fft, int size, double tolerance)
+    {
+        std::vector<double> signal (size);
+
+        for (int i = 0; i < size; i++)
+            signal[i] = sin (0.3 * i) + 0.5 * cos (1.7 * i) + (static_cast<double> (random() % 2000) / 1000.) - 1.;
+
+        SampleType* real = fft->getRealBuffer();
+
+        for (int i = 0; i < size; i++)
+            real[i] = static_cast<SampleType> (signal[i]);
+
+        fft->performForwardTransform();
+
+        // compare each bin with a direct DFT, relative to the largest bin
+        std::vector<double> expected (2 * ((size / 2) + 1));
+        double peak = 0;
+
+        for (int k = 0; k <= size / 2; k++)
+        {
+            for (int n = 0; n < size; n++)
+            {
+                expected[2 * k] += signal[n] * cos (2. * M_PI * k * n / size);
+                expected[(2 * k) + 1] -= signal[n] * sin (2. * M_PI * k * n / size);
+            }
+
+            peak = std::max (peak, std::hypot (expected[2 * k], expected[(2 * k) + 1]));
+        }
+
+        const SampleType* spectrum = fft->getComplexBuffer();
+        double maxDifference = 0;
+
+        for (int i = 0; i < 2 * ((size / 2) + 1); i++)
+            maxDifference = std::max (maxDifference, fabs (spectrum[i] - expected[i]));
+
+        CHECK (maxDifference / peak < tolerance);
+
+        // the inverse transform is unnormalised, so the round trip multiplies the signal by size
+        fft->performInverseTransform();
+        maxDifference = 0;
+
+        for (int i = 0; i < size; i++)
+            maxDifference = std::max (maxDifference, fabs ((real[i] / size) - signal[i]));
+
+        CHECK (maxDifference < tolerance * 10);
+    }
+
+    //======================================================================
+    template <typename SampleType>
+    void checkImplementationMatchesDirectDFT (int implementation, int size, double tolerance)
+    {
+        std::unique_ptr<FFT<SampleType>> fft = FFT<SampleType>::create (implementation, size);
+
+        CHECK_EQ (fft->getImplementation(), implementation);
+        checkMatchesDirectDFT (fft.get(), size, tolerance);
+    }
+
+    //======================================================================
+    template <typename SampleType>
+    void checkAllAvailableImplementations (double tolerance)
+    {
+        int implementations[] = {FFTWImplementation, KissFFTImplementation, BuiltInFFTImplementation};
+
+        for (int implementation : implementations)
+        {
+            if (! FFT<SampleType>::isAvailable (implementation))
+                continue;
+
+            // Kiss FFT works in single precision, whatever the sample type
+            double implementationTolerance = implementation == KissFFTImplementation ? std::max (tolerance, 1e-5) : tolerance;
+
+            for (int size : {2, 16, 1024, 48, 1000, 882, 210, 194, 3, 15, 1023, 441, 97})
+            {
+                if (! FFT<SampleType>::isSupported (implementation, size))
+                    continue;
+
+                CAPTURE (implementation);
+                CAPTURE (size);
+                checkImplementationMatchesDirectDFT<SampleType> (implementation, size, implementationTolerance);
+            }
+        }
+    }
+
+    //======================================================================
+    TEST_CASE ("allImplementationsMatchDirectDFTInDoublePrecision")
+    {
+        checkAllAvailableImplementations<double> (1e-12);
+    }
+
+    //======================================================================
+    TEST_CASE ("allImplementationsMatchDirectDFTInSinglePrecision")
+    {
+        checkAllAvailableImplementations<float> (1e-5);
+    }
+
+    //======================================================================
+    TEST_CASE ("unavailableImplementationFallsBackToDefault")
+    {
+        CHECK (FFT<double>::isAvailable (BuiltInFFTImplementation));
+        CHECK (FFT<double>::isSupported (BuiltInFFTImplementation, 15));
+        CHECK_FALSE (FFT<double>::isSupported (BuiltInFFTImplementation, 1));
+
+        std::unique_ptr<FFT<double>> fft = FFT<double>::create (DefaultFFTImplementation, 1024);
+        CHECK_EQ (fft->getImplementation(), FFT<double>::getDefaultImplementation());
+
+        if (! FFT<double>::isAvailable (FFTWImplementation))
+        {
+            fft = FFT<double>::create (FFTWImplementation, 1024);
+            CHECK_EQ (fft->getImplementation(), FFT<double>::getDefaultImplementation());
+        }
+    }
+
+    //======================================================================
+    TEST_CASE ("oddSizesFallBackToAnImplementationThatSupportsThem")
+    {
+        int implementations[] = {DefaultFFTImplementation, FFTWImplementation, KissFFTImplementation, BuiltInFFTImplementation};
+
+        for (int implementation : implementations)
+        {
+            for (int size : {15, 1023})
+            {
+                CAPTURE (implementation);
+                CAPTURE (size);
+
+                std::unique_ptr<FFT<double>> fft = FFT<double>::create (implementation, size);
+                CHECK (FFT<double>::isSupported (fft->getImplementation(), size));
+
+                double tolerance = fft->getImplementation() == KissFFTImplementation ? 1e-5 : 1e-12;
+                checkMatchesDirectDFT (fft.get(), size, tolerance);
+            }
+        }
+    }
+}
+
+//======================================================================
+//=========================== FFT PLAN CACHE ===========================
+//======================================================================
+TEST_SUITE ("fftPlanCache")
+{
+    //======================================================================
+    TEST_CASE ("fftsOfTheSameSizeSharePlans")
+    {
+        int initialNumPlans = FFTPlanCache::getNumPlans();
+
+        {
+            std::unique_ptr<FFT<double>> first = FFT<double>::create (BuiltInFFTImplementation, 4096);
+            CHECK_EQ (FFTPlanCache::getNumPlans(), initialNumPlans + 1);
+
+            std::unique_ptr<FFT<double>> second = FFT<double>::create (BuiltInFFTImplementation, 4096);
+            CHECK_EQ (FFTPlanCache::getNumPlans(), initialNumPlans + 1);
+
+            // the twiddle factors are held in the sample type, so other precisions and sizes need plans of their own
+            std::unique_ptr<FFT<float>> third = FFT<float>::create (BuiltInFFTImplementation, 4096);
+            std::unique_ptr<FFT<double>> fourth = FFT<double>::create (BuiltInFFTImplementation, 2048);
+            CHECK_EQ (FFTPlanCache::getNumPlans(), initialNumPlans + 3);
+
+            first.reset();
+            CHECK_EQ (FFTPlanCache::getNumPlans(), initialNumPlans + 3);
+        }
+
+        // plans are freed with the last FFT that uses them
+        CHECK_EQ (FFTPlanCache::getNumPlans(), initialNumPlans);
+    }
+
+    //======================================================================
+    TEST_CASE ("fftsCanBeCreatedAndUsedOnManyThreads")
+    {
+        int initialNumPlans = FFTPlanCache::getNumPlans();
+        int numThreads = 8;
+        std::vector<int> failures (numThreads, 0);
+        std::vector<std::thread> threads;
+
+        for (int t = 0; t < numThreads; t++)
+        {
+            threads.emplace_back ([t, &failures]
+            {
+                for (int iteration = 0; iteration < 50; iteration++)
+                {
+                    int size = 256 << (iteration % 3);
+                    std::unique_ptr<FFT<double>> fft = FFT<double>::create (iteration % 2 == 0 ? DefaultFFTImplementation : BuiltInFFTImplementation, size);
+
+                    // an impulse at the start of the frame has a flat spectrum
+                    double* real = fft->getRealBuffer();
+                    std::fill (real, real + size, 0.);
+                    real[0] = 1.;
+
+                    fft->performForwardTransform();
+
+                    const double* spectrum = fft->getComplexBuffer();
+
+                    for (int k = 0; k <= size / 2; k++)
+                        if (fabs (spectrum[2 * k] - 1.) > 1e-6 || fabs (spectrum[(2 * k) + 1]) > 1e-6)
+                            failures[t]++;
+                }
+            });
+        }
+
+        for (std::thread& thread : threads)
+            thread.join();
+
+        for (int t = 0; t < numThreads; t++)
+            CHECK_EQ (failures[t], 0);
+
+        CHECK_EQ (FFTPlanCache::getNumPlans(), initialNumPlans);
+    }
+
+    //======================================================================
+    TEST_CASE ("fftwWisdomCanBeExportedAndImported")
+    {
+        if (! FFT<double>::isAvailable (FFTWImplementation))
+        {
+            // without FFTW there is no wisdom to import or export
+            CHECK_FALSE (FFTPlanCache::exportFFTWWisdom ("btrack_fftw_wisdom"));
+            CHECK_FALSE (FFTPlanCache::importFFTWWisdom ("btrack_fftw_wisdom"));
+            return;
+        }
+
+        FFTPlanCache::setFFTWMeasure (true);
+        CHECK (FFTPlanCache::isUsingFFTWMeasure());
+
+        {
+            std::unique_ptr<FFT<double>> fft = FFT<double>::create (FFTWImplementation, 1024);
+            CHECK_EQ (fft->getImplementation(), FFTWImplementation);
+        }
+
+        FFTPlanCache::setFFTWMeasure (false);
+
+        CHECK (FFTPlanCache::exportFFTWWisdom ("btrack_fftw_wisdom"));
+        CHECK (FFTPlanCache::importFFTWWisdom ("btrack_fftw_wisdom"));
+
+        std::remove ("btrack_fftw_wisdom");
+    }
+}
@@ -0,0 +1,97 @@
+#include "doctest.h"
+#include <LockFreeQueue.h>
+#include <thread>
+
+//======================================================================
+//========================== LOCK FREE QUEUE ===========================
+//======================================================================
+TEST_SUITE ("lockFreeQueue")
+{
+    //======================================================================
+    TEST_CASE ("itemsComeOutInTheOrderTheyWentIn")
+    {
+        LockFreeQueue<int> queue (4);
+        int item = -1;
+        
+        CHECK (queue.isEmpty());
+        CHECK_FALSE (queue.pop (item));
+        
+        for (int i = 0; i < 4; i++)
+            CHECK (queue.push (i));
+        
+        // the queue is full
+        CHECK_FALSE (queue.push (4));
+        CHECK_FALSE (queue.isEmpty());
+        
+        for (int i = 0; i < 4; i++)
+        {
+            CHECK (queue.pop (item));
+            CHECK_EQ (item, i);
+        }
+        
+        CHECK_FALSE (queue.pop (item));
+        CHECK (queue.isEmpty());
+        
+        // and it wraps around
+        for (int i = 0; i < 10; i++)
+        {
+            CHECK (queue.push (i));
+            CHECK (queue.pop (item));
+            CHECK_EQ (item, i);
+        }
+    }
+    
+    //======================================================================
+    TEST_CASE ("settingTheCapacityEmptiesTheQueue")
+    {
+        LockFreeQueue<int> queue (2);
+        queue.push (1);
+        
+        queue.setCapacity (8);
+        
+        int item;
+        CHECK_FALSE (queue.pop (item));
+        
+        for (int i = 0; i < 8; i++)
+            CHECK (queue.push (i));
+        
+        CHECK_FALSE (queue.push (8));
+    }
+    
+    //======================================================================
+    TEST_CASE ("everyItemArrivesOnceAndInOrderAcrossThreads")
+    {
+        int numItems = 20000;
+        LockFreeQueue<int> queue (16);
+        
+        std::thread producer ([&]
+        {
+            for (int i = 0; i < numItems; i++)
+                while (! queue.push (i))
+                    std::this_thread::yield();
+        });
+        
+        int expectedItem = 0;
+        int numOutOfOrderItems = 0;
+        int item;
+        
+        while (expectedItem < numItems)
+        {
+            if (! queue.pop (item))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            
+            if (item != expectedItem)
+                numOutOfOrderItems++;
+            
+            expectedItem = item + 1;
+        }
+        
+        producer.join();
+        
+        CHECK_EQ (numOutOfOrderItems, 0);
+        CHECK (queue.isEmpty());
+    }
+}
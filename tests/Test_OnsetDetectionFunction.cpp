@@ -0,0 +1,493 @@
+#include "doctest.h"
+#include <OnsetDetectionFunction.h>
+#include <StaticOnsetDetectionFunction.h>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <random>
+
+//======================================================================
+static const double pi = 3.14159265358979323846;
+
+//======================================================================
+static std::vector<double> createTestSignal (int numSamples)
+{
+    std::vector<double> signal (numSamples);
+    std::mt19937 generator (42);
+    std::uniform_real_distribution<double> noiseDistribution (-1., 1.);
+    
+    // a decaying tone that is re-triggered every quarter of a second, plus some noise
+    for (int i = 0; i < numSamples; i++)
+    {
+        double t = static_cast<double> (i) / 44100.;
+        double envelope = exp (-20. * fmod (t, 0.25));
+        double noise = noiseDistribution (generator);
+        
+        signal[i] = envelope * sin (2. * pi * 440. * t) + 0.05 * noise;
+    }
+    
+    return signal;
+}
+
+//======================================================================
+//================= COMPLEX DOMAIN PREDICTION METHODS ==================
+//======================================================================
+TEST_SUITE ("complexDomainPredictionMethods")
+{
+    //======================================================================
+    void checkPredictionMethodsMatch (int onsetDetectionFunctionType)
+    {
+        int hopSize = 512;
+        int frameSize = 1024;
+        int numFrames = 200;
+        
+        std::vector<double> signal = createTestSignal (hopSize * numFrames);
+        
+        OnsetDetectionFunction reference (hopSize, frameSize, onsetDetectionFunctionType, HanningWindow);
+        OnsetDetectionFunction complexPrediction (hopSize, frameSize, onsetDetectionFunctionType, HanningWindow);
+        
+        reference.setComplexDomainPredictionMethod (PhaseUnwrappingPrediction);
+        complexPrediction.setComplexDomainPredictionMethod (ComplexArithmeticPrediction);
+        
+        double maxRelativeDifference = 0;
+        
+        for (int i = 0; i < numFrames; i++)
+        {
+            double expected = reference.calculateOnsetDetectionFunctionSample (&signal[i * hopSize]);
+            double actual = complexPrediction.calculateOnsetDetectionFunctionSample (&signal[i * hopSize]);
+            
+            double relativeDifference = fabs (actual - expected) / std::max (fabs (expected), 1e-9);
+            maxRelativeDifference = std::max (maxRelativeDifference, relativeDifference);
+        }
+        
+        // the two formulations differ only in rounding
+        CHECK (maxRelativeDifference < 1e-6);
+    }
+    
+    //======================================================================
+    TEST_CASE ("complexSpectralDifferenceMatchesPhaseUnwrapping")
+    {
+        checkPredictionMethodsMatch (ComplexSpectralDifference);
+    }
+    
+    //======================================================================
+    TEST_CASE ("complexSpectralDifferenceHWRMatchesPhaseUnwrapping")
+    {
+        checkPredictionMethodsMatch (ComplexSpectralDifferenceHWR);
+    }
+}
+
+//======================================================================
+//========================= SPECTRAL KERNELS ===========================
+//======================================================================
+TEST_SUITE ("spectralKernels")
+{
+    //======================================================================
+    template <typename Real>
+    void checkAllInstructionSetsMatchScalarKernels()
+    {
+        // an odd number of bins, so that every vector width has a scalar tail
+        const int numBins = 513;
+        
+        std::vector<Real> complexSpectrum (2 * numBins);
+        std::vector<Real> weights (numBins);
+        std::mt19937 generator (1);
+        std::uniform_real_distribution<double> distribution (-10., 10.);
+        
+        for (int i = 0; i < 2 * numBins; i++)
+            complexSpectrum[i] = static_cast<Real> (distribution (generator));
+        
+        for (int i = 0; i < numBins; i++)
+            weights[i] = static_cast<Real> (i + 1);
+        
+        // include some empty bins, which have a phase of zero
+        for (int i = 0; i < 20; i += 3)
+            complexSpectrum[2 * i] = complexSpectrum[(2 * i) + 1] = 0;
+        
+        const SpectralKernels<Real>& scalar = SpectralKernels<Real>::getKernels (ScalarInstructions);
+        
+        for (int instructionSet : { SSE2Instructions, AVX2Instructions, AVX512Instructions })
+        {
+            if (! SpectralKernels<Real>::isSupported (instructionSet))
+                continue;
+            
+            CAPTURE (instructionSet);
+            
+            const SpectralKernels<Real>& simd = SpectralKernels<Real>::getKernels (instructionSet);
+            
+            std::vector<Real> expected (numBins), actual (numBins);
+            scalar.calculateMagnitudes (complexSpectrum.data(), expected.data(), numBins);
+            simd.calculateMagnitudes (complexSpectrum.data(), actual.data(), numBins);
+            
+            for (int i = 0; i < numBins; i++)
+                REQUIRE (actual[i] == doctest::Approx (expected[i]));
+            
+            CHECK (simd.sumWeighted (expected.data(), weights.data(), numBins) == doctest::Approx (scalar.sumWeighted (expected.data(), weights.data(), numBins)));
+            
+            // the maxima of products and sums are exact, so every instruction set gives the same result
+            std::vector<Real> expectedMaxima (numBins, Real (40)), actualMaxima (numBins, Real (40));
+            scalar.updateMaximumProducts (expected.data(), Real (3), expectedMaxima.data(), numBins);
+            simd.updateMaximumProducts (expected.data(), Real (3), actualMaxima.data(), numBins);
+            scalar.updateMaximumSums (weights.data(), Real (-300), expectedMaxima.data(), numBins);
+            simd.updateMaximumSums (weights.data(), Real (-300), actualMaxima.data(), numBins);
+            CHECK (actualMaxima == expectedMaxima);
+            
+            for (bool halfWaveRectify : { false, true })
+            {
+                std::vector<Real> prevExpected (numBins, Real (5)), prevActual (numBins, Real (5));
+                
+                Real expectedSum = scalar.sumMagnitudeDifferences (expected.data(), prevExpected.data(), weights.data(), numBins, halfWaveRectify, true);
+                Real actualSum = simd.sumMagnitudeDifferences (expected.data(), prevActual.data(), weights.data(), numBins, halfWaveRectify, true);
+                
+                CHECK (actualSum == doctest::Approx (expectedSum));
+                CHECK (prevActual == prevExpected);
+                
+                // run the complex spectral difference over a few frames so that the phasor history is exercised
+                std::vector<Real> scalarHistory[5], simdHistory[5];
+                
+                for (int k = 0; k < 5; k++)
+                {
+                    scalarHistory[k].assign (numBins, (k == 0 || k == 2 || k == 4) ? Real (0.5) : Real (0));
+                    simdHistory[k] = scalarHistory[k];
+                }
+                
+                for (int frame = 0; frame < 3; frame++)
+                {
+                    std::rotate (complexSpectrum.begin(), complexSpectrum.begin() + 7, complexSpectrum.end());
+                    
+                    Real expectedCSD = scalar.sumComplexSpectralDifferences (complexSpectrum.data(), expected.data(), scalarHistory[0].data(), scalarHistory[1].data(), scalarHistory[2].data(), scalarHistory[3].data(), scalarHistory[4].data(), weights.data(), numBins, halfWaveRectify, true);
+                    Real actualCSD = simd.sumComplexSpectralDifferences (complexSpectrum.data(), actual.data(), simdHistory[0].data(), simdHistory[1].data(), simdHistory[2].data(), simdHistory[3].data(), simdHistory[4].data(), weights.data(), numBins, halfWaveRectify, true);
+                    
+                    CHECK (actualCSD == doctest::Approx (expectedCSD));
+                }
+                
+                for (int k = 0; k < 5; k++)
+                    for (int i = 0; i < numBins; i++)
+                        REQUIRE (simdHistory[k][i] == doctest::Approx (scalarHistory[k][i]));
+            }
+        }
+    }
+    
+    //======================================================================
+    TEST_CASE ("allInstructionSetsMatchScalarKernelsInDoublePrecision")
+    {
+        checkAllInstructionSetsMatchScalarKernels<double>();
+    }
+    
+    //======================================================================
+    TEST_CASE ("allInstructionSetsMatchScalarKernelsInSinglePrecision")
+    {
+        checkAllInstructionSetsMatchScalarKernels<float>();
+    }
+}
+
+//======================================================================
+//========================== SAMPLE TYPES ==============================
+//======================================================================
+TEST_SUITE ("sampleTypes")
+{
+    //======================================================================
+    TEST_CASE ("singlePrecisionMatchesDoublePrecision")
+    {
+        int hopSize = 512;
+        int frameSize = 1024;
+        int numFrames = 400;
+        
+        std::vector<double> signal = createTestSignal (hopSize * numFrames);
+        std::vector<float> floatSignal (signal.begin(), signal.end());
+        
+        for (int onsetDetectionFunctionType = EnergyEnvelope; onsetDetectionFunctionType <= HighFrequencySpectralDifferenceHWR; onsetDetectionFunctionType++)
+        {
+            CAPTURE (onsetDetectionFunctionType);
+            
+            OnsetDetectionFunction reference (hopSize, frameSize, onsetDetectionFunctionType, HanningWindow);
+            OnsetDetectionFunctionFloat singlePrecision (hopSize, frameSize, onsetDetectionFunctionType, HanningWindow);
+            
+            std::vector<double> expected (numFrames), actual (numFrames);
+            
+            for (int i = 0; i < numFrames; i++)
+            {
+                expected[i] = reference.calculateOnsetDetectionFunctionSample (&signal[i * hopSize]);
+                actual[i] = singlePrecision.calculateOnsetDetectionFunctionSample (&floatSignal[i * hopSize]);
+            }
+            
+            double peak = *std::max_element (expected.begin(), expected.end());
+            
+            // the documented tolerance, relative to the peak of the detection function
+            for (int i = 0; i < numFrames; i++)
+                REQUIRE (fabs (actual[i] - expected[i]) < 1e-4 * peak);
+        }
+    }
+}
+
+//======================================================================
+//=========================== FRAME INPUT ==============================
+//======================================================================
+TEST_SUITE ("frameInput")
+{
+    //======================================================================
+    TEST_CASE ("fullFramesMatchHopInput")
+    {
+        int hopSize = 256;
+        int frameSize = 1024;
+        int numFrames = 200;
+        
+        std::vector<double> signal = createTestSignal (hopSize * numFrames);
+        
+        for (int onsetDetectionFunctionType = EnergyEnvelope; onsetDetectionFunctionType <= HighFrequencySpectralDifferenceHWR; onsetDetectionFunctionType++)
+        {
+            CAPTURE (onsetDetectionFunctionType);
+            
+            OnsetDetectionFunction hopInput (hopSize, frameSize, onsetDetectionFunctionType, HanningWindow);
+            OnsetDetectionFunction frameInput (hopSize, frameSize, onsetDetectionFunctionType, HanningWindow);
+            
+            // the hop input starts from a frame of zeros, so we only compare once it has filled
+            for (int i = 0; i < numFrames; i++)
+            {
+                double expected = hopInput.calculateOnsetDetectionFunctionSample (&signal[i * hopSize]);
+                
+                int frameStart = ((i + 1) * hopSize) - frameSize;
+                
+                if (frameStart >= 0)
+                {
+                    double actual = frameInput.calculateOnsetDetectionFunctionSampleFromFrame (&signal[frameStart]);
+                    
+                    // the history of the frame input is only complete after a few frames
+                    if (frameStart >= 2 * hopSize)
+                        REQUIRE (actual == doctest::Approx (expected));
+                }
+            }
+        }
+    }
+}
+
+//======================================================================
+//=========================== FEATURE VECTOR ===========================
+//======================================================================
+TEST_SUITE ("featureVector")
+{
+    //======================================================================
+    void checkFeaturesMatchSingleTypes (int complexDomainPredictionMethod, unsigned int featureMask)
+    {
+        int hopSize = 512;
+        int frameSize = 1024;
+        int numFrames = 200;
+        
+        std::vector<double> signal = createTestSignal (hopSize * numFrames);
+        
+        OnsetDetectionFunction multiFeature (hopSize, frameSize);
+        multiFeature.setComplexDomainPredictionMethod (complexDomainPredictionMethod);
+        multiFeature.setFeatureMask (featureMask);
+        
+        std::vector<OnsetDetectionFunction*> singleTypes;
+        
+        for (int type = 0; type < NumOnsetDetectionFunctionTypes; type++)
+        {
+            singleTypes.push_back (new OnsetDetectionFunction (hopSize, frameSize, type, HanningWindow));
+            singleTypes.back()->setComplexDomainPredictionMethod (complexDomainPredictionMethod);
+        }
+        
+        for (int i = 0; i < numFrames; i++)
+        {
+            const OnsetDetectionFunction::FeatureVector& features = multiFeature.calculateOnsetDetectionFunctionFeatures (&signal[i * hopSize]);
+            
+            for (int type = 0; type < NumOnsetDetectionFunctionTypes; type++)
+            {
+                CAPTURE (type);
+                
+                double expected = singleTypes[type]->calculateOnsetDetectionFunctionSample (&signal[i * hopSize]);
+                
+                if ((featureMask & (1u << type)) != 0)
+                    REQUIRE (features[type] == doctest::Approx (expected).epsilon (1e-9));
+                else
+                    REQUIRE (features[type] == 0.);
+            }
+        }
+        
+        for (OnsetDetectionFunction* odf : singleTypes)
+            delete odf;
+    }
+    
+    //======================================================================
+    TEST_CASE ("allFeaturesMatchSingleTypesWithComplexArithmeticPrediction")
+    {
+        checkFeaturesMatchSingleTypes (ComplexArithmeticPrediction, AllOnsetDetectionFunctionFeatures);
+    }
+    
+    //======================================================================
+    TEST_CASE ("allFeaturesMatchSingleTypesWithPhaseUnwrappingPrediction")
+    {
+        checkFeaturesMatchSingleTypes (PhaseUnwrappingPrediction, AllOnsetDetectionFunctionFeatures);
+    }
+    
+    //======================================================================
+    TEST_CASE ("selectedFeaturesMatchSingleTypes")
+    {
+        checkFeaturesMatchSingleTypes (ComplexArithmeticPrediction, (1u << EnergyDifference) | (1u << SpectralDifferenceHWR) | (1u << ComplexSpectralDifferenceHWR));
+        checkFeaturesMatchSingleTypes (ComplexArithmeticPrediction, (1u << ComplexSpectralDifference) | (1u << HighFrequencyContent));
+    }
+}
+
+//======================================================================
+//===================== STATIC DETECTION FUNCTIONS =====================
+//======================================================================
+TEST_SUITE ("staticOnsetDetectionFunction")
+{
+    //======================================================================
+    template <OnsetDetectionFunctionType Type, WindowType Window>
+    void checkStaticTypeMatchesRunTimeType()
+    {
+        int hopSize = 512;
+        int frameSize = 1024;
+        int numFrames = 100;
+        
+        std::vector<double> signal = createTestSignal (hopSize * numFrames);
+        
+        OnsetDetectionFunction runTime (hopSize, frameSize, Type, Window);
+        StaticOnsetDetectionFunction<Type, Window> compileTime (hopSize, frameSize);
+        
+        for (int i = 0; i < numFrames; i++)
+            REQUIRE (compileTime.calculateOnsetDetectionFunctionSample (&signal[i * hopSize]) == runTime.calculateOnsetDetectionFunctionSample (&signal[i * hopSize]));
+    }
+    
+    //======================================================================
+    TEST_CASE ("staticTypesMatchRunTimeTypes")
+    {
+        checkStaticTypeMatchesRunTimeType<EnergyDifference, HanningWindow>();
+        checkStaticTypeMatchesRunTimeType<SpectralDifferenceHWR, HammingWindow>();
+        checkStaticTypeMatchesRunTimeType<PhaseDeviation, BlackmanWindow>();
+        checkStaticTypeMatchesRunTimeType<ComplexSpectralDifferenceHWR, HanningWindow>();
+        checkStaticTypeMatchesRunTimeType<HighFrequencySpectralDifference, TukeyWindow>();
+    }
+}
+
+//======================================================================
+//======================== FFT IMPLEMENTATIONS =========================
+//======================================================================
+TEST_SUITE ("fftImplementations")
+{
+    //======================================================================
+    TEST_CASE ("allFFTImplementationsGiveTheSameDetectionFunction")
+    {
+        int hopSize = 512;
+        int frameSize = 1024;
+        int numFrames = 100;
+        
+        std::vector<double> signal = createTestSignal (hopSize * numFrames);
+        
+        OnsetDetectionFunction reference (hopSize, frameSize, ComplexSpectralDifferenceHWR, HanningWindow);
+        reference.setFFTImplementation (BuiltInFFTImplementation);
+        REQUIRE_EQ (reference.getFFTImplementation(), BuiltInFFTImplementation);
+        
+        std::vector<double> expected (numFrames);
+        
+        for (int i = 0; i < numFrames; i++)
+            expected[i] = reference.calculateOnsetDetectionFunctionSample (&signal[i * hopSize]);
+        
+        double peak = *std::max_element (expected.begin(), expected.end());
+        
+        for (int implementation : {FFTWImplementation, KissFFTImplementation})
+        {
+            if (! FFT<double>::isAvailable (implementation))
+                continue;
+            
+            OnsetDetectionFunction odf (hopSize, frameSize, ComplexSpectralDifferenceHWR, HanningWindow);
+            odf.setFFTImplementation (implementation);
+            REQUIRE_EQ (odf.getFFTImplementation(), implementation);
+            
+            double maxDifference = 0;
+            
+            for (int i = 0; i < numFrames; i++)
+                maxDifference = std::max (maxDifference, fabs (odf.calculateOnsetDetectionFunctionSample (&signal[i * hopSize]) - expected[i]));
+            
+            // Kiss FFT works in single precision
+            CAPTURE (implementation);
+            CHECK (maxDifference / peak < 1e-4);
+        }
+    }
+}
+
+//======================================================================
+//===================== ENERGY DETECTION FUNCTIONS =====================
+//======================================================================
+TEST_SUITE ("energyDetectionFunctions")
+{
+    //======================================================================
+    template <typename SampleType>
+    void checkRunningEnergyMatchesFullSum (double tolerance)
+    {
+        int hopSize = 128;
+        int frameSize = 1024;
+        int numLoudFrames = 300;
+        int numFrames = 500;
+        
+        // a loud signal that then falls silent, which shows up any drift in the running sum
+        std::vector<double> loudSignal = createTestSignal (hopSize * numLoudFrames);
+        std::vector<SampleType> signal (hopSize * numFrames, SampleType (0));
+        
+        for (size_t i = 0; i < loudSignal.size(); i++)
+            signal[i] = static_cast<SampleType> (100. * loudSignal[i]);
+        
+        BasicOnsetDetectionFunction<SampleType> hopInput (hopSize, frameSize, EnergyEnvelope, HanningWindow);
+        BasicOnsetDetectionFunction<SampleType> frameInput (hopSize, frameSize, EnergyEnvelope, HanningWindow);
+        
+        double peak = 0;
+        
+        for (int i = 0; i < numFrames; i++)
+        {
+            double runningSum = hopInput.calculateOnsetDetectionFunctionSample (&signal[i * hopSize]);
+            int frameStart = ((i + 1) * hopSize) - frameSize;
+            
+            if (frameStart >= 0)
+            {
+                double fullSum = frameInput.calculateOnsetDetectionFunctionSampleFromFrame (&signal[frameStart]);
+                peak = std::max (peak, fullSum);
+                
+                REQUIRE (fabs (runningSum - fullSum) <= tolerance * peak);
+                REQUIRE (runningSum >= 0);
+            }
+        }
+        
+        // once the frame has been silent for a while, the running sum has been summed exactly again
+        CHECK_EQ (hopInput.calculateOnsetDetectionFunctionSample (&signal[(numFrames - 1) * hopSize]), SampleType (0));
+    }
+    
+    //======================================================================
+    TEST_CASE ("runningEnergyMatchesFullSumInDoublePrecision")
+    {
+        checkRunningEnergyMatchesFullSum<double> (1e-12);
+    }
+    
+    //======================================================================
+    TEST_CASE ("runningEnergyMatchesFullSumInSinglePrecision")
+    {
+        checkRunningEnergyMatchesFullSum<float> (1e-5);
+    }
+    
+    //======================================================================
+    TEST_CASE ("energyIsSummedAgainAfterSwitchingFromAnotherType")
+    {
+        int hopSize = 128;
+        int frameSize = 1024;
+        std::vector<double> signal = createTestSignal (hopSize * 200);
+        
+        // the running energy is only kept for the energy detection functions
+        OnsetDetectionFunction hopInput (hopSize, frameSize, SpectralDifference, HanningWindow);
+        OnsetDetectionFunction frameInput (hopSize, frameSize, EnergyEnvelope, HanningWindow);
+        
+        for (int i = 0; i < 200; i++)
+        {
+            // before the running sum would next have been summed exactly anyway
+            if (i == 30)
+                hopInput.setOnsetDetectionFunctionType (EnergyEnvelope);
+            
+            double sample = hopInput.calculateOnsetDetectionFunctionSample (&signal[i * hopSize]);
+            
+            if (i >= 30)
+            {
+                double fullSum = frameInput.calculateOnsetDetectionFunctionSampleFromFrame (&signal[((i + 1) * hopSize) - frameSize]);
+                REQUIRE_EQ (sample, doctest::Approx (fullSum).epsilon (1e-12));
+            }
+        }
+    }
+}
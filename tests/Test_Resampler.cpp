@@ -0,0 +1,156 @@
+#include "doctest.h"
+#include <Resampler.h>
+#include <BTrack.h>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+//======================================================================
+//============================= RESAMPLER ==============================
+//======================================================================
+TEST_SUITE ("resampler")
+{
+    //======================================================================
+    /** @returns a sum of sinusoids well below the Nyquist frequency of both lengths, at position t in input samples */
+    double testSignal (double t, int inputLength, int outputLength)
+    {
+        double nyquist = 0.5 * std::min (1., static_cast<double> (outputLength) / static_cast<double> (inputLength));
+        return sin (2. * M_PI * 0.3 * nyquist * t) + 0.5 * cos (2. * M_PI * 0.6 * nyquist * t + 0.4);
+    }
+
+    //======================================================================
+    void checkResamplesBandLimitedSignal (int inputLength, int outputLength, int quality, double tolerance)
+    {
+        Resampler resampler;
+        resampler.setup (inputLength, outputLength, quality);
+
+        double* input = resampler.getInputBuffer();
+
+        for (int i = 0; i < inputLength; i++)
+            input[i] = testSignal (i, inputLength, outputLength);
+
+        std::vector<double> output (outputLength);
+        resampler.process (output.data());
+
+        // the signal stops at the ends of the block, so only compare away from them
+        double ratio = static_cast<double> (inputLength) / static_cast<double> (outputLength);
+        double maxDifference = 0;
+
+        for (int n = 0; n < outputLength; n++)
+        {
+            double t = n * ratio;
+
+            if (t < 80 * std::max (1., ratio) || t > inputLength - 80 * std::max (1., ratio))
+                continue;
+
+            maxDifference = std::max (maxDifference, fabs (output[n] - testSignal (t, inputLength, outputLength)));
+        }
+
+        CHECK (maxDifference < tolerance);
+    }
+
+    //======================================================================
+    TEST_CASE ("bandLimitedSignalIsResampledAccurately")
+    {
+        int lengths[][2] = {{1024, 512}, {256, 512}, {594, 512}, {297, 256}};
+
+        for (auto& length : lengths)
+        {
+            CAPTURE (length[0]);
+            CAPTURE (length[1]);
+            checkResamplesBandLimitedSignal (length[0], length[1], HighQualityResampling, 1e-3);
+            checkResamplesBandLimitedSignal (length[0], length[1], MediumQualityResampling, 1e-2);
+            checkResamplesBandLimitedSignal (length[0], length[1], LowQualityResampling, 5e-2);
+        }
+    }
+
+    //======================================================================
+    TEST_CASE ("equalLengthsCopyTheInput")
+    {
+        Resampler resampler;
+        resampler.setup (512, 512, HighQualityResampling);
+
+        double* input = resampler.getInputBuffer();
+
+        for (int i = 0; i < 512; i++)
+            input[i] = sin (0.7 * i) + (i % 5);
+
+        std::vector<double> output (512);
+        resampler.process (output.data());
+
+        for (int i = 0; i < 512; i++)
+            CHECK_EQ (output[i], doctest::Approx (sin (0.7 * i) + (i % 5)).epsilon (1e-14));
+    }
+
+    //======================================================================
+    TEST_CASE ("constantInputStaysConstantAwayFromTheEnds")
+    {
+        Resampler resampler;
+        resampler.setup (1024, 512, HighQualityResampling);
+
+        double* input = resampler.getInputBuffer();
+        std::fill (input, input + 1024, 2.);
+
+        std::vector<double> output (512);
+        resampler.process (output.data());
+
+        for (int n = 64; n < 512 - 64; n++)
+            CHECK_EQ (output[n], doctest::Approx (2.).epsilon (1e-9));
+    }
+
+    //======================================================================
+    TEST_CASE ("libsamplerateFallsBackToBuiltInResamplerWhenUnavailable")
+    {
+        Resampler resampler;
+        resampler.setup (1024, 512, LibsamplerateResampling);
+
+#ifdef USE_LIBSAMPLERATE
+        CHECK_EQ (resampler.getQuality(), LibsamplerateResampling);
+#else
+        CHECK_EQ (resampler.getQuality(), HighQualityResampling);
+#endif
+    }
+
+    //======================================================================
+    TEST_CASE ("builtInResamplerIsTheDefault")
+    {
+        // a hop of 256 samples needs the onset detection function resampling from 1024 samples
+        BTrack b (256);
+        BTrack builtIn (256);
+        builtIn.setResamplingQuality (HighQualityResampling);
+        
+        for (int i = 0; i < 4000; i++)
+        {
+            double sample = (i % 86) == 0 ? 1. : 0.;
+            b.processOnsetDetectionFunctionSample (sample);
+            builtIn.processOnsetDetectionFunctionSample (sample);
+            
+            REQUIRE_EQ (b.getCurrentTempoEstimate(), builtIn.getCurrentTempoEstimate());
+        }
+        
+        CHECK (fabs (b.getCurrentTempoEstimate() - 120.) < 3.);
+    }
+
+#ifdef USE_LIBSAMPLERATE
+    //======================================================================
+    TEST_CASE ("builtInResamplerMatchesLibsamplerate")
+    {
+        int inputLength = 594;
+        Resampler builtIn;
+        Resampler libsamplerate;
+        builtIn.setup (inputLength, 512, HighQualityResampling);
+        libsamplerate.setup (inputLength, 512, LibsamplerateResampling);
+
+        for (int i = 0; i < inputLength; i++)
+            builtIn.getInputBuffer()[i] = libsamplerate.getInputBuffer()[i] = testSignal (i, inputLength, 512);
+
+        std::vector<double> builtInOutput (512);
+        std::vector<double> libsamplerateOutput (512);
+        builtIn.process (builtInOutput.data());
+        libsamplerate.process (libsamplerateOutput.data());
+
+        for (int n = 80; n < 512 - 80; n++)
+            CHECK_EQ (builtInOutput[n], doctest::Approx (libsamplerateOutput[n]).epsilon (1e-3));
+    }
+#endif
+}
@@ -0,0 +1,107 @@
+#include "doctest.h"
+#include <SeqLock.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+//======================================================================
+//============================= SEQ LOCK ===============================
+//======================================================================
+TEST_SUITE ("seqLock")
+{
+    //======================================================================
+    struct Block
+    {
+        int values[16];
+    };
+    
+    //======================================================================
+    TEST_CASE ("readersGetTheLatestWrittenValue")
+    {
+        SeqLock<double> lock;
+        CHECK_EQ (lock.read(), 0.);
+        
+        lock.write (1.5);
+        CHECK_EQ (lock.read(), 1.5);
+        CHECK_EQ (lock.read(), 1.5);
+        
+        lock.write (-2.);
+        CHECK_EQ (lock.read(), -2.);
+    }
+    
+    //======================================================================
+    TEST_CASE ("valuesWhoseSizeIsNotAMultipleOfAWordAreCopiedWhole")
+    {
+        struct Odd
+        {
+            char c[7];
+        };
+        
+        SeqLock<Odd> lock;
+        Odd value = {{'a', 'b', 'c', 'd', 'e', 'f', 'g'}};
+        lock.write (value);
+        
+        Odd result = lock.read();
+        
+        for (int i = 0; i < 7; i++)
+            CHECK_EQ (result.c[i], value.c[i]);
+    }
+    
+    //======================================================================
+    TEST_CASE ("manyReadersNeverSeeTornOrOutOfOrderValues")
+    {
+        // each value is a block filled with one number, so a torn read would show two numbers
+        int numValues = 20000;
+        int numReaders = 3;
+        
+        SeqLock<Block> lock;
+        std::atomic<bool> finished (false);
+        std::vector<int> numTornReads (numReaders, 0);
+        std::vector<int> numOutOfOrderReads (numReaders, 0);
+        std::vector<std::thread> readers;
+        
+        for (int t = 0; t < numReaders; t++)
+        {
+            readers.emplace_back ([&, t]
+            {
+                int lastValue = 0;
+                
+                while (! finished)
+                {
+                    Block block = lock.read();
+                    
+                    for (int value : block.values)
+                        if (value != block.values[0])
+                            numTornReads[t]++;
+                    
+                    if (block.values[0] < lastValue)
+                        numOutOfOrderReads[t]++;
+                    
+                    lastValue = block.values[0];
+                    std::this_thread::yield();
+                }
+            });
+        }
+        
+        for (int value = 1; value <= numValues; value++)
+        {
+            Block block;
+            std::fill (block.values, block.values + 16, value);
+            lock.write (block);
+        }
+        
+        finished = true;
+        
+        for (std::thread& reader : readers)
+            reader.join();
+        
+        for (int t = 0; t < numReaders; t++)
+        {
+            CHECK_EQ (numTornReads[t], 0);
+            CHECK_EQ (numOutOfOrderReads[t], 0);
+        }
+        
+        CHECK_EQ (lock.read().values[0], numValues);
+    }
+}
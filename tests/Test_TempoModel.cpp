@@ -0,0 +1,172 @@
+#include "doctest.h"
+#include <TempoModel.h>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <random>
+
+//======================================================================
+//============================ TEMPO MODEL =============================
+//======================================================================
+TEST_SUITE ("tempoModel")
+{
+    //======================================================================
+    std::vector<double> makeCombFilterBankOutput (int peakLag)
+    {
+        static std::mt19937 generator (1);
+        std::uniform_int_distribution<int> noise (0, 99);
+        std::vector<double> combFilterBankOutput (128);
+        
+        for (int i = 0; i < 128; i++)
+            combFilterBankOutput[i] = static_cast<double> (noise (generator)) / 100. + (abs (i - peakLag) < 2 ? 5. : 0.);
+        
+        return combFilterBankOutput;
+    }
+    
+    //======================================================================
+    TEST_CASE ("rangesAreKeptValid")
+    {
+        TempoModel<DynamicNumTempoStates> equal (TempoRange (100., 100., 11));
+        CHECK_EQ (equal.getMinimumTempo(), 100.);
+        CHECK_EQ (equal.getTempoStep(), 1.);
+        CHECK_EQ (equal.getNearestState (105.), 5);
+        
+        TempoModel<DynamicNumTempoStates> reversed (TempoRange (160., 80., 41));
+        CHECK_EQ (reversed.getMaximumTempo(), 200.);
+        
+        TempoModel<41> tooSlow (TempoRange (0., 160.));
+        CHECK_EQ (tooSlow.getMinimumTempo(), TempoModel<41>::getSlowestTempo());
+        CHECK (tooSlow.getTempoStep() > 0.);
+        CHECK (std::isfinite (tooSlow.getTempo (tooSlow.getNearestState (10.))));
+    }
+    
+    //======================================================================
+    TEST_CASE ("bandedUpdateMatchesDenseMaxProduct")
+    {
+        TempoModel<DynamicNumTempoStates> tempoModel (TempoRange (60., 200., 71));
+        tempoModel.setTransitionCutoff (0);
+        
+        CHECK_EQ (tempoModel.getTransitionBandwidth(), 70);
+        
+        // the dense update, with the same transition matrix
+        int n = 71;
+        double sigma = 10. / tempoModel.getTempoStep();
+        std::vector<double> prevDelta (n, 1.), delta (n);
+        
+        for (int update = 0; update < 50; update++)
+        {
+            std::vector<double> combFilterBankOutput = makeCombFilterBankOutput (30 + (update % 20));
+            
+            for (int j = 0; j < n; j++)
+            {
+                double maxValue = -1;
+                
+                for (int i = 0; i < n; i++)
+                    maxValue = std::max (maxValue, prevDelta[i] * (1 / (sigma * sqrt (2 * M_PI))) * exp (-pow (j - i, 2) / (2 * pow (sigma, 2))));
+                
+                int lag1 = (int) round ((60. * 44100. / 512.) / tempoModel.getTempo (j));
+                int lag2 = (int) round ((60. * 44100. / 512.) / (2 * tempoModel.getTempo (j)));
+                delta[j] = maxValue * (combFilterBankOutput[std::min (lag1, 128) - 1] + combFilterBankOutput[std::min (lag2, 128) - 1]);
+            }
+            
+            double sum = 0;
+            
+            for (int j = 0; j < n; j++)
+                sum += delta[j];
+            
+            for (int j = 0; j < n; j++)
+                prevDelta[j] = delta[j] / sum;
+            
+            int expected = (int) (std::max_element (prevDelta.begin(), prevDelta.end()) - prevDelta.begin());
+            
+            REQUIRE_EQ (tempoModel.update (combFilterBankOutput), expected);
+        }
+    }
+    
+    //======================================================================
+    TEST_CASE ("defaultCutoffFindsTheSameTempi")
+    {
+        TempoModel<41> banded;
+        TempoModel<41> full;
+        full.setTransitionCutoff (0);
+        
+        CHECK_EQ (banded.getTransitionBandwidth(), 26);
+        CHECK_EQ (full.getTransitionBandwidth(), 40);
+        
+        for (int update = 0; update < 200; update++)
+        {
+            std::vector<double> combFilterBankOutput = makeCombFilterBankOutput (update < 100 ? 40 : 25);
+            REQUIRE_EQ (banded.update (combFilterBankOutput), full.update (combFilterBankOutput));
+        }
+    }
+    
+    //======================================================================
+    TEST_CASE ("logDomainFindsTheSameTempi")
+    {
+        for (int numStates : {41, 141})
+        {
+            CAPTURE (numStates);
+            
+            TempoModel<DynamicNumTempoStates> linear (TempoRange (60., 200., numStates));
+            TempoModel<DynamicNumTempoStates> logDomain (TempoRange (60., 200., numStates));
+            logDomain.setLogDomain (true);
+            
+            CHECK (logDomain.isUsingLogDomain());
+            
+            for (int update = 0; update < 200; update++)
+            {
+                if (update == 150)
+                {
+                    linear.setTempo (75.);
+                    logDomain.setTempo (75.);
+                }
+                
+                std::vector<double> combFilterBankOutput = makeCombFilterBankOutput (update < 100 ? 40 : 25);
+                REQUIRE_EQ (linear.update (combFilterBankOutput), logDomain.update (combFilterBankOutput));
+            }
+            
+            linear.fixTempo (100.);
+            logDomain.fixTempo (100.);
+            
+            std::vector<double> combFilterBankOutput = makeCombFilterBankOutput (40);
+            CHECK_EQ (linear.update (combFilterBankOutput), logDomain.update (combFilterBankOutput));
+        }
+    }
+    
+    //======================================================================
+    TEST_CASE ("switchingDomainKeepsTheEstimate")
+    {
+        TempoModel<41> tempoModel;
+        
+        for (int update = 0; update < 20; update++)
+            tempoModel.update (makeCombFilterBankOutput (40));
+        
+        tempoModel.setLogDomain (true);
+        int logState = tempoModel.update (makeCombFilterBankOutput (40));
+        tempoModel.setLogDomain (false);
+        int linearState = tempoModel.update (makeCombFilterBankOutput (40));
+        
+        CHECK (abs (logState - linearState) <= 1);
+        CHECK (fabs (tempoModel.getTempo (linearState) - (60. * 44100. / 512.) / 40.) < 6.);
+    }
+    
+    //======================================================================
+    TEST_CASE ("logDomainRecoversFromSilence")
+    {
+        TempoModel<41> tempoModel;
+        tempoModel.setLogDomain (true);
+        
+        for (int update = 0; update < 20; update++)
+            tempoModel.update (makeCombFilterBankOutput (25));
+        
+        for (int update = 0; update < 20; update++)
+            tempoModel.update (std::vector<double> (128, 0.));
+        
+        int state = 0;
+        
+        for (int update = 0; update < 40; update++)
+            state = tempoModel.update (makeCombFilterBankOutput (40));
+        
+        CHECK (fabs (tempoModel.getTempo (state) - (60. * 44100. / 512.) / 40.) < 6.);
+    }
+}
@@ -0,0 +1,103 @@
+#include "doctest.h"
+#include <TripleBuffer.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+//======================================================================
+//=========================== TRIPLE BUFFER ============================
+//======================================================================
+TEST_SUITE ("tripleBuffer")
+{
+    //======================================================================
+    TEST_CASE ("readerGetsTheLatestPublishedValue")
+    {
+        TripleBuffer<int> buffer;
+        buffer.reset (0);
+        
+        CHECK_FALSE (buffer.read());
+        CHECK_EQ (buffer.getReadBuffer(), 0);
+        
+        buffer.getWriteBuffer() = 1;
+        buffer.publish();
+        
+        CHECK (buffer.read());
+        CHECK_EQ (buffer.getReadBuffer(), 1);
+        CHECK_FALSE (buffer.read());
+        CHECK_EQ (buffer.getReadBuffer(), 1);
+        
+        // a value published before the last one was read replaces it
+        buffer.getWriteBuffer() = 2;
+        buffer.publish();
+        buffer.getWriteBuffer() = 3;
+        buffer.publish();
+        
+        CHECK (buffer.read());
+        CHECK_EQ (buffer.getReadBuffer(), 3);
+        CHECK_FALSE (buffer.read());
+    }
+    
+    //======================================================================
+    TEST_CASE ("resetForgetsUnreadValues")
+    {
+        TripleBuffer<int> buffer;
+        buffer.getWriteBuffer() = 1;
+        buffer.publish();
+        
+        buffer.reset (5);
+        
+        CHECK_FALSE (buffer.read());
+        CHECK_EQ (buffer.getReadBuffer(), 5);
+        CHECK_EQ (buffer.getWriteBuffer(), 5);
+    }
+    
+    //======================================================================
+    TEST_CASE ("valuesArriveWholeAndInOrderAcrossThreads")
+    {
+        // each value is a block filled with one number, so a torn read would show two numbers
+        int blockSize = 64;
+        int numValues = 20000;
+        
+        TripleBuffer<std::vector<int>> buffer;
+        buffer.reset (std::vector<int> (blockSize, 0));
+        
+        std::thread writer ([&]
+        {
+            for (int value = 1; value <= numValues; value++)
+            {
+                std::vector<int>& block = buffer.getWriteBuffer();
+                std::fill (block.begin(), block.end(), value);
+                buffer.publish();
+            }
+        });
+        
+        int lastValue = 0;
+        int numTornReads = 0;
+        int numOutOfOrderReads = 0;
+        
+        while (lastValue < numValues)
+        {
+            if (! buffer.read())
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            
+            const std::vector<int>& block = buffer.getReadBuffer();
+            
+            for (int value : block)
+                if (value != block[0])
+                    numTornReads++;
+            
+            if (block[0] <= lastValue)
+                numOutOfOrderReads++;
+            
+            lastValue = block[0];
+        }
+        
+        writer.join();
+        
+        CHECK_EQ (numTornReads, 0);
+        CHECK_EQ (numOutOfOrderReads, 0);
+    }
+}
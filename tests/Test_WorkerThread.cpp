@@ -0,0 +1,61 @@
+#include "doctest.h"
+#include <WorkerThread.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+//======================================================================
+//=========================== WORKER THREAD ============================
+//======================================================================
+TEST_SUITE ("workerThread")
+{
+    //======================================================================
+    TEST_CASE ("semaphoreKeepsPostsMadeBeforeWaiting")
+    {
+        Semaphore semaphore;
+        semaphore.post();
+        semaphore.post();
+        
+        // neither wait blocks, as both posts were counted
+        semaphore.wait();
+        semaphore.wait();
+    }
+    
+    //======================================================================
+    TEST_CASE ("everyTriggerIsRun")
+    {
+        std::atomic<int> numRuns (0);
+        WorkerThread worker ([&numRuns] { numRuns++; });
+        
+        // waiting straight after each trigger would hang if a wake up were lost
+        for (int i = 0; i < 1000; i++)
+        {
+            worker.trigger();
+            worker.waitUntilIdle();
+            REQUIRE_EQ (numRuns.load(), i + 1);
+        }
+    }
+    
+    //======================================================================
+    TEST_CASE ("triggersWhileRunningRunTheTaskAgain")
+    {
+        std::atomic<int> numRuns (0);
+        std::atomic<bool> release (false);
+        
+        WorkerThread worker ([&] { numRuns++; while (numRuns == 1 && ! release) std::this_thread::yield(); });
+        
+        worker.trigger();
+        
+        while (numRuns == 0)
+            std::this_thread::yield();
+        
+        // several triggers while the task runs make it run once more afterwards
+        for (int i = 0; i < 10; i++)
+            worker.trigger();
+        
+        release = true;
+        worker.waitUntilIdle();
+        
+        CHECK_EQ (numRuns.load(), 2);
+    }
+}